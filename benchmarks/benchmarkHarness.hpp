@@ -0,0 +1,46 @@
+#pragma once
+
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Timing, command line and teardown shared by the benchmark executables
+
+
+using Clock = std::chrono::high_resolution_clock;
+
+inline double secondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+// Runs benchmark(count, frames) from firstCount up, ten times more each step, then at the max count
+//  - Command line : [max count] [--frames <count>]
+inline void runScaling(int argc, char** argv, uint32_t firstCount, uint32_t defaultMaxCount, uint32_t defaultFrames,
+                       const std::function<void(uint32_t count, uint32_t frames)>& benchmark)
+{
+    uint32_t maxCount = defaultMaxCount;
+    uint32_t frames   = defaultFrames;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc) {
+            frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else {
+            maxCount = static_cast<uint32_t>(std::stoul(argument));
+        }
+    }
+
+    for (uint32_t count=firstCount; count < maxCount; count *= 10) {
+        benchmark(count, frames);
+    }
+    benchmark(maxCount, frames);
+}
+
+// The thread pool and the logger outlive everything they were used by
+inline void finishBenchmark(){
+    ThreadPool::destroy();
+    Logger::destroy();
+}
@@ -0,0 +1,74 @@
+// CPU frustum culling throughput : scalar vs SSE vs AVX2 kernels over SoA bounding spheres, single threaded and on the thread pool
+//  Usage : FrustumCullBenchmark [max objects] [--frames <count>]
+//  - Defaults to 10k, 100k and 1M objects, 100 frames each
+//  - Spheres are scattered around a camera looking down a 60 degree frustum, roughly a third of them visible
+
+#include <frustumCuller.hpp>
+#include <benchmarkHarness.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+
+const uint32_t DEFAULT_MAX_OBJECTS = 1000000;
+const uint32_t DEFAULT_FRAMES      = 100;
+
+
+static void benchmark(uint32_t objectCount, uint32_t frames){
+    LOG_INFO_S("=== " << objectCount << " objects, " << frames << " frames ===");
+
+    std::mt19937                          random(objectCount);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+    CullBounds bounds;
+    bounds.resize(objectCount);
+    for (uint32_t i=0; i < objectCount; ++i) {
+        bounds.set(i, glm::vec3(position(random), position(random), position(random)), radius(random));
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, -50.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    proj[1][1] *= -1;
+
+    FrustumCuller culler;
+    culler.setFrustum(proj * view);
+
+    std::vector<uint32_t> visible;
+    uint32_t              referenceCount = culler.cull(bounds, visible, CullKernel::SCALAR, false);
+
+    auto run = [&](CullKernel kernel, bool threaded){
+        if (!FrustumCuller::isSupported(kernel)) {
+            LOG_INFO_S(std::left << std::setw(7) << FrustumCuller::getKernelName(kernel) << (threaded? "threaded " : "1 thread ") << ": not supported");
+            return;
+        }
+
+        uint32_t visibleCount = 0;
+
+        auto start = Clock::now();
+        for (uint32_t frame=0; frame < frames; ++frame) {
+            visibleCount = culler.cull(bounds, visible, kernel, threaded);
+        }
+        double frameSeconds = secondsSince(start) / frames;
+
+        LOG_INFO_S(std::left << std::setw(7) << FrustumCuller::getKernelName(kernel) << (threaded? "threaded " : "1 thread ") << ": "
+                   << frameSeconds * 1000.0 << " ms/frame (" << objectCount / (frameSeconds * 1e9) << " objects/ns, "
+                   << visibleCount << " visible)");
+
+        if (visibleCount != referenceCount) {
+            LOG_ERROR_S(FrustumCuller::getKernelName(kernel) << " kept " << visibleCount << " objects, the scalar kernel " << referenceCount);
+        }
+    };
+
+    for (bool threaded : { false, true }) {
+        run(CullKernel::SCALAR, threaded);
+        run(CullKernel::SSE,    threaded);
+        run(CullKernel::AVX2,   threaded);
+    }
+
+    LOG_INFO_S(ThreadPool::get().getThreadCount() << " threads, " << FRUSTUM_CULL_BATCH_SIZE << " objects per batch");
+}
+
+int main(int argc, char** argv){
+    runScaling(argc, argv, 10000, DEFAULT_MAX_OBJECTS, DEFAULT_FRAMES, benchmark);
+    finishBenchmark();
+}
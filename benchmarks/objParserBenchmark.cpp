@@ -0,0 +1,143 @@
+// Compares ObjParser against tinyobj on the same files
+//  Usage : ObjParserBenchmark [model.obj] [--synthetic <megabytes>]
+//  - Defaults to the viking room model and a generated 500 MB grid mesh
+
+#include <objParser.hpp>
+#include <benchmarkHarness.hpp>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tol/tiny_obj_loader.h>
+
+
+#define DEFAULT_MODEL    "../assets/models/viking_room.obj"
+#define SYNTHETIC_MODEL  "synthetic_benchmark.obj"
+
+const size_t DEFAULT_SYNTHETIC_MEGABYTES = 500;
+
+
+// Square grid with texture coordinates, written as triangles - roughly 130 bytes per grid cell
+static void writeSyntheticModel(const std::string& fileName, size_t megabytes){
+    size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(megabytes) * 1024 * 1024 / 130.0)) + 2;
+
+    LOG_INFO_S("Generating " << fileName << " : " << side << "x" << side << " grid");
+
+    FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (file == nullptr) LOG_FATAL("Failed to create synthetic model");
+
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    for (size_t y=0; y < side; ++y) {
+        for (size_t x=0; x < side; ++x) {
+            float u = static_cast<float>(x) / (side - 1);
+            float v = static_cast<float>(y) / (side - 1);
+            std::fprintf(file, "v %.6f %.6f %.6f\n", u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f));
+            std::fprintf(file, "vt %.6f %.6f\n", u, v);
+        }
+    }
+
+    for (size_t y=0; y + 1 < side; ++y) {
+        for (size_t x=0; x + 1 < side; ++x) {
+            size_t a = y * side + x + 1;
+            size_t b = a + 1;
+            size_t c = a + side;
+            size_t d = c + 1;
+            std::fprintf(file, "f %zu/%zu %zu/%zu %zu/%zu\n", a, a, b, b, d, d);
+            std::fprintf(file, "f %zu/%zu %zu/%zu %zu/%zu\n", a, a, d, d, c, c);
+        }
+    }
+
+    std::fclose(file);
+}
+
+static void benchmark(const std::string& fileName){
+    size_t fileSize = 0;
+    {
+        std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) LOG_FATAL_S("Failed to open " << fileName);
+        fileSize = static_cast<size_t>(file.tellg());
+    }
+    double megabytes = fileSize / (1024.0 * 1024.0);
+
+    LOG_INFO_S("=== " << fileName << " (" << megabytes << " MB) ===");
+
+
+    // tinyobj
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      warn, err;
+
+    auto start = Clock::now();
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, fileName.c_str())) {
+        LOG_FATAL_S("tinyobj failed : " << warn + err);
+    }
+    double tinyobjSeconds = secondsSince(start);
+
+
+    // ObjParser
+    ObjMesh mesh;
+
+    start = Clock::now();
+    if (!ObjParser::load(fileName, mesh)) {
+        LOG_FATAL("ObjParser failed");
+    }
+    double parserSeconds = secondsSince(start);
+
+
+    // Both must produce the same corners
+    size_t corner = 0, mismatches = 0;
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            if (corner >= mesh.indices.size()) {
+                ++mismatches;
+                continue;
+            }
+
+            const ObjIndex& other = mesh.indices[corner++];
+
+            const float* position = &attrib.vertices[3 * index.vertex_index];
+            if (mesh.positions[other.position] != glm::vec3(position[0], position[1], position[2])) ++mismatches;
+
+            if (index.texcoord_index >= 0) {
+                const float* texCoord = &attrib.texcoords[2 * index.texcoord_index];
+                if (other.texCoord < 0 || mesh.texCoords[other.texCoord] != glm::vec2(texCoord[0], texCoord[1])) ++mismatches;
+            }
+        }
+    }
+    mismatches += mesh.indices.size() - std::min(corner, mesh.indices.size());
+
+    LOG_INFO_S("tinyobj   : " << tinyobjSeconds * 1000.0 << " ms (" << megabytes / tinyobjSeconds << " MB/s)");
+    LOG_INFO_S("ObjParser : " << parserSeconds  * 1000.0 << " ms (" << megabytes / parserSeconds  << " MB/s) - "
+               << tinyobjSeconds / parserSeconds << "x, " << ThreadPool::get().getThreadCount() << " threads");
+
+    if (mismatches) {
+        LOG_ERROR_S("Outputs differ : " << mismatches << " of " << mesh.indices.size() << " corners");
+    } else {
+        LOG_INFO_S("Outputs match : " << mesh.indices.size() << " corners");
+    }
+}
+
+int main(int argc, char** argv){
+    std::string model     = DEFAULT_MODEL;
+    size_t      megabytes = DEFAULT_SYNTHETIC_MEGABYTES;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--synthetic" && i + 1 < argc) {
+            megabytes = static_cast<size_t>(std::stoul(argv[++i]));
+        } else {
+            model = argument;
+        }
+    }
+
+    benchmark(model);
+
+    if (megabytes) {
+        writeSyntheticModel(SYNTHETIC_MODEL, megabytes);
+        benchmark(SYNTHETIC_MODEL);
+        std::remove(SYNTHETIC_MODEL);
+    }
+
+    finishBenchmark();
+}
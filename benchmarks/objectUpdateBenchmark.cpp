@@ -0,0 +1,104 @@
+// Per frame object data updates : one aligned dynamic uniform buffer slot per object vs a contiguous storage buffer
+//  Usage : ObjectUpdateBenchmark [max objects] [--frames <count>]
+//  - Defaults to 1k, 10k and 100k objects, 100 frames each
+//  - The frame ring is backed by host memory here - the renderer writes into a persistently mapped buffer the same way
+
+#include <frameRing.hpp>
+#include <benchmarkHarness.hpp>
+#include <utilities.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+
+const uint32_t     DEFAULT_MAX_OBJECTS       = 100000;
+const uint32_t     DEFAULT_FRAMES            = 100;
+const uint32_t     FRAMES_IN_FLIGHT          = 2;
+const VkDeviceSize UNIFORM_OFFSET_ALIGNMENT  = 256;      // The largest minUniformBufferOffsetAlignment allowed
+const VkDeviceSize STORAGE_OFFSET_ALIGNMENT  = 64;
+const size_t       BATCH_SIZE                = 4096;     // INSTANCE_UPDATE_BATCH_SIZE
+
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){ return (value + alignment - 1) / alignment * alignment; }
+
+
+// What Renderer::updateUniformBuffer() writes for each object
+static inline void writeObject(InstanceData& object, const glm::mat4& transform){
+    object.transform = transform;
+    object.tint      = glm::vec3(1.0f);
+    object.material  = 0;
+}
+
+static void benchmark(uint32_t objectCount, uint32_t frames){
+    LOG_INFO_S("=== " << objectCount << " objects, " << frames << " frames ===");
+
+    std::vector<glm::mat4> transforms(objectCount);
+    for (uint32_t i=0; i < objectCount; ++i) {
+        transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(i % 317, i / 317, 0.0f));
+    }
+
+    // Sized for the padded layout, the larger of the two
+    VkDeviceSize uniformStride = alignUp(sizeof(InstanceData), UNIFORM_OFFSET_ALIGNMENT);
+    VkDeviceSize regionSize    = alignUp(uniformStride * objectCount, UNIFORM_OFFSET_ALIGNMENT);
+
+    std::vector<uint8_t> memory(regionSize * FRAMES_IN_FLIGHT + UNIFORM_OFFSET_ALIGNMENT);
+    void*                aligned = memory.data() + (alignUp(reinterpret_cast<uintptr_t>(memory.data()), UNIFORM_OFFSET_ALIGNMENT) -
+                                                    reinterpret_cast<uintptr_t>(memory.data()));
+
+    FrameRing ring;
+    ring.init(aligned, regionSize, FRAMES_IN_FLIGHT);
+
+    std::vector<uint32_t> dynamicOffsets(objectCount);      // One descriptor set bind per object
+
+    auto report = [objectCount, frames](const char* label, double seconds, VkDeviceSize bytesPerFrame){
+        double frameSeconds = seconds / frames;
+        LOG_INFO_S(label << frameSeconds * 1000.0 << " ms/frame (" << objectCount / frameSeconds / 1e6 << " M objects/s, "
+                   << (bytesPerFrame >> 10) << " KiB/frame)");
+    };
+
+
+    // Dynamic uniform buffer - every object gets its own minUniformBufferOffsetAlignment slot and dynamic offset
+    auto start = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        ring.begin(frame);
+        for (uint32_t i=0; i < objectCount; ++i) {
+            InstanceData* object = ring.allocate<InstanceData>(1, UNIFORM_OFFSET_ALIGNMENT, dynamicOffsets[i]);
+            writeObject(*object, transforms[i]);
+        }
+    }
+    report("dynamic UBO, aligned slots   : ", secondsSince(start), ring.getUsed());
+
+
+    // Instance stream - one allocation, objects written contiguously
+    start = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        ring.begin(frame);
+        uint32_t      offset;
+        InstanceData* objects = ring.allocate<InstanceData>(objectCount, STORAGE_OFFSET_ALIGNMENT, offset);
+        for (uint32_t i=0; i < objectCount; ++i) {
+            writeObject(objects[i], transforms[i]);
+        }
+    }
+    report("SSBO, contiguous             : ", secondsSince(start), ring.getUsed());
+
+
+    // As Renderer::updateUniformBuffer() does it
+    start = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        ring.begin(frame);
+        uint32_t      offset;
+        InstanceData* objects = ring.allocate<InstanceData>(objectCount, STORAGE_OFFSET_ALIGNMENT, offset);
+        ThreadPool::get().parallelFor(objectCount, BATCH_SIZE, [&](size_t begin, size_t end){
+            for (size_t i=begin; i < end; ++i) {
+                writeObject(objects[i], transforms[i]);
+            }
+        });
+    }
+    report("SSBO, contiguous, threaded   : ", secondsSince(start), ring.getUsed());
+
+    LOG_INFO_S(ThreadPool::get().getThreadCount() << " threads, " << objectCount << " dynamic offset binds per frame for the UBO layout");
+}
+
+int main(int argc, char** argv){
+    runScaling(argc, argv, 1000, DEFAULT_MAX_OBJECTS, DEFAULT_FRAMES, benchmark);
+    finishBenchmark();
+}
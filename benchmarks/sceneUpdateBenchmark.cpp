@@ -0,0 +1,101 @@
+// Scene world matrix updates : everything dirty vs a few dirty subtrees, then the copy into the instance buffer
+//  Usage : SceneUpdateBenchmark [max nodes] [--frames <count>]
+//  - Defaults to 10k, 100k and 1M nodes, 100 frames each
+//  - Groups of 100 drawn nodes under one undrawn group node each, groups under a single root
+
+#include <scene.hpp>
+#include <benchmarkHarness.hpp>
+
+
+const uint32_t DEFAULT_MAX_NODES = 1000000;
+const uint32_t DEFAULT_FRAMES    = 100;
+const uint32_t GROUP_SIZE        = 100;
+const size_t   BATCH_SIZE        = 4096;      // INSTANCE_UPDATE_BATCH_SIZE
+
+
+static void benchmark(uint32_t nodeCount, uint32_t frames){
+    LOG_INFO_S("=== " << nodeCount << " nodes, " << frames << " frames ===");
+
+    Scene               scene;
+    std::vector<NodeId> groups;
+
+    NodeId root = scene.addNode(NodeTransform{}, NO_PARENT, false);
+
+    while (scene.getNodeCount() < nodeCount) {
+        NodeTransform groupTransform;
+        groupTransform.translation = glm::vec3(groups.size() % 100, groups.size() / 100, 0.0f) * 10.0f;
+
+        NodeId group = scene.addNode(groupTransform, root, false);
+        groups.push_back(group);
+
+        for (uint32_t i=0; i < GROUP_SIZE && scene.getNodeCount() < nodeCount; ++i) {
+            NodeTransform transform;
+            transform.translation = glm::vec3(i % 10, i / 10, 0.0f);
+            transform.rotation    = glm::angleAxis(i * 0.1f, glm::vec3(0.0f, 0.0f, 1.0f));
+            transform.scale       = glm::vec3(0.5f);
+            scene.addNode(transform, group);
+        }
+    }
+
+    scene.update();
+
+    auto report = [frames](const char* label, double seconds, uint64_t updated){
+        LOG_INFO_S(label << seconds / frames * 1000.0 << " ms/frame (" << updated / frames << " nodes recomputed)");
+    };
+
+
+    // Root moved - every world matrix gets recomputed
+    uint64_t updated = 0;
+    auto     start   = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        NodeTransform rootTransform;
+        rootTransform.rotation = glm::angleAxis(frame * 0.01f, glm::vec3(0.0f, 0.0f, 1.0f));
+        scene.setLocal(root, rootTransform);
+        updated += scene.update();
+    }
+    report("all dirty                : ", secondsSince(start), updated);
+
+
+    // 1% of the groups moved
+    updated = 0;
+    start   = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        for (size_t g=frame % 100; g < groups.size(); g += 100) {
+            NodeTransform groupTransform = scene.getLocal(groups[g]);
+            groupTransform.translation.z = frame * 0.01f;
+            scene.setLocal(groups[g], groupTransform);
+        }
+        updated += scene.update();
+    }
+    report("1% of the subtrees dirty : ", secondsSince(start), updated);
+
+
+    // Nothing moved - only the dirty flag check
+    updated = 0;
+    start   = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        updated += scene.update();
+    }
+    report("clean                    : ", secondsSince(start), updated);
+
+
+    // What Renderer::updateUniformBuffer() then writes into the frame ring
+    std::vector<InstanceData> instances(scene.getDrawnCount());
+
+    start = Clock::now();
+    for (uint32_t frame=0; frame < frames; ++frame) {
+        ThreadPool::get().parallelFor(instances.size(), BATCH_SIZE, [&](size_t begin, size_t end){
+            for (size_t i=begin; i < end; ++i) {
+                instances[i] = scene.getDrawn(static_cast<uint32_t>(i));
+            }
+        });
+    }
+    report("instance buffer copy     : ", secondsSince(start), 0);
+
+    LOG_INFO_S(ThreadPool::get().getThreadCount() << " threads, " << scene.getDrawnCount() << " drawn nodes, " << groups.size() << " groups");
+}
+
+int main(int argc, char** argv){
+    runScaling(argc, argv, 10000, DEFAULT_MAX_NODES, DEFAULT_FRAMES, benchmark);
+    finishBenchmark();
+}
@@ -0,0 +1,134 @@
+// Vertex deduplication throughput : VertexWelder vs the std::unordered_map pass it replaced
+//  Usage : VertexWelderBenchmark [model.obj] [--synthetic <million triangles>]
+//  - Defaults to the viking room model and a generated 4M triangle grid
+
+#include <vertexWelder.hpp>
+#include <objParser.hpp>
+#include <benchmarkHarness.hpp>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+
+#define DEFAULT_MODEL "../assets/models/viking_room.obj"
+
+const size_t DEFAULT_SYNTHETIC_MILLION_TRIANGLES = 4;
+
+
+// The xor/shift hash std::hash<Vertex> used before
+struct LegacyVertexHash {
+    size_t operator()(const Vertex& vertex) const{
+        return ((std::hash<glm::vec3>()(vertex.pos)              ^
+                (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+    }
+};
+
+template<typename Hash>
+static void mapWeld(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+    std::unordered_map<Vertex, uint32_t, Hash> uniqueVertices{};
+
+    vertices.clear();
+    indices.clear();
+
+    for (const auto& vertex : corners) {
+        if (uniqueVertices.count(vertex) == 0) {
+            uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertex);
+        }
+        indices.push_back(uniqueVertices[vertex]);
+    }
+}
+
+static std::vector<Vertex> loadCorners(const std::string& fileName){
+    ObjMesh mesh;
+    if (!ObjParser::load(fileName, mesh)) LOG_FATAL_S("Failed to load " << fileName);
+
+    std::vector<Vertex> corners(mesh.indices.size());
+    for (size_t i=0; i < corners.size(); ++i) {
+        corners[i].pos   = mesh.positions[mesh.indices[i].position];
+        corners[i].color = { 1.0f, 1.0f, 1.0f };
+        if (mesh.indices[i].texCoord >= 0) {
+            corners[i].texCoord = { mesh.texCoords[mesh.indices[i].texCoord].x, 1.0f - mesh.texCoords[mesh.indices[i].texCoord].y };
+        }
+    }
+    return corners;
+}
+
+// Regular grid - the kind of structured mesh the old hash collided on
+static std::vector<Vertex> gridCorners(size_t millionTriangles){
+    size_t side = static_cast<size_t>(std::sqrt(millionTriangles * 1e6 / 2.0)) + 1;
+
+    std::vector<Vertex> corners;
+    corners.reserve(side * side * 6);
+
+    auto vertexAt = [side](size_t x, size_t y){
+        Vertex vertex{};
+        vertex.pos      = { static_cast<float>(x), static_cast<float>(y), 0.0f };
+        vertex.color    = { 1.0f, 1.0f, 1.0f };
+        vertex.texCoord = { static_cast<float>(x) / side, static_cast<float>(y) / side };
+        return vertex;
+    };
+
+    for (size_t y=0; y < side; ++y) {
+        for (size_t x=0; x < side; ++x) {
+            Vertex a = vertexAt(x, y), b = vertexAt(x + 1, y), c = vertexAt(x, y + 1), d = vertexAt(x + 1, y + 1);
+            corners.insert(corners.end(), { a, b, d, a, d, c });
+        }
+    }
+    return corners;
+}
+
+static void benchmark(const std::string& name, const std::vector<Vertex>& corners){
+    LOG_INFO_S("=== " << name << " (" << corners.size() << " corners) ===");
+
+    std::vector<Vertex>   referenceVertices, vertices;
+    std::vector<uint32_t> referenceIndices, indices;
+
+    auto report = [&corners](const char* label, double seconds){
+        LOG_INFO_S(label << seconds * 1000.0 << " ms (" << corners.size() / seconds / 1e6 << " M corners/s)");
+    };
+
+    auto start = Clock::now();
+    mapWeld<LegacyVertexHash>(corners, referenceVertices, referenceIndices);
+    report("unordered_map, legacy hash : ", secondsSince(start));
+
+    start = Clock::now();
+    mapWeld<std::hash<Vertex>>(corners, vertices, indices);
+    report("unordered_map, hashBytes   : ", secondsSince(start));
+
+    start = Clock::now();
+    VertexWelder::weld(corners, vertices, indices);
+    double welderSeconds = secondsSince(start);
+    report("VertexWelder               : ", welderSeconds);
+
+    LOG_INFO_S(ThreadPool::get().getThreadCount() << " threads, " << vertices.size() << " vertices");
+
+    if (vertices.size() != referenceVertices.size() || indices != referenceIndices ||
+        !std::equal(vertices.begin(), vertices.end(), referenceVertices.begin()))
+    {
+        LOG_ERROR("VertexWelder output differs from std::unordered_map");
+    }
+}
+
+int main(int argc, char** argv){
+    std::string model     = DEFAULT_MODEL;
+    size_t      triangles = DEFAULT_SYNTHETIC_MILLION_TRIANGLES;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--synthetic" && i + 1 < argc) {
+            triangles = static_cast<size_t>(std::stoul(argv[++i]));
+        } else {
+            model = argument;
+        }
+    }
+
+    benchmark(model, loadCorners(model));
+
+    if (triangles) {
+        benchmark("synthetic grid", gridCorners(triangles));
+    }
+
+    finishBenchmark();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+// Sets in the first pool of a chain - every pool chained after it holds twice as many, up to DESCRIPTOR_POOL_MAX_SETS
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 32;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS     = 4096;
+
+
+// Descriptors of a type a pool holds per set it can allocate
+struct DescriptorPoolRatio {
+    VkDescriptorType type;
+    float            perSet;
+};
+
+
+struct DescriptorAllocatorStats {
+    uint32_t pools              = 0;         // Persistent and transient, every frame
+    uint32_t poolOverflows      = 0;         // Allocations that found their pool full and moved down the chain
+    uint32_t persistentSets     = 0;
+    uint32_t transientSets      = 0;         // Peak of a single frame
+    uint32_t frames             = 0;         // beginFrame() calls
+    uint64_t transientSetsTotal = 0;         // Over every frame
+    double   transientSeconds   = 0.0;       // Spent in allocateTransient()
+};
+
+
+// Descriptor sets out of chains of pools - a pool that runs out (of sets, or of a descriptor type) gets a bigger one chained after it
+//  - allocate() : persistent sets, freed with the allocator
+//  - allocateTransient() : sets for one frame in flight, out of that frame's own chain - beginFrame() resets the whole chain with
+//    vkResetDescriptorPool once the frame's previous submit has completed, so a transient set costs a pool bump, not a free
+//  - Sets are written through update templates built once per layout (createTemplate()), one vkUpdateDescriptorSetWithTemplate
+//    per set instead of an array of VkWriteDescriptorSet
+//  - Not thread safe - allocate and update before handing the sets to the recording threads
+class DescriptorAllocator {
+public:
+    void init(VkDevice device, const std::vector<DescriptorPoolRatio>& ratios, uint32_t frameCount);
+    void destroy();     // The device must be idle - the sets go with their pools
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    void            beginFrame(uint32_t frame);
+    VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+    // entries point into the struct passed to update(), one entry per binding (or per range of array elements)
+    VkDescriptorUpdateTemplate createTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries);
+
+    void update(VkDescriptorSet set, VkDescriptorUpdateTemplate updateTemplate, const void* data) const{
+        vkUpdateDescriptorSetWithTemplate(device, set, updateTemplate, data);
+    }
+
+    DescriptorAllocatorStats getStats() const;
+
+private:
+    // Pools filled up to current, then the ones that haven't been used since the last reset
+    struct PoolChain {
+        std::vector<VkDescriptorPool> pools;
+        size_t                        current  = 0;
+        uint32_t                      nextSets = DESCRIPTOR_POOL_INITIAL_SETS;     // Of the next pool created
+        uint32_t                      setCount = 0;                                // Since the last reset
+    };
+
+    VkDevice                                device = VK_NULL_HANDLE;
+    std::vector<DescriptorPoolRatio>        ratios;
+
+    PoolChain                               persistent;
+    std::vector<PoolChain>                  transient;          // Per frame in flight
+    uint32_t                                currentFrame = 0;
+    DescriptorAllocatorStats                stats;              // Pools and persistent sets are counted in getStats()
+
+    std::vector<VkDescriptorUpdateTemplate> templates;
+
+
+    VkDescriptorSet  allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+    VkDescriptorPool createPool(uint32_t setCount);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+// Where per frame data was written - offset is the dynamic offset to bind it with
+struct FrameAllocation {
+    uint32_t offset = 0;                      // From the start of the buffer, not of the frame's region
+    void*    mapped = nullptr;
+};
+
+
+// Linear allocator over a persistently mapped buffer split into one region per frame in flight
+//  - begin() rewinds a frame's region once its previous submit has completed, allocate() bumps through it
+//  - Only manages offsets - the buffer (and the memory behind mapped) belongs to the caller, so it can be host memory too
+class FrameRing {
+public:
+    void init(void* mapped, VkDeviceSize regionSize, uint32_t frameCount);
+
+    void begin(uint32_t frame);
+
+    // Fatal when the frame's region is full - size the ring for the largest frame
+    FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+    template<typename T>
+    T* allocate(size_t count, VkDeviceSize alignment, uint32_t& offset){
+        FrameAllocation allocation = allocate(sizeof(T) * count, std::max<VkDeviceSize>(alignment, alignof(T)));
+        offset = allocation.offset;
+        return static_cast<T*>(allocation.mapped);
+    }
+
+    VkDeviceSize getRegionSize() const;
+    VkDeviceSize getUsed() const;             // By the current frame, alignment padding included
+    VkDeviceSize getPeak() const;
+
+private:
+    char*        mapped     = nullptr;
+    VkDeviceSize regionSize = 0;
+    uint32_t     frameCount = 0;
+
+    VkDeviceSize regionStart = 0;
+    VkDeviceSize head        = 0;             // Next free byte, from the start of the buffer
+    VkDeviceSize peak        = 0;
+};
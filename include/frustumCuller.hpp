@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Objects culled per thread pool batch - a multiple of the widest kernel
+const size_t FRUSTUM_CULL_BATCH_SIZE = 8192;
+
+
+// World space bounding spheres, structure of arrays - one object per index
+struct CullBounds {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+    size_t size() const{ return radius.size(); }
+
+    void resize(size_t count){
+        centerX.resize(count);
+        centerY.resize(count);
+        centerZ.resize(count);
+        radius.resize(count);
+    }
+
+    void set(size_t index, const glm::vec3& center, float sphereRadius){
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        radius[index]  = sphereRadius;
+    }
+};
+
+
+// Instruction set the spheres are tested with - 1, 4 or 8 at a time
+enum class CullKernel {
+    SCALAR,
+    SSE,        // SSE2, x86 only
+    AVX2        // AVX2 + FMA, picked at runtime when the CPU has them
+};
+
+
+// Tests bounding spheres against the six planes of a view frustum
+//  - A sphere is visible unless it lies entirely behind one of the planes (conservative near the frustum corners)
+//  - Batches of FRUSTUM_CULL_BATCH_SIZE objects run on the thread pool, visible indices come out in ascending order
+class FrustumCuller {
+public:
+    static CullKernel  getBestKernel();                 // The widest kernel this CPU runs
+    static bool        isSupported(CullKernel kernel);
+    static const char* getKernelName(CullKernel kernel);
+
+    // Planes from the rows of a clip matrix (proj * view for world space bounds) - near plane per glm's clip depth range
+    void setFrustum(const glm::mat4& clip);
+
+    // Resizes visible to the visible objects' indices and returns their count
+    uint32_t cull(const CullBounds& bounds, std::vector<uint32_t>& visible);
+    uint32_t cull(const CullBounds& bounds, std::vector<uint32_t>& visible, CullKernel kernel, bool threaded);
+
+private:
+    // Normalized, inside when dot(plane.xyz, p) + plane.w >= 0 - one array per component for broadcasting
+    float planeX[6] = {};
+    float planeY[6] = {};
+    float planeZ[6] = {};
+    float planeW[6] = {};
+
+    std::vector<uint32_t> batchCounts;      // Visible objects per batch, before compaction
+};
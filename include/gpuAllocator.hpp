@@ -0,0 +1,85 @@
+#pragma once
+
+#include <tlsfAllocator.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+// Size of the device memory blocks sub-allocated from - smaller on heaps under 8 times as large
+const VkDeviceSize GPU_ALLOCATOR_BLOCK_SIZE = 64ull << 20;
+
+
+// Range of a device memory block (or a whole dedicated allocation) backing one buffer or image
+struct GpuAllocation {
+    VkDeviceMemory memory     = VK_NULL_HANDLE;
+    VkDeviceSize   offset     = 0;                    // To bind at
+    VkDeviceSize   size       = 0;
+    void*          mapped     = nullptr;              // Already offset - only for host visible memory, mapped for the block's lifetime
+    uint32_t       memoryType = 0;
+    uint32_t       block      = 0;                    // Index in the memory type's blocks
+    uint32_t       handle     = TlsfAllocator::INVALID_HANDLE;    // INVALID_HANDLE for dedicated allocations
+
+    bool isValid() const{ return memory != VK_NULL_HANDLE; }
+};
+
+
+struct GpuAllocatorStats {
+    uint32_t     blockCount               = 0;
+    uint32_t     dedicatedCount           = 0;
+    uint32_t     allocationCount          = 0;        // Sub-allocations + dedicated allocations
+    VkDeviceSize blockBytes               = 0;        // Reserved by blocks
+    VkDeviceSize usedBytes                = 0;        // Handed out from blocks
+    VkDeviceSize dedicatedBytes           = 0;
+    uint32_t     deviceAllocationCount    = 0;        // Live vkAllocateMemory allocations
+    uint32_t     maxDeviceAllocationCount = 0;        // maxMemoryAllocationCount
+};
+
+
+// Device memory sub-allocator - one vkAllocateMemory per block instead of per resource
+//  - Blocks are allocated per memory type and carved with a TlsfAllocator, honoring alignment and bufferImageGranularity
+//  - Host visible blocks are mapped once when allocated
+//  - Requests larger than half a block get their own (dedicated) allocation
+//  - Blocks that become empty are released, except the last one of each memory type
+class GpuAllocator {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = GPU_ALLOCATOR_BLOCK_SIZE);
+    void destroy();
+
+    uint32_t      findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    // Fatal when the memory can't be allocated, like any other failed resource creation
+    GpuAllocation allocate(const std::string& name, const VkMemoryRequirements& requirements,
+                           VkMemoryPropertyFlags properties, SuballocationType type);
+    void          free(GpuAllocation& allocation);
+
+    GpuAllocatorStats getStats() const;
+    void              logStats() const;
+
+private:
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void*          mapped = nullptr;
+        TlsfAllocator  ranges;
+    };
+
+    VkDevice                         device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize                     bufferImageGranularity   = 1;
+    uint32_t                         maxDeviceAllocationCount = 0;
+    std::array<VkDeviceSize, VK_MAX_MEMORY_TYPES> blockSizes{};
+
+    // Released blocks leave a null slot behind so the indices in live allocations stay valid
+    std::array<std::vector<std::unique_ptr<MemoryBlock>>, VK_MAX_MEMORY_TYPES> blocks;
+
+    uint32_t                         dedicatedCount        = 0;
+    VkDeviceSize                     dedicatedBytes        = 0;
+    uint32_t                         deviceAllocationCount = 0;
+
+    mutable std::mutex               mutex;
+
+
+    VkResult allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory& memory, void*& mapped);
+    void     freeDeviceMemory(VkDeviceMemory memory, void* mapped);
+};
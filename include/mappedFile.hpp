@@ -0,0 +1,33 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    bool open(const std::string& fileName);
+    void close();
+
+    bool        isOpen() const;
+    const char* data()   const;
+    size_t      size()   const;
+
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+private:
+    const char* mappedData = nullptr;
+    size_t      mappedSize = 0;
+
+#ifdef _WIN32
+    void*       fileHandle    = nullptr;
+    void*       mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <mappedFile.hpp>
+#include <meshletBuilder.hpp>
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Cooked mesh file (.vmesh) - deduplicated vertices and indices, ready to be copied into GPU buffers
+//  - Layout : MeshCacheHeader | vertices | indices | meshlets | meshlet vertices | meshlet triangles
+//             (each section 64-byte aligned, offsets stored in the header)
+//  - Every LOD is a range of the same index buffer, with its own meshlets (see MeshLod)
+//  - Vertices are Vertex or PackedVertex (see vertexFormat), indices are 16-bit for meshes under 65536 vertices
+//  - Bump MESH_CACHE_VERSION whenever the header, the Vertex layout or the cooking steps change
+
+const uint32_t MESH_CACHE_MAGIC   = 0x48534d56;    // "VMSH"
+const uint32_t MESH_CACHE_VERSION = 6;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;        // Vertex::getStride(vertexFormat) when cooked
+    uint32_t indexStride;         // 2 or 4
+    uint32_t vertexFormat;        // VertexFormat
+    uint32_t padding;
+
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t meshletCount;
+    uint64_t meshletVertexCount;  // The meshlet triangle count is indexCount / 3
+
+    uint64_t vertexOffset;        // In bytes, from the start of the file
+    uint64_t indexOffset;
+    uint64_t meshletOffset;
+    uint64_t meshletVertexOffset;
+    uint64_t meshletTriangleOffset;
+
+    float    boundsMin[3];        // Packed positions are quantized to these
+    float    boundsMax[3];
+
+    uint64_t sourceHash;          // See MeshCache::hashSource()
+    uint64_t sourceSize;
+
+    uint32_t lodCount;            // At least 1 - LOD 0 is the full mesh
+    uint32_t lodPadding;
+    MeshLod  lods[MAX_MESH_LODS];
+};
+
+
+class MeshCache {
+public:
+    // Hash of a source model file - used to detect when a cooked file is out of date
+    //  - Returns false if the file can't be read
+    static bool hashSource(const std::string& fileName, uint64_t& hash, uint64_t& size);
+
+    // packVertices stores PackedVertex - texture coordinates as unorm16 if they are all in [0, 1], half floats otherwise
+    //  - Without lods, the whole index buffer and every meshlet make up LOD 0
+    static bool write(const std::string& fileName,
+                      const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                      const std::vector<MeshLod>& lods, const MeshletData& meshletData,
+                      uint64_t sourceHash, uint64_t sourceSize,
+                      bool packVertices = false);
+
+    // Maps a cooked file - fails if it is missing, corrupt, from another version or cooked from a different source
+    bool open(const std::string& fileName, uint64_t sourceHash, uint64_t sourceSize);
+    void close();
+
+    bool                   isOpen()          const;
+    const MeshCacheHeader& getHeader()       const;
+    VertexFormat           getVertexFormat() const;
+    VkIndexType            getIndexType()    const;
+    const void*            getVertexData()   const;       // header.vertexCount * header.vertexStride bytes
+    const void*            getIndexData()    const;       // header.indexCount  * header.indexStride bytes
+    const Meshlet*         getMeshlets()         const;
+    const uint32_t*        getMeshletVertices()  const;
+    const uint32_t*        getMeshletTriangles() const;
+
+private:
+    MappedFile      file;
+    MeshCacheHeader header{};
+};
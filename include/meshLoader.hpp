@@ -0,0 +1,16 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <vertexWelder.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Builds indexed renderer geometry from model files
+class MeshLoader {
+public:
+    // Parses an OBJ file and welds identical corners into shared vertices (in order of first use)
+    static bool loadObj(const std::string& fileName,
+                        std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                        const WeldOptions& weldOptions = WeldOptions{});
+};
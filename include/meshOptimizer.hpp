@@ -0,0 +1,45 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Post-transform cache size the optimizer targets and the statistics are simulated with (FIFO)
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+
+struct MeshOptimizeOptions {
+    // ACMR growth allowed per cluster when clusters are split up for the overdraw sort (1.05 = 5%)
+    //  - Clusters start with a cold cache once sorted, so the whole mesh loses somewhat more than this
+    //  - 0 (default) keeps the vertex cache order as is - the sort costs more ACMR than it saves on the shipped model
+    float overdrawThreshold = 0.0f;
+};
+
+
+struct VertexCacheStats {
+    float acmr = 0.0f;        // Average cache miss ratio   : transformed vertices per triangle   (0.5 at best, 3 at worst)
+    float atvr = 0.0f;        // Average transform to vertex ratio : transformed vertices per vertex (1 at best)
+};
+
+
+// Reorders indexed triangle lists for the GPU - the result renders exactly the same triangles
+//  1. Triangles are reordered for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+//  2. Optionally, the triangle clusters this produces are sorted front to back from the outside of the mesh
+//     in, to reduce overdraw
+//  3. Vertices are renumbered in order of first use, so vertex fetches walk the vertex buffer linearly
+class MeshOptimizer {
+public:
+    // Runs every pass and logs the vertex cache statistics before and after
+    static void optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                         const MeshOptimizeOptions& options = MeshOptimizeOptions{});
+
+    // Writes the start of every triangle cluster (in triangles) to clusters if not null
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusters = nullptr);
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                 const std::vector<uint32_t>& clusters, float threshold);
+    // Drops vertices no triangle uses
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+const uint32_t MAX_MESH_LODS = 8;
+
+
+// One level of detail - a range of the shared index buffer and the meshlets built from it
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    float    error;               // Furthest the surface moved from LOD 0, in model units
+    uint32_t padding[3];
+};
+static_assert(sizeof(MeshLod) == 32, "MeshLod is stored as is in the mesh cache");
+
+
+struct MeshLodOptions {
+    // Triangle count of every LOD after the first, relative to LOD 0
+    std::vector<float> targetRatios = { 0.5f, 0.25f, 0.125f };
+
+    // The chain stops once a LOD keeps more than this fraction of the previous one's triangles
+    //  - Happens when the remaining vertices are all locked (complex topology, attribute seams meeting)
+    float maxKeptRatio = 0.85f;
+};
+
+
+// Quadric error metric edge collapse (Garland & Heckbert 1997)
+//  - Vertices only ever collapse onto other existing vertices, so every LOD indexes the original vertex buffer
+//  - Mesh borders and attribute seams (vertices split by texture coordinates/colors) only collapse along themselves,
+//    vertices where they meet are locked
+class MeshSimplifier {
+public:
+    // Simplifies indices down to about targetIndexCount, without moving the surface further than maxError (model units)
+    //  - Returns the error of the result
+    static float simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                          size_t targetIndexCount, float maxError, std::vector<uint32_t>& result);
+
+    // Appends every LOD after the first to indices (LOD 0 being the indices as they are), each optimized for the
+    // vertex cache - meshlets are left to MeshletBuilder
+    static void buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods,
+                          const MeshLodOptions& options = MeshLodOptions{});
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <meshSimplifier.hpp>
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+const uint32_t MESHLET_MAX_VERTICES  = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+
+// Cluster of triangles culled as a unit - matches the Meshlet struct in shaders/glsl/meshletCull.glsl (std430)
+//  - Meshlets cover consecutive triangles of the index buffer, so a meshlet can also be drawn as
+//    vkCmdDrawIndexed(triangleCount * 3, 1, triangleOffset * 3, 0, 0)
+struct Meshlet {
+    float    center[3];           // Bounding sphere, in model space
+    float    radius;
+    float    coneAxis[3];         // Normal cone - every triangle faces away from the camera if
+    float    coneCutoff;          //   dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius
+
+    uint32_t vertexOffset;        // Into MeshletData::vertices
+    uint32_t triangleOffset;      // Into MeshletData::triangles and the index buffer (in triangles)
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match its std430 layout");
+
+
+struct MeshletData {
+    std::vector<Meshlet>  meshlets;
+    std::vector<uint32_t> vertices;       // Mesh vertex index of every meshlet vertex
+    std::vector<uint32_t> triangles;      // Per triangle, 3 meshlet-local vertex indices packed as 8 bits each
+
+    void clear();
+};
+
+
+// Splits an index buffer into meshlets of at most MESHLET_MAX_VERTICES vertices / MESHLET_MAX_TRIANGLES triangles
+//  - Triangles are taken in index buffer order, so run it after MeshOptimizer (its vertex cache order keeps
+//    neighbouring triangles together, which is what makes the clusters tight)
+//  - Every LOD gets its own meshlets (MeshLod::meshletOffset / meshletCount are filled in) - the LODs must cover
+//    the index buffer in order
+class MeshletBuilder {
+public:
+    static void build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                      std::vector<MeshLod>& lods, MeshletData& meshletData);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+
+struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    size_t   offset;              // In bytes, into the mip chain data
+    size_t   size;
+};
+
+
+struct MipOptions {
+    bool srgb = true;             // Filter in linear space - RGB is decoded from sRGB and encoded back (alpha is always linear)
+    bool wrap = false;            // Filter across the edges like a repeating texture instead of clamping
+
+    // Filter RGB premultiplied by alpha (and divide it back out) - fully transparent texels don't bleed their color into
+    // cut-out edges. Off for data whose alpha isn't coverage
+    bool premultiplyAlpha = true;
+};
+
+
+// Full mip chains for RGBA8 images, down to 1x1
+//  - Every level is filtered from the one above it with a separable Lanczos-2 filter (SSE2 when available)
+//  - All levels are written back to back into one buffer, so they can go to the GPU with a single staging upload
+//  - Renderer-independent, so offline tools can generate the same chains
+class MipGenerator {
+public:
+    static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+    // Level 0 is a copy of pixels (width * height * 4 bytes)
+    static void generate(const uint8_t* pixels, uint32_t width, uint32_t height,
+                         std::vector<MipLevel>& levels, std::vector<uint8_t>& data,
+                         const MipOptions& options = MipOptions{});
+};
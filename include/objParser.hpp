@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Attribute indices of one triangle corner (0-based, -1 if the face didn't reference the attribute)
+struct ObjIndex {
+    int32_t position;
+    int32_t texCoord;
+};
+
+struct ObjMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<ObjIndex>  indices;      // Triangulated - 3 per triangle, in file order
+};
+
+
+// Multithreaded Wavefront OBJ reader
+//  - The file is memory mapped and split into line-aligned chunks that are parsed in parallel, then merged in file order
+//  - Reads 'v', 'vt' and 'f' statements, everything else (normals, groups, materials...) is skipped
+//  - Triangulation matches tinyobj: quads are split along their shorter diagonal, larger polygons are ear clipped
+class ObjParser {
+public:
+    static bool load(const std::string& fileName, ObjMesh& mesh);
+};
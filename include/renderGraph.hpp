@@ -0,0 +1,165 @@
+#pragma once
+
+#include <gpuAllocator.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+using RenderResource = uint32_t;
+
+const RenderResource NO_RESOURCE = UINT32_MAX;
+
+
+// How a pass uses a resource - the pass waits on the previous uses its use conflicts with
+//  - Legacy stage and access bits only (the ones vkCmdPipelineBarrier knows), so the graph runs without synchronization2 too
+struct ResourceAccess {
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2        access = VK_ACCESS_2_NONE;
+    VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;     // Images only
+};
+
+
+// Image owned by the graph, alive from its first pass to its last - images whose passes don't overlap share memory
+struct TransientImageDesc {
+    VkFormat           format    = VK_FORMAT_UNDEFINED;
+    VkExtent2D         extent{};
+    uint32_t           mipLevels = 1;
+    VkImageUsageFlags  usage     = 0;
+    VkImageAspectFlags aspect    = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+
+struct RenderGraphStats {
+    uint32_t     passes          = 0;
+    uint32_t     barrierBatches  = 0;         // vkCmdPipelineBarrier2 calls per execute()
+    uint32_t     imageBarriers   = 0;         // Layout transitions - every other dependency is folded into one memory barrier per batch
+    uint32_t     transientImages = 0;
+    VkDeviceSize transientBytes  = 0;         // Allocated for them
+    VkDeviceSize aliasedBytes    = 0;         // Saved by sharing memory
+};
+
+
+// Frame graph - passes declare the resources they read and write, compile() turns that into the barriers between them
+//  - Passes run in the order they were added, each behind at most one batched barrier
+//  - Read after read in the same layout needs nothing, other hazards get an execution (and memory) dependency, layout changes
+//    get an image barrier
+//  - Imported resources belong to the caller and get bound per frame (setImage(), setBuffer()) - the compiled barriers only
+//    refer to resources, so a new swapchain image or frame buffer doesn't need a recompile
+//  - compile() is a no-op until the topology changes (clear(), new resources, passes or uses)
+class RenderGraph {
+public:
+    using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+    void init(VkDevice device, GpuAllocator& allocator, bool synchronization2);
+    void destroy();     // The device must be idle
+
+    // Topology --------------------------------
+    void clear();       // Transient images are destroyed - the device must be done with them
+
+    // initial : last use before the graph runs (previous frame, or whoever wrote it) - finalLayout : left in it after the last pass,
+    // UNDEFINED leaves it in its last pass' layout
+    RenderResource importImage(const std::string& name, VkImageAspectFlags aspect, const ResourceAccess& initial, VkImageLayout finalLayout);
+    RenderResource importBuffer(const std::string& name, const ResourceAccess& initial = {});
+    RenderResource createImage(const std::string& name, const TransientImageDesc& desc);
+
+    uint32_t addPass(const std::string& name, RecordFunction record);
+    void     read(uint32_t pass, RenderResource resource, const ResourceAccess& access);
+    void     write(uint32_t pass, RenderResource resource, const ResourceAccess& access);
+
+    void compile();
+
+    // Per Frame --------------------------------
+    void setImage(RenderResource resource, VkImage image, VkImageView view = VK_NULL_HANDLE);
+    void setBuffer(RenderResource resource, VkBuffer buffer);
+
+    VkImage     getImage(RenderResource resource) const;
+    VkImageView getImageView(RenderResource resource) const;
+    VkImageView getMipView(RenderResource resource, uint32_t level) const;     // Transient images - one level, for storage image writes
+    VkBuffer    getBuffer(RenderResource resource) const;
+
+    // compile()s first if needed
+    void execute(VkCommandBuffer commandBuffer);
+
+    RenderGraphStats getStats() const;
+
+private:
+    struct Resource {
+        std::string              name;
+        bool                     isImage  = false;
+        bool                     imported = false;
+        VkImageAspectFlags       aspect   = 0;
+        ResourceAccess           initial;
+        VkImageLayout            finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        TransientImageDesc       desc;
+
+        VkImage                  image  = VK_NULL_HANDLE;
+        VkImageView              view   = VK_NULL_HANDLE;
+        VkBuffer                 buffer = VK_NULL_HANDLE;
+        std::vector<VkImageView> mipViews;                      // Transient images - one view per level
+
+        // Set by compile()
+        uint32_t                 firstPass = UINT32_MAX;
+        uint32_t                 lastPass  = 0;
+        uint32_t                 slot      = UINT32_MAX;        // Transient images - memory shared with the other images of the slot
+    };
+
+    struct Use {
+        RenderResource resource;
+        ResourceAccess access;
+        bool           write;
+    };
+
+    struct Pass {
+        std::string      name;
+        RecordFunction   record;
+        std::vector<Use> uses;                            // One per resource, merged
+    };
+
+    struct ImageBarrier {
+        RenderResource        resource;
+        VkPipelineStageFlags2 srcStages;
+        VkAccessFlags2        srcAccess;
+        VkPipelineStageFlags2 dstStages;
+        VkAccessFlags2        dstAccess;
+        VkImageLayout         oldLayout;
+        VkImageLayout         newLayout;
+    };
+
+    // Before a pass (or after the last one)
+    struct BarrierBatch {
+        VkMemoryBarrier2          memory{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2, nullptr, 0, 0, 0, 0 };
+        std::vector<ImageBarrier> images;
+
+        bool hasMemory() const{ return memory.srcStageMask || memory.dstStageMask; }
+        bool empty() const{ return !hasMemory() && images.empty(); }
+    };
+
+    struct MemorySlot {
+        GpuAllocation               memory;
+        std::vector<RenderResource> images;
+    };
+
+    VkDevice                  device           = VK_NULL_HANDLE;
+    GpuAllocator*             allocator        = nullptr;
+    bool                      synchronization2 = false;
+
+    std::vector<Resource>     resources;
+    std::vector<Pass>         passes;
+    bool                      compiled = false;
+
+    std::vector<BarrierBatch> batches;                    // passes.size() + 1
+    std::vector<MemorySlot>   slots;
+    RenderGraphStats          stats;
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers;     // Scratch, reused by every execute()
+
+
+    void use(uint32_t pass, RenderResource resource, const ResourceAccess& access, bool write);
+    void computeLifetimes();
+    void createTransientImages();
+    void destroyTransientImages();
+    void computeBarriers();
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+};
@@ -4,17 +4,45 @@
 #include <GLFW/glfw3.h>
 
 #include <utilities.hpp>
+#include <gpuAllocator.hpp>
+#include <stagingRing.hpp>
+#include <uploadBatcher.hpp>
+#include <descriptorAllocator.hpp>
+#include <frameRing.hpp>
+#include <frustumCuller.hpp>
+#include <scene.hpp>
+#include <meshCache.hpp>
+#include <meshletBuilder.hpp>
+#include <mipGenerator.hpp>
+#include <textureCache.hpp>
+#include <textureRegistry.hpp>
+#include <renderGraph.hpp>
 
 #include <bits/stdc++.h>
 
 
 #define MODEL         "../assets/models/viking_room.obj"
+#define MODEL_CACHE   "../assets/models/viking_room.vmesh"    // Cooked from MODEL - rewritten whenever MODEL changes
 #define MODEL_TEXTURE "../assets/textures/viking_room.png"
+#define MODEL_TEXTURE_CACHE "../assets/textures/viking_room.ktx2"    // Cooked from MODEL_TEXTURE - rewritten whenever MODEL_TEXTURE changes
 
 #define TEXTURE "../assets/textures/texture.jpg"
 
-#define VERTEX_SHADER_CODE   "../shaders/spirv/vert.spv"  
-#define FRAGMENT_SHADER_CODE "../shaders/spirv/frag.spv"  
+// The build compiles the shaders into its own directory and defines SHADER_DIR - shaders/compile.sh writes to the default
+#ifndef SHADER_DIR
+#define SHADER_DIR "../shaders/spirv/"
+#endif
+
+#define VERTEX_SHADER_CODE            SHADER_DIR "vert.spv"
+#define PACKED_VERTEX_SHADER_CODE     SHADER_DIR "packedVert.spv"
+#define FRAGMENT_SHADER_CODE          SHADER_DIR "frag.spv"
+#define BINDLESS_FRAGMENT_SHADER_CODE SHADER_DIR "bindlessFrag.spv"
+#define MESHLET_CULL_SHADER_CODE      SHADER_DIR "meshletCull.spv"
+#define INSTANCE_CULL_SHADER_CODE     SHADER_DIR "instanceCull.spv"
+#define OCCLUSION_CULL_SHADER_CODE    SHADER_DIR "occlusionCull.spv"
+#define DEPTH_PYRAMID_SHADER_CODE     SHADER_DIR "depthPyramid.spv"
+#define MESHLET_TASK_SHADER_CODE      SHADER_DIR "meshletTask.spv"
+#define MESHLET_MESH_SHADER_CODE      SHADER_DIR "meshletMesh.spv"
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -26,6 +54,151 @@ const std::vector<const char*> deviceExtensions = {
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Persistently mapped staging memory every upload goes through - larger uploads get a temporary buffer
+const VkDeviceSize STAGING_RING_SIZE = 32ull << 20;
+
+// Copies of the model added to the scene on a grid, drawn on top of the ones passed to Renderer::submitInstances()
+// - The meshlet paths cull and draw a single instance - more than one object keeps the indexed instanced path
+const uint32_t OBJECT_COUNT  = 64;
+const uint32_t MAX_INSTANCES = 100000;    // Per frame - range of the instance storage buffer descriptor
+
+// Persistently mapped per frame data (uniforms and MAX_INSTANCES InstanceData) - per frame in flight
+const VkDeviceSize FRAME_RING_SIZE = 16ull << 20;
+
+// Instances written by one thread pool batch
+const size_t INSTANCE_UPDATE_BATCH_SIZE = 4096;
+
+// Cook the model with quantized PackedVertex (12 bytes) instead of Vertex (32 bytes)
+const bool USE_PACKED_VERTICES = false;
+
+// Decode the texture on a worker and upload it on the transfer queue while frames are drawn with a 1x1 placeholder
+// - Needs timeline semaphores (Vulkan 1.2), the texture is loaded before the first frame otherwise
+const bool STREAM_TEXTURES = true;
+
+// Blit texture mip levels on the GPU when the format supports linear filtering - false filters them on the CPU
+// (Lanczos, in linear space) and uploads every level with the base one
+// - Streamed textures are always filtered on the CPU, blits need the graphics queue
+const bool GENERATE_MIPMAPS_ON_GPU = true;
+
+// Color of the placeholder bound until a streamed texture is resident
+const uint8_t TEXTURE_PLACEHOLDER_COLOR[4] = { 128, 128, 128, 255 };
+
+// Upload the texture block compressed (BC7/BC5/BC4, cooked into MODEL_TEXTURE_CACHE) when the device samples BC formats
+// - false, or no BC support, decodes MODEL_TEXTURE and uploads it as RGBA8
+const bool USE_COMPRESSED_TEXTURES = true;
+
+// Draw the coarsest LOD whose error projects to at most this many pixels on screen
+const float LOD_ERROR_THRESHOLD = 1.0f;
+
+// Cull the model per meshlet on the GPU - false draws the whole index buffer with a single vkCmdDrawIndexed
+// - Single object scenes only (OBJECT_COUNT of 1), the meshlet paths don't draw instances
+const bool USE_MESHLET_CULLING = true;
+
+// Frustum cull the instances and pick their LODs in a compute shader writing one indirect draw per visible instance
+// - Indexed path only, needs multiDrawIndirect and drawIndirectFirstInstance - culled and sorted on the CPU otherwise
+const bool USE_GPU_INSTANCE_CULLING = true;
+
+// Frustum cull the instances' bounding spheres on the thread pool when they aren't culled on the GPU (indexed path only)
+const bool USE_CPU_INSTANCE_CULLING = true;
+
+// Draws per secondary command buffer before recording is split across another worker
+const uint32_t MIN_DRAWS_PER_SECONDARY = 64;
+
+// Keep a frame's secondaries across frames and re-record them only when what they draw changes (draw list, instance count,
+// LOD) or they get invalidated (swapchain recreation, descriptor writes) - per frame data is read from the frame ring
+// - The mesh shader path pushes its cull constants inside the render pass and is recorded every frame
+const bool CACHE_DRAW_COMMANDS = true;
+
+// Sample every instance's material out of one partially bound, update after bind texture array (descriptor indexing,
+// Vulkan 1.2) bound once per secondary - textures get registered and retired without touching the frame sets
+// - Without it, every instance samples the model texture at binding 1 of the frame set
+const bool     USE_BINDLESS_TEXTURES     = true;
+const uint32_t BINDLESS_TEXTURE_CAPACITY = 16384;        // Slots - capped by the device's update after bind limits
+const uint32_t BINDLESS_TEXTURE_SET      = 2;            // Must match bindless.frag - set 1 is the meshlet set, or empty
+
+// Render straight into the swapchain and depth image views with vkCmdBeginRendering (Vulkan 1.3) - no render pass, and
+// no framebuffers to rebuild when the swapchain is recreated
+// - Falls back to the render pass and per image framebuffers without it
+const bool USE_DYNAMIC_RENDERING = true;
+
+// Also cull the GPU culled instances hidden behind what was drawn, against a depth pyramid (max depth mip chain) in two phases:
+// the instances in view are tested against last frame's depth and the ones that pass are drawn, then the pyramid is rebuilt
+// from that depth and the rejected ones are tested again - the ones now visible are drawn in a second pass
+// - Needs vkCmdDrawIndexedIndirectCount and dynamically indexed storage image arrays
+// - Indexed path only, which the default OBJECT_COUNT grid is drawn with - the meshlet paths aren't tested against the pyramid
+const bool USE_OCCLUSION_CULLING = true;
+
+
+// Must match meshletCull.comp / meshletCull.glsl
+const uint32_t     MESHLET_CULL_GROUP_SIZE      = 64;
+const uint32_t     MESHLET_TASK_GROUP_SIZE      = 32;
+const VkDeviceSize MESHLET_DRAW_COMMANDS_OFFSET = 16;      // Draw count, padded to 16 bytes, then the draw commands
+
+// Must match instanceCull.comp
+const uint32_t     INSTANCE_CULL_GROUP_SIZE      = 64;
+const VkDeviceSize INSTANCE_DRAW_COMMANDS_OFFSET = 16;     // Same layout as the meshlet draw buffers
+
+// Must match depthPyramid.comp
+const uint32_t     DEPTH_PYRAMID_MAX_LEVELS = 13;          // 4096x4096 down to 1x1
+const uint32_t     DEPTH_PYRAMID_TILE_SIZE  = 32;          // Level 0 texels per workgroup, in each dimension
+
+
+// Texture load - decoded (possibly on a worker), then uploaded (possibly on the transfer queue in the background)
+enum class TextureStreamState {
+    DECODING,     // Waiting on the worker
+    UPLOADING,    // Waiting on the upload batcher to complete uploadTicket
+    READY,        // Resident - swapped into each frame's descriptor set as it comes up
+    FAILED        // Couldn't be loaded, the placeholder stays bound
+};
+
+struct TextureStream {
+    TextureStreamState    state = TextureStreamState::DECODING;
+    std::future<bool>     decoded;
+
+    // Set by Renderer::decodeTexture()
+    VkFormat              format    = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t              width     = 0;
+    uint32_t              height    = 0;
+    uint32_t              mipLevels = 1;
+    std::vector<MipLevel> levels;             // The levels in the decoded data - only the first when the rest gets blitted
+    std::vector<uint8_t>  pixels;             // Uncompressed levels
+    TextureCache          cache;              // Or the compressed ones, mapped
+
+    // Upload in flight - submitted as a batch of its own
+    uint64_t              uploadTicket = 0;
+
+    std::chrono::high_resolution_clock::time_point startTime;
+
+    const uint8_t* getData() const{ return cache.isOpen()? cache.getLevelData()     : pixels.data(); }
+    size_t         getSize() const{ return cache.isOpen()? cache.getLevelDataSize() : pixels.size(); }
+};
+
+
+// Command buffers of one frame in flight - the pools are reset together once the frame's fence is signalled
+struct FrameCommands {
+    VkCommandPool                primaryPool = VK_NULL_HANDLE;
+    VkCommandBuffer              primary     = VK_NULL_HANDLE;
+    std::vector<VkCommandPool>   workerPools;         // One per thread pool thread, each only ever recorded from one task at a time
+    std::vector<VkCommandBuffer> secondaries;         // One per worker pool - the render pass contents
+    VkCommandBuffer              lateSecondary = VK_NULL_HANDLE;     // Occlusion culling's second pass - out of the first worker pool
+
+    // What the secondaries were last recorded with - reused while it matches, see CACHE_DRAW_COMMANDS
+    bool                                      recorded       = false;
+    size_t                                    secondaryCount = 0;
+    std::vector<VkDrawIndexedIndirectCommand> draws;
+    uint32_t                                  instanceCount  = 0;
+    uint32_t                                  lod            = 0;
+    std::array<uint32_t, 2>                   dynamicOffsets{};
+};
+
+
+// How the model gets drawn - picked from USE_MESHLET_CULLING and what the device supports
+enum class GeometryPath {
+    INDEXED,              // One vkCmdDrawIndexed over the whole index buffer
+    MESHLET_INDIRECT,     // Compute shader culls meshlets into indexed indirect draws
+    MESHLET_MESH_SHADER   // Task shader culls meshlets, mesh shader emits the visible ones (VK_EXT_mesh_shader)
+};
+
 
 class Renderer {
 public:
@@ -34,6 +207,21 @@ public:
 
     void init(GLFWwindow * appWindow);
 
+    // Draws a copy of the model per instance in the next frame - instanced, with one draw call per LOD the copies fall into,
+    // or a single indirect draw when they're culled on the GPU
+    //  - Copied, instances only has to live until this returns
+    void submitInstances(const std::vector<InstanceData>& instances);
+
+    // Persistent objects - every drawn node is drawn each frame, with the world matrices as of that frame's update
+    Scene& getScene();
+
+    // Bindless texture slots - the returned index is the material of the instances sampling imageView (shader read only layout)
+    //  - Slot 0 is the model texture, the material instances start with
+    //  - A retired slot is handed out again once the frames in flight are done with it, imageView has to live until then
+    //  - Without bindless textures nothing gets registered and every material samples the model texture
+    uint32_t registerTexture(VkImageView imageView, VkSampler sampler = VK_NULL_HANDLE);
+    void     retireTexture(uint32_t material);
+
     void drawFrame();
 
     void deviceWait();
@@ -51,6 +239,13 @@ private:
 
     VkPhysicalDevice             physicalDevice = VK_NULL_HANDLE;
     VkDevice                     device         = VK_NULL_HANDLE;
+    DeviceFeatureSupport         deviceFeatureSupport;
+    GpuAllocator                 gpuAllocator;
+    StagingRing                  stagingRing;
+    UploadBatcher                uploadBatcher;
+    UploadWait                   frameUploadWait;                            // Recorded into the current frame's command buffer
+
+    PFN_vkCmdDrawMeshTasksEXT    cmdDrawMeshTasks = nullptr;
 
     VkQueue                      graphicsQueue;
     VkQueue                      presentQueue;
@@ -64,47 +259,157 @@ private:
     VkExtent2D                   swapchainExtent;
     std::vector<VkImageView>     swapchainImageViews;
 
-    VkRenderPass                 renderPass;
+    bool                         dynamicRendering = false;                        // See USE_DYNAMIC_RENDERING
+    VkRenderPass                 renderPass       = VK_NULL_HANDLE;               // Render pass path only
+    VkRenderPass                 lateRenderPass   = VK_NULL_HANDLE;               // Same, loading the attachments - occlusion culling's second pass
+    VkFormat                     depthFormat      = VK_FORMAT_UNDEFINED;
 
     VkDescriptorSetLayout        descriptorSetLayout;
     VkPipelineLayout             pipelineLayout;
     VkPipeline                   graphicsPipeline;
 
-    std::vector<VkFramebuffer>   swapchainFramebuffers;
+    std::vector<VkFramebuffer>   swapchainFramebuffers;                           // Render pass path only
 
     VkImage                      depthImage;
-    VkDeviceMemory               depthImageMemory;
+    GpuAllocation                depthImageMemory;
     VkImageView                  depthImageView;
 
-    VkImage                      textureImage;
-    VkDeviceMemory               textureImageMemory;
-    VkImageView                  textureImageView;
+    VkImage                      textureImage       = VK_NULL_HANDLE;
+    GpuAllocation                textureImageMemory;
+    uint32_t                     textureMipLevels   = 1;
+    VkFormat                     textureFormat      = VK_FORMAT_R8G8B8A8_SRGB;
+    VkImageView                  textureImageView   = VK_NULL_HANDLE;
     VkSampler                    textureSampler;
+    TextureStream                textureStream;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> textureBound{};         // Per frame - the descriptor set points at textureImageView, not the placeholder
+    bool                         textureMipmapsPending = false;  // Blitted by the first frame, once the graphics queue owns the image
+
+    VkImage                      placeholderImage;
+    GpuAllocation                placeholderImageMemory;
+    VkImageView                  placeholderImageView;
 
-    std::vector<Vertex>          vertices;
+    MeshCache                    meshCache;
+    std::vector<Vertex>          vertices;             // Only used if the mesh cache couldn't be written
     std::vector<uint32_t>        vertexIndices;
+    uint32_t                     vertexCount = 0;
+    uint32_t                     indexCount  = 0;
+    VertexFormat                 vertexFormat = VertexFormat::FULL;
+    VkIndexType                  indexType    = VK_INDEX_TYPE_UINT32;
+    glm::mat4                    vertexDequantization{1.0f};        // Applied before the model matrix
     VkBuffer                     vertexBuffer;
-    VkDeviceMemory               vertexBufferMemory;
+    GpuAllocation                vertexBufferMemory;
 
     VkBuffer                     indexBuffer;
-    VkDeviceMemory               indexBufferMemory;
-
-    std::vector<VkBuffer>        uniformBuffers;
-    std::vector<VkDeviceMemory>  uniformBuffersMemory;
-    std::vector<void*>           uniformBuffersMapped;
-
-    VkDescriptorPool             descriptorPool;
+    GpuAllocation                indexBufferMemory;
+
+    std::vector<MeshLod>         lods;
+    uint32_t                     currentLod   = 0;
+    glm::vec3                    boundsCenter{0.0f};                // Model space bounding sphere, for the LOD error projection
+    float                        boundsRadius = 0.0f;
+
+    GeometryPath                 geometryPath = GeometryPath::INDEXED;
+    MeshletData                  meshletData;          // Only used if the mesh cache couldn't be written
+    uint32_t                     meshletCount = 0;
+    MeshletCullConstants         meshletCullConstants{};
+    VkBuffer                     meshletBuffer               = VK_NULL_HANDLE;
+    GpuAllocation                meshletBufferMemory;
+    VkBuffer                     meshletVertexBuffer         = VK_NULL_HANDLE;    // Mesh shader path only
+    GpuAllocation                meshletVertexBufferMemory;
+    VkBuffer                     meshletTriangleBuffer       = VK_NULL_HANDLE;
+    GpuAllocation                meshletTriangleBufferMemory;
+    std::vector<VkBuffer>        meshletDrawBuffers;                              // Indirect path only - per frame in flight
+    std::vector<GpuAllocation>   meshletDrawBuffersMemory;
+    VkDescriptorSetLayout        meshletSetLayout            = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> meshletDescriptorSets;
+    VkPipelineLayout             meshletCullPipelineLayout   = VK_NULL_HANDLE;
+    VkPipeline                   meshletCullPipeline         = VK_NULL_HANDLE;
+
+    Scene                        scene;                                           // The OBJECT_COUNT grid, drawn every frame
+    std::vector<InstanceData>    submittedInstances;                              // For the next frame only
+    std::vector<uint32_t>        instanceLods;                                    // Per instance drawn this frame
+    std::vector<uint32_t>        instanceSlots;                                   // Where each instance goes in the frame ring - grouped by LOD
+    std::vector<uint32_t>        lodInstanceCounts;                               // Per LOD - its instances start after the previous LODs'
+    uint32_t                     instanceCount = 0;
+    bool                         droppedInstancesLogged = false;                  // The meshlet paths were handed more than one instance
+
+    bool                         cpuInstanceCulling = false;                      // See USE_CPU_INSTANCE_CULLING
+    FrustumCuller                frustumCuller;
+    CullBounds                   instanceBounds;                                  // World space, per instance submitted this frame
+    std::vector<uint32_t>        visibleInstances;                                // Drawn this frame, indices into the submitted ones
+
+    bool                         gpuInstanceCulling = false;                      // See USE_GPU_INSTANCE_CULLING
+    InstanceCullConstants        instanceCullConstants{};
+    VkBuffer                     cullMeshBuffer              = VK_NULL_HANDLE;    // CullMesh, then the MeshLod ranges
+    GpuAllocation                cullMeshBufferMemory;
+    std::vector<VkBuffer>        instanceDrawBuffers;                             // Per frame in flight
+    std::vector<GpuAllocation>   instanceDrawBuffersMemory;
+    VkDescriptorSetLayout        instanceCullSetLayout       = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> instanceCullDescriptorSets;
+    VkPipelineLayout             instanceCullPipelineLayout  = VK_NULL_HANDLE;
+    VkPipeline                   instanceCullPipeline        = VK_NULL_HANDLE;
+
+    bool                         occlusionCulling = false;                        // See USE_OCCLUSION_CULLING
+    glm::mat4                    previousView{1.0f};                              // Camera of the last frame, see UniformBufferObject
+    std::vector<VkBuffer>        lateDrawBuffers;                                 // Per frame in flight - same layout as instanceDrawBuffers
+    std::vector<GpuAllocation>   lateDrawBuffersMemory;
+    std::vector<VkBuffer>        occludedInstanceBuffers;                         // Per frame in flight - count (padded to 16 bytes), then the indices
+    std::vector<GpuAllocation>   occludedInstanceBuffersMemory;
+    VkBuffer                     depthPyramidCounter         = VK_NULL_HANDLE;    // Workgroups done with their tile, see depthPyramid.comp
+    GpuAllocation                depthPyramidCounterMemory;
+    VkExtent2D                   depthPyramidExtent{};                            // Of level 0 - powers of two
+    uint32_t                     depthPyramidLevels          = 0;
+    VkSampler                    depthPyramidSampler         = VK_NULL_HANDLE;    // Nearest, clamped - only fetched from
+    VkDescriptorSetLayout        occlusionSetLayout          = VK_NULL_HANDLE;    // Set 1 of the occlusion cull pipeline - the depth pyramid
+    VkDescriptorUpdateTemplate   occlusionSetTemplate        = VK_NULL_HANDLE;
+    VkDescriptorSetLayout        depthPyramidSetLayout       = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate   depthPyramidSetTemplate     = VK_NULL_HANDLE;
+    VkPipelineLayout             depthPyramidPipelineLayout  = VK_NULL_HANDLE;
+    VkPipeline                   depthPyramidPipeline        = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, 2> depthPyramidSets{};                           // Frame being recorded - built from last frame's depth, then this frame's
+    std::array<VkDescriptorSet, 2> occlusionSets{};                              // Frame being recorded - early phase, late phase
+
+    VkBuffer                     frameRingBuffer = VK_NULL_HANDLE;                // Frame data of every frame in flight, see FrameRing
+    GpuAllocation                frameRingMemory;
+    FrameRing                    frameRing;
+    VkDeviceSize                 uniformAlignment = 1;                            // minUniformBufferOffsetAlignment
+    VkDeviceSize                 storageAlignment = 1;                            // minStorageBufferOffsetAlignment
+    std::array<uint32_t, 2>      frameDynamicOffsets{};                           // Uniforms, instances - bound with descriptorSets[currentFrame]
+
+    DescriptorAllocator          descriptorAllocator;                             // Every set but the bindless ones
     std::vector<VkDescriptorSet> descriptorSets;
 
+    bool                         bindlessTextures = false;                        // See USE_BINDLESS_TEXTURES
+    TextureRegistry              textureRegistry;
+    uint32_t                     modelTextureSlot        = 0;
+    VkDescriptorSetLayout        bindlessSetLayout       = VK_NULL_HANDLE;
+    VkDescriptorSetLayout        emptySetLayout          = VK_NULL_HANDLE;        // Set 1 of the graphics pipeline without a meshlet set
+    VkDescriptorPool             bindlessDescriptorPool  = VK_NULL_HANDLE;        // Update after bind
+    std::vector<VkDescriptorSet> bindlessDescriptorSets;                          // Per frame in flight - the same slots in each
+
     VkCommandPool                graphicsCommandPool;
     VkCommandPool                transferCommandPool;
 
-    std::vector<VkCommandBuffer> graphicsCommandBuffers;
+    std::vector<FrameCommands>   frameCommands;                                   // Per frame in flight
+    std::vector<VkDrawIndexedIndirectCommand> frameDraws;                         // CPU culled indexed path - one instanced draw per LOD in use
+    uint64_t                     drawRecordCount = 0;                             // Frames whose secondaries were (re-)recorded
+    uint64_t                     frameCount      = 0;
+
+    RenderGraph                  renderGraph;                                     // Cull, depth pyramid and main passes, with the barriers between them
+    RenderResource               swapchainResource      = NO_RESOURCE;
+    RenderResource               depthResource          = NO_RESOURCE;
+    RenderResource               drawBufferResource     = NO_RESOURCE;            // Meshlet or instance draw buffer of the frame, when culling on the GPU
+    RenderResource               lateDrawResource       = NO_RESOURCE;            // Occlusion culling only - per frame like the draw buffer
+    RenderResource               occludedResource       = NO_RESOURCE;
+    RenderResource               pyramidCounterResource = NO_RESOURCE;
+    std::array<RenderResource, 2> pyramidResources{ NO_RESOURCE, NO_RESOURCE };  // Transient - from last frame's depth, then this frame's
+    uint32_t                     frameImageIndex        = 0;                      // Swapchain image the frame being recorded renders to
 
     std::vector<VkSemaphore>     imageAvailableSemaphores;
     std::vector<VkSemaphore>     renderFinishedSemaphores;
     std::vector<VkFence>         inFlightFences;
 
+    VkSemaphore                  transferTimeline = VK_NULL_HANDLE;          // Signalled by upload batches - Vulkan 1.2 only
+
 
 
     //==================================Main Functions==================================
@@ -112,6 +417,8 @@ private:
     void createSurface();
     void pickPhysicalDevice();
     void createLogicalDevice();
+    void createGpuAllocator();
+    void createStagingRing();
     void createSwapchain();
     void createSwapchainImageViews();
     void createRenderPass();
@@ -120,17 +427,30 @@ private:
     void createCommandPools();
     void createDepthResources();
     void createFramebuffers();
+    void createPlaceholderTexture();
     void createTextureImage();
     void createTextureImageView();
     void createTextureSampler();
     void loadModel();
+    void createObjects();
+    void useMeshCache();
+    void selectGeometryPath();
+    void createMeshletCullPipeline();
+    void createInstanceCullPipeline();
+    void createDepthPyramidPipeline();
     void createVertexBuffer();
     void createIndexBuffer();
-    void createUniformBuffers();
-    void createDescriptorPool();
+    void createMeshletBuffers();
+    void createInstanceCullBuffers();
+    void submitUploads();
+    void releaseModelData();
+    void createFrameRing();
+    void createDescriptorAllocator();
     void createDescriptorSets();
-    void createGraphicsCommandBuffers();
+    void createFrameCommands();
+    void createRenderGraph();
     void createSyncObjects();
+    void createUploadBatcher();
 
     void recreateSwapchain();
     void cleanupSwapchain();
@@ -168,15 +488,16 @@ private:
     QueueFamilyIndices       findQueueFamilies(VkPhysicalDevice device);
     SwapchainSupportDetails  querySwapchainSupport(VkPhysicalDevice device);
     static std::vector<char> readFile(const std::string &fileName);
-    uint32_t                 findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     VkFormat                 findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     VkFormat                 findDepthFormat();
+    static void              findBufferConsumer(VkBufferUsageFlags usage, VkPipelineStageFlags& stages, VkAccessFlags& access);
 
 
     //---Check----------------------------------------------------------------------------
     bool checkInstanceExtensionSupport(std::vector<const char*> &extensions);
     bool checkValidationLayerSupport();
-    bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*> &extensions = deviceExtensions);
+    bool checkLinearBlitSupport(VkFormat format);
     int  rateDeviceSuitability(VkPhysicalDevice device);
     bool hasStencilComponent(VkFormat format);
 
@@ -185,6 +506,7 @@ private:
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
     VkPresentModeKHR   chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availableModes);
     VkExtent2D         chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
+    uint32_t           chooseLod(const glm::mat4& modelView, const glm::mat4& proj);
 
 
     //---Create---------------------------------------------------------------------------
@@ -193,28 +515,40 @@ private:
                                 VkDeviceSize size, 
                                 VkBufferUsageFlags usage,
                                 VkMemoryPropertyFlags properties, 
-                                VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+                                VkBuffer& buffer, GpuAllocation& bufferMemory);
+    void           createDeviceLocalBuffer(const std::string& name,
+                                           const void* data, VkDeviceSize size,
+                                           VkBufferUsageFlags usage,
+                                           VkBuffer& buffer, GpuAllocation& bufferMemory);
     void           createImage(const std::string& name, 
-                               uint32_t width, uint32_t height, 
+                               uint32_t width, uint32_t height, uint32_t mipLevels,
                                VkFormat format, VkImageTiling tiling, 
                                VkImageUsageFlags usage, 
                                VkMemoryPropertyFlags properties, 
-                               VkImage& image, VkDeviceMemory& imageMemory);
-    VkImageView    createImageView(const std::string& name, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+                               VkImage& image, GpuAllocation& imageMemory);
+    VkImageView    createImageView(const std::string& name, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1,
+                                   VkComponentMapping components = {});
+    static bool    decodeTexture(TextureStream& stream, bool compressed, bool gpuMipmaps);
 
 
     //---Modify---------------------------------------------------------------------------
-    void updateUniformBuffer(uint32_t frame);
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-
-
-    //---Copy-----------------------------------------------------------------------------
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void     updateUniformBuffer(uint32_t frame);
+    void     updateTextureStream(uint32_t frame);
+    void     writeTextureDescriptor(uint32_t frame);
+    void     writeBindlessDescriptor(uint32_t frame, uint32_t slot, VkImageView imageView, VkSampler sampler);
+    void     writeOcclusionDescriptors();
+    void     invalidateDrawCommands();
 
 
     //---Commands-------------------------------------------------------------------------
     void            recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void            recordMainPass(VkCommandBuffer commandBuffer, bool late = false);
+    void            recordDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, size_t firstDraw, size_t drawCount, bool late = false);
+    void            recordMeshletCull(VkCommandBuffer commandBuffer);
+    void            recordInstanceCull(VkCommandBuffer commandBuffer, OcclusionCullPhase phase = OcclusionCullPhase::FRUSTUM);
+    void            recordDepthPyramid(VkCommandBuffer commandBuffer, uint32_t pyramid);
+    void            generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+    void            submitTextureUpload(TextureStream& stream);
     VkCommandBuffer beginSingleTimeCommands(VkCommandPool &commandPool);
     void            endSingleTimeCommands(VkCommandBuffer &commandBuffer, VkCommandPool &commandPool, VkQueue &queue);
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Nodes recomputed by one thread pool batch
+const size_t SCENE_UPDATE_BATCH_SIZE = 4096;
+
+using NodeId = uint32_t;
+
+const NodeId NO_PARENT = UINT32_MAX;
+
+
+// Local transform of a node - applied scale, then rotation, then translation
+struct NodeTransform {
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+
+    glm::mat4 getMatrix() const;
+};
+
+
+// Transform hierarchy stored as flat arrays in level order (sorted by depth)
+//  - Every parent precedes its children, and a level only depends on the ones before it, so each level's nodes
+//    are updated in parallel batches
+//  - setLocal() marks a node dirty, update() recomputes the world matrices of the dirty nodes and their subtrees only
+//  - NodeIds are stable, nodes are re-sorted behind them when a new node lands above the deepest level
+class Scene {
+public:
+    // The parent has to exist already - drawn nodes are instances of the model, the others only group their children
+    NodeId addNode(const NodeTransform& local, NodeId parent = NO_PARENT, bool drawnNode = true, const glm::vec3& tint = glm::vec3(1.0f),
+                   uint32_t material = 0);
+
+    void                 setLocal(NodeId node, const NodeTransform& local);
+    void                 setMaterial(NodeId node, uint32_t material);        // Takes effect without an update()
+    const NodeTransform& getLocal(NodeId node) const;
+    const glm::mat4&     getWorld(NodeId node) const;      // As of the last update()
+
+    // Returns how many world matrices were recomputed
+    uint32_t update();
+
+    uint32_t getNodeCount() const;
+    uint32_t getDrawnCount() const;
+
+    // Drawn nodes in level order - world matrix, tint and material, as written to the instance buffer
+    InstanceData getDrawn(uint32_t index) const;
+
+    void clear();
+
+private:
+    // Per node, in level order
+    std::vector<uint32_t>      parents;               // Index in these arrays, or NO_PARENT
+    std::vector<NodeTransform> locals;
+    std::vector<glm::mat4>     worlds;
+    std::vector<uint8_t>       dirty;
+    std::vector<glm::vec3>     tints;
+    std::vector<uint32_t>      materials;
+    std::vector<uint32_t>      depths;
+    std::vector<NodeId>        ids;
+
+    std::vector<uint32_t>      nodeIndices;           // NodeId -> index in the arrays above
+    std::vector<uint8_t>       drawnNodes;            // Per NodeId
+    std::vector<uint32_t>      drawn;                 // Indices of the drawn nodes, in level order
+    std::vector<uint32_t>      levelOffsets;          // Level l is [levelOffsets[l], levelOffsets[l + 1])
+
+    bool                       sorted     = true;
+    uint32_t                   dirtyCount = 0;        // Nodes marked since the last update(), subtrees not included
+
+    void sort();
+    void rebuildLevels();
+};
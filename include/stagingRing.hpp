@@ -0,0 +1,85 @@
+#pragma once
+
+#include <gpuAllocator.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+// Where to write an upload's source data and copy it from
+struct StagingAllocation {
+    VkBuffer     buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;                  // Into buffer
+    void*        mapped = nullptr;            // Already offset
+};
+
+
+struct StagingRingStats {
+    VkDeviceSize capacity      = 0;
+    VkDeviceSize used          = 0;           // Allocated and not reclaimed yet, alignment and wrap padding included
+    VkDeviceSize peak          = 0;
+    uint32_t     inFlight      = 0;           // Submissions still holding ring space
+    uint32_t     overflowCount = 0;           // Uploads that didn't fit and got a temporary buffer
+};
+
+
+// Persistently mapped, host visible staging buffer handed out as a ring
+//  - allocate() bumps the head, submit() hands everything allocated since the last call over to a fence or a timeline value,
+//    reclaim() moves the tail past the submissions that have completed
+//  - A full ring waits on its oldest submission - uploads larger than the ring (or made while it is full of unsubmitted data)
+//    get a temporary buffer, released like ring space
+//  - Call reclaim() after waiting on a fence handed to submit() and before resetting it
+class StagingRing {
+public:
+    void init(VkDevice device, GpuAllocator& allocator, VkDeviceSize size, VkDeviceSize minAlignment,
+              const std::vector<uint32_t>& queueFamilies);
+    void destroy();     // The device must be idle
+
+    StagingAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+    void submit(VkFence fence);
+    void submit(VkSemaphore timeline, uint64_t value);
+    void submitCompleted();     // The copies have already been waited on (single time commands)
+
+    void reclaim();
+
+    StagingRingStats getStats() const;
+
+private:
+    // Ring space (and temporary buffers) used by one submission
+    struct Batch {
+        VkDeviceSize end      = 0;            // Where the tail moves once it completes
+        VkDeviceSize size     = 0;            // Ring bytes it holds
+        VkFence      fence    = VK_NULL_HANDLE;
+        VkSemaphore  timeline = VK_NULL_HANDLE;
+        uint64_t     value    = 0;
+        std::vector<std::pair<VkBuffer, GpuAllocation>> overflow;
+    };
+
+    VkDevice               device    = VK_NULL_HANDLE;
+    GpuAllocator*          allocator = nullptr;
+    std::vector<uint32_t>  queueFamilies;
+
+    VkBuffer               buffer = VK_NULL_HANDLE;
+    GpuAllocation          memory;
+    VkDeviceSize           capacity     = 0;
+    VkDeviceSize           minAlignment = 1;
+
+    VkDeviceSize           head = 0;          // Next free byte
+    VkDeviceSize           tail = 0;          // Oldest byte still in use
+    VkDeviceSize           used = 0;
+    VkDeviceSize           peak = 0;
+    uint32_t               overflowCount = 0;
+
+    Batch                  pending;           // Allocated since the last submit
+    std::deque<Batch>      inFlight;
+
+
+    bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    bool isComplete(const Batch& batch) const;
+    void wait(const Batch& batch) const;
+    void retire(Batch& batch);
+    void createBuffer(VkDeviceSize size, VkBuffer& stagingBuffer, GpuAllocation& stagingMemory);
+    void closePending();
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mappedFile.hpp>
+#include <mipGenerator.hpp>
+#include <textureCompressor.hpp>
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Cooked texture file (.ktx2) - a block compressed mip chain, ready to be copied into an image
+//  - Standard KTX 2.0 : header | level index | data format descriptor | key/value data | levels (smallest first)
+//  - No supercompression, a single layer and face
+//  - The hash and size of the source image, and the cooking version, are stored under TEXTURE_CACHE_SOURCE_KEY to detect stale files
+//  - Bump TEXTURE_CACHE_VERSION whenever the cooking steps change
+
+const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+const char     TEXTURE_CACHE_SOURCE_KEY[] = "VulkanApp.source";
+const uint64_t TEXTURE_CACHE_VERSION      = 2;
+
+struct Ktx2Header {
+    uint8_t  identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header is stored as is");
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+
+struct TextureCookOptions {
+    bool normalMap = false;       // BC5 from the red and green channels, filtered as linear data
+};
+
+
+class TextureCache {
+public:
+    // BC7 for color (sRGB), BC4 for single channel sources, BC5 for normal maps
+    static TextureEncoding chooseEncoding(int channelCount, const TextureCookOptions& options = TextureCookOptions{});
+    static VkFormat        getFormat(TextureEncoding encoding);
+
+    // Decodes, mips, compresses and writes a source image (anything stb_image reads)
+    static bool cook(const std::string& sourceFileName, const std::string& fileName, const TextureCookOptions& options = TextureCookOptions{});
+
+    static bool write(const std::string& fileName, TextureEncoding encoding,
+                      const std::vector<MipLevel>& levels, const std::vector<uint8_t>& data,
+                      uint64_t sourceHash, uint64_t sourceSize);
+
+    // Maps a cooked file - fails if it is missing, corrupt, in a format this loader doesn't handle or cooked from a different source
+    bool open(const std::string& fileName, uint64_t sourceHash, uint64_t sourceSize);
+    void close();
+
+    bool                         isOpen()           const;
+    const Ktx2Header&            getHeader()        const;
+    VkFormat                     getFormat()        const;
+    const std::vector<MipLevel>& getLevels()        const;    // Offsets into getLevelData()
+    const uint8_t*               getLevelData()     const;    // Every level, smallest first
+    size_t                       getLevelDataSize() const;
+
+private:
+    MappedFile            file;
+    Ktx2Header            header{};
+    std::vector<MipLevel> levels;
+    uint64_t              levelDataOffset = 0;
+    uint64_t              levelDataSize   = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <mipGenerator.hpp>
+
+#include <bits/stdc++.h>
+
+
+// Block compressed encodings - every 4x4 texel block is compressed on its own
+enum class TextureEncoding : uint32_t {
+    BC7 = 0,    // RGBA, 16 bytes per block - color textures
+    BC5 = 1,    // RG,   16 bytes per block - tangent space normal maps (Z is reconstructed in the shader)
+    BC4 = 2     // R,     8 bytes per block - single channel textures
+};
+
+
+// BC4/BC5/BC7 encoders for RGBA8 mip chains
+//  - BC4/BC5 fit each channel between its block minimum and maximum (with the 6 value + 0/255 mode as an alternative)
+//  - BC7 only uses mode 6 (one RGBA endpoint pair, 4-bit indices) : principal axis endpoints refined by least squares
+//  - Edge blocks of levels that aren't a multiple of 4 repeat the last row/column
+class TextureCompressor {
+public:
+    static uint32_t getBlockSize(TextureEncoding encoding);     // In bytes
+
+    // Compresses every level of levels/data (laid out as by MipGenerator::generate) into the same layout
+    static void compress(const std::vector<MipLevel>& levels, const std::vector<uint8_t>& data, TextureEncoding encoding,
+                         std::vector<MipLevel>& compressedLevels, std::vector<uint8_t>& compressedData);
+};
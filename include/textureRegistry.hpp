@@ -0,0 +1,33 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+
+// Slots of the bindless texture array - a slot is the material index instances sample with
+//  - allocate() hands out retired slots before growing, retire() keeps a slot out of circulation until every frame that
+//    could still sample it has completed, so its descriptor can be overwritten by the next allocate()
+//  - Only manages indices - the descriptor writes belong to the caller
+class TextureRegistry {
+public:
+    void init(uint32_t capacity, uint32_t framesInFlight);
+
+    // Fatal when every slot is taken
+    uint32_t allocate();
+    void     retire(uint32_t slot);
+
+    // Once per frame, after the fence of the frame about to be recorded was waited on - recycles the slots retired long enough ago
+    void beginFrame();
+
+    uint32_t getCapacity() const;
+    uint32_t getCount() const;                // Slots allocated and not retired
+
+private:
+    uint32_t capacity       = 0;
+    uint32_t framesInFlight = 0;
+    uint64_t frame          = 0;
+
+    uint32_t                                  nextSlot = 0;      // Never handed out past this one
+    std::vector<uint32_t>                     freeSlots;
+    std::deque<std::pair<uint64_t, uint32_t>> retiredSlots;      // Frame retired in, slot - in retirement order
+    std::vector<uint8_t>                      allocated;         // Per slot
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+
+class ThreadPool {
+public:
+    static ThreadPool& get();
+    static void destroy();
+
+
+    // Number of threads taking part in parallelFor() - workers + calling thread
+    uint32_t getThreadCount() const;
+
+    // Splits [0, count) into batches of at least minBatchSize elements and runs them on the workers and the calling thread
+    //  - Blocks until every batch has completed
+    //  - Safe to call from inside a task: the calling thread keeps consuming batches so nested calls cannot deadlock
+    void parallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t begin, size_t end)>& task);
+
+    // Runs task on a worker in the background - the future holds its result
+    //  - Without workers (single core), task runs on the calling thread before this returns
+    template<typename Task>
+    auto submit(Task&& task) -> std::future<decltype(task())>{
+        using Result = decltype(task());
+
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+        std::future<Result> future = packagedTask->get_future();
+
+        if (workers.empty()) (*packagedTask)();
+        else                 enqueue([packagedTask](){ (*packagedTask)(); });
+
+        return future;
+    }
+
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&)                 = delete;
+    ThreadPool& operator=(ThreadPool&&)      = delete;
+
+private:
+    ThreadPool();
+    ~ThreadPool();
+
+
+    static ThreadPool*                instance;
+    static std::mutex                 instanceMutex;
+
+    std::vector<std::thread>          workers;
+
+    std::deque<std::function<void()>> tasks;
+    std::mutex                        taskMutex;
+    std::condition_variable           taskAvailable;
+    bool                              stopping = false;
+
+
+    void workerLoop();
+    void enqueue(std::function<void()> task);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bits/stdc++.h>
+
+
+// What occupies a range - linear and optimal resources can't share a bufferImageGranularity page
+enum class SuballocationType : uint8_t {
+    FREE    = 0,
+    LINEAR  = 1,    // Buffers and linear images
+    OPTIMAL = 2     // Optimal tiling images
+};
+
+
+// Two-level segregated fit bookkeeping over [0, size) - only offsets, no memory is touched
+//  - Free ranges are binned by size class (power of two, split in SECOND_LEVEL_COUNT linear steps),
+//    a bitmap per level finds the smallest non-empty class that fits in O(1)
+//  - Ranges are kept in address order so freed ones coalesce with their free neighbours
+//  - Alignments must be powers of two, so must the granularity
+class TlsfAllocator {
+public:
+    static const uint32_t INVALID_HANDLE = std::numeric_limits<uint32_t>::max();
+
+    void init(uint64_t totalSize, uint64_t pageSize = 1);      // pageSize - bufferImageGranularity
+
+    // Returns a handle for free(), INVALID_HANDLE when no free range fits
+    uint32_t allocate(uint64_t allocationSize, uint64_t alignment, SuballocationType type, uint64_t& offset);
+    void     free(uint32_t handle);
+
+    uint64_t getSize()             const;
+    uint64_t getUsedSize()         const;    // Allocated sizes, not counting alignment padding
+    uint32_t getAllocationCount()  const;
+    uint32_t getFreeRangeCount()   const;
+    uint64_t getLargestFreeRange() const;
+    bool     isEmpty()             const;
+
+    // Walks every range and free list - false if the bookkeeping is inconsistent
+    bool validate() const;
+
+private:
+    static const uint32_t SECOND_LEVEL_BITS  = 4;
+    static const uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+    static const uint32_t FIRST_LEVEL_COUNT  = 64;
+    static const uint64_t SMALL_SIZE         = 256;                             // Below this, classes are SMALL_SIZE / SECOND_LEVEL_COUNT apart
+    static const uint32_t SMALL_SIZE_SHIFT   = 8;                               // log2(SMALL_SIZE)
+    static const uint32_t NONE               = std::numeric_limits<uint32_t>::max();
+
+    struct Range {
+        uint64_t          offset       = 0;
+        uint64_t          size         = 0;
+        uint64_t          usedSize     = 0;           // Requested size, when allocated
+        uint32_t          prevPhysical = NONE;        // Neighbours in address order
+        uint32_t          nextPhysical = NONE;
+        uint32_t          prevFree     = NONE;        // Neighbours in the free list of the size class
+        uint32_t          nextFree     = NONE;
+        SuballocationType type         = SuballocationType::FREE;
+    };
+
+    uint64_t              size            = 0;
+    uint64_t              granularity     = 1;
+    uint64_t              usedSize        = 0;
+    uint32_t              allocationCount = 0;
+    uint32_t              freeRangeCount  = 0;
+
+    std::vector<Range>    ranges;                     // Handles index into this
+    std::vector<uint32_t> unusedRanges;               // Merged away, size 0
+
+    uint64_t                                                     firstLevelBitmap = 0;
+    std::array<uint32_t, FIRST_LEVEL_COUNT>                      secondLevelBitmaps{};
+    std::array<uint32_t, FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT> freeLists{};      // Head of each class, NONE when empty
+
+
+    static void mapping(uint64_t rangeSize, uint32_t& firstLevel, uint32_t& secondLevel);
+    bool        findFreeList(uint32_t& firstLevel, uint32_t& secondLevel) const;
+    bool        fits(uint32_t index, uint64_t allocationSize, uint64_t alignment, SuballocationType type, uint64_t& offset) const;
+    bool        conflicts(SuballocationType a, SuballocationType b) const;
+
+    uint32_t newRange();
+    void     insertFree(uint32_t index);
+    void     removeFree(uint32_t index);
+    void     split(uint32_t index, uint64_t offset, uint64_t allocationSize);
+};
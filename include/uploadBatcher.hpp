@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stagingRing.hpp>
+#include <mipGenerator.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <bits/stdc++.h>
+
+
+// What a graphics submit has to wait on before using uploaded resources
+struct UploadWait {
+    uint64_t             value  = 0;          // On UploadBatcher::getTimeline() - 0 when there is nothing to wait on
+    VkPipelineStageFlags stages = 0;
+};
+
+
+// Collects buffer and image uploads into one transfer command buffer per batch
+//  - Source data is copied into the staging ring when an upload is recorded, the command buffer is only built by submit()
+//  - Each batch records one barrier call before its copies and one after, and is submitted with a timeline value
+//    (a fence without timeline semaphores) that isComplete() polls - nothing waits on the queue
+//  - Resources are VK_SHARING_MODE_EXCLUSIVE : when the transfer queue is from another family, the batch releases them
+//    and the graphics queue acquires them in the command buffer recordAcquires() writes to, once acquire() was called
+class UploadBatcher {
+public:
+    void init(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+              uint32_t transferFamily, uint32_t graphicsFamily,
+              StagingRing& stagingRing, VkSemaphore timeline);
+    void destroy();     // The device must be idle
+
+    // dstStages/dstAccess - how the graphics queue uses the resource first
+    void uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                      VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+
+    // levels - offsets into data, uploaded to the first levels.size() levels of an image with mipLevels levels
+    // The whole image goes from undefined to finalLayout
+    void uploadImage(VkImage image, uint32_t mipLevels, const std::vector<MipLevel>& levels, const void* data, VkDeviceSize size,
+                     VkImageLayout finalLayout, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+
+    // Submits what was recorded since the last call - returns its ticket, 0 if there was nothing to submit
+    uint64_t submit();
+    bool     isComplete(uint64_t ticket);
+
+    // The next recordAcquires() hands what the batch uploaded over to the graphics queue
+    void       acquire(uint64_t ticket);
+    UploadWait recordAcquires(VkCommandBuffer graphicsCommandBuffer);
+
+    VkSemaphore getTimeline() const;
+
+private:
+    struct BufferCopy {
+        VkBuffer     source;
+        VkBuffer     destination;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy {
+        VkBuffer                       source;
+        VkImage                        destination;
+        std::vector<VkBufferImageCopy> regions;
+    };
+
+    struct Batch {
+        uint64_t                           ticket        = 0;
+        VkCommandBuffer                    commandBuffer = VK_NULL_HANDLE;
+        VkFence                            fence         = VK_NULL_HANDLE;     // Without timeline semaphores
+
+        std::vector<VkImageMemoryBarrier>  imageTransitions;       // Undefined -> transfer destination
+        std::vector<BufferCopy>            bufferCopies;
+        std::vector<ImageCopy>             imageCopies;
+        std::vector<VkBufferMemoryBarrier> bufferReleases;
+        std::vector<VkImageMemoryBarrier>  imageReleases;
+        VkPipelineStageFlags               releaseStages = 0;      // Same family only - the release doubles as the consumer barrier
+
+        std::vector<VkBufferMemoryBarrier> bufferAcquires;         // Recorded on the graphics queue
+        std::vector<VkImageMemoryBarrier>  imageAcquires;
+        VkPipelineStageFlags               acquireStages = 0;
+        bool                               acquireRequested = false;
+
+        bool isEmpty() const{ return bufferCopies.empty() && imageCopies.empty(); }
+    };
+
+    VkDevice           device              = VK_NULL_HANDLE;
+    VkQueue            transferQueue       = VK_NULL_HANDLE;
+    VkCommandPool      transferCommandPool = VK_NULL_HANDLE;
+    uint32_t           transferFamily      = 0;
+    uint32_t           graphicsFamily      = 0;
+    StagingRing*       stagingRing         = nullptr;
+    VkSemaphore        timeline            = VK_NULL_HANDLE;
+
+    uint64_t           lastTicket = 0;
+    Batch              recording;
+    std::vector<Batch> submitted;          // Until complete and acquired
+
+
+    bool ownershipTransfer() const;
+    bool isComplete(const Batch& batch) const;
+    void retireCompleted();
+    void destroyBatch(Batch& batch);
+};
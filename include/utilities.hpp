@@ -15,6 +15,23 @@ struct QueueFamilyIndices {
 };
 
 
+// Optional device features the renderer takes advantage of when present
+struct DeviceFeatureSupport {
+    bool     meshShader                = false;      // VK_EXT_mesh_shader task + mesh shaders
+    bool     multiDrawIndirect         = false;
+    bool     drawIndirectCount         = false;      // Vulkan 1.2
+    bool     drawIndirectFirstInstance = false;      // Indirect draws with a firstInstance other than 0
+    uint32_t maxDrawIndirectCount      = 1;
+    bool     textureCompressionBC      = false;      // BC1-BC7 sampling
+    bool     timelineSemaphore         = false;      // Vulkan 1.2
+    bool     descriptorIndexing        = false;      // Vulkan 1.2 - partially bound, update after bind sampled image arrays, indexed non-uniformly
+    uint32_t maxBindlessTextures       = 0;          // Lowest of the update after bind sampler and sampled image limits
+    bool     synchronization2          = false;      // Vulkan 1.3 - vkCmdPipelineBarrier2, 64-bit stage and access masks
+    bool     dynamicRendering          = false;      // Vulkan 1.3 - vkCmdBeginRendering
+    bool     storageImageArrayIndexing = false;      // Storage image arrays indexed with dynamically uniform expressions
+};
+
+
 struct SwapchainSupportDetails {
     VkSurfaceCapabilitiesKHR        capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -22,6 +39,14 @@ struct SwapchainSupportDetails {
 };
 
 
+// Layout vertices are stored and uploaded in
+enum class VertexFormat : uint32_t {
+    FULL            = 0,    // Vertex
+    PACKED_UNORM_UV = 1,    // PackedVertex - texture coordinates all in [0, 1], stored as unorm16
+    PACKED_HALF_UV  = 2     // PackedVertex - texture coordinates stored as half floats
+};
+
+
 struct Vertex {
     glm::vec3 pos;
     glm::vec3 color;
@@ -29,8 +54,22 @@ struct Vertex {
 
     bool operator==(const Vertex& other) const;
 
-    static VkVertexInputBindingDescription                  getBindingDescription();
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+    static uint32_t                                       getStride(VertexFormat format = VertexFormat::FULL);
+    static VkVertexInputBindingDescription                getBindingDescription(VertexFormat format = VertexFormat::FULL);
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format = VertexFormat::FULL);
+};
+
+
+// Quantized Vertex - 12 bytes instead of 32, the color (always white) is dropped
+//  - Positions are unorm16 over the mesh bounds, see getDequantizationMatrix()
+struct PackedVertex {
+    uint16_t pos[4];          // w is padding - there is no 3 component 16-bit format vertex fetch must support
+    uint16_t texCoord[2];
+
+    static PackedVertex pack(const Vertex& vertex, VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Maps the unorm positions back to the [boundsMin, boundsMax] box they were quantized to
+    static glm::mat4 getDequantizationMatrix(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
 };
 
 namespace std {
@@ -40,8 +79,70 @@ namespace std {
 }
 
 
+// 64-bit non-cryptographic hash over raw bytes (wyhash-style multiply/fold mixing)
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+
+// Per frame - a dynamic uniform buffer in the frame ring (binding 0)
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::mat4 dequantization; // Quantized vertex positions to model space - shared by every instance
+    alignas(16) glm::mat4 previousView;   // Last frame's view - its depth is what occlusion culling tests against first
+};
+
+// One copy of the model - a vertex stream at VK_VERTEX_INPUT_RATE_INSTANCE (binding 1) in the frame ring
+//  - The same array is bound as a dynamic storage buffer (binding 2) for the mesh shader, which has no vertex input
+struct InstanceData {
+    alignas(16) glm::mat4 transform;      // Model matrix - the vertex dequantization comes from UniformBufferObject
+    alignas(16) glm::vec3 tint;           // Multiplies the texture color
+    uint32_t              material = 0;   // Slot of the bindless texture array sampled (see Renderer::registerTexture()) - packs into tint's 16 bytes
+
+    static VkVertexInputBindingDescription                getBindingDescription();
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+};
+
+static_assert(sizeof(InstanceData) == 80, "InstanceData has to match the std430 struct of the shaders");
+
+
+// Push constants of the meshlet culling shaders (shaders/glsl/meshletCull.glsl)
+struct MeshletCullConstants {
+    glm::vec4 frustumPlanes[6];       // Model space, normalized - inside when dot(plane.xyz, p) + plane.w >= 0
+    glm::vec3 cameraPosition;         // Model space
+    uint32_t  meshletCount;           // Meshlets of the LOD being drawn
+    uint32_t  meshletOffset;
+};
+static_assert(sizeof(MeshletCullConstants) <= 128, "Push constants are only guaranteed 128 bytes");
+
+// Push constants of the instance culling shader (shaders/glsl/instanceCull.comp)
+struct InstanceCullConstants {
+    glm::mat4 view;
+    glm::vec4 frustum;                // Side planes of the symmetric view frustum : x scale, x depth, y scale, y depth
+    float     zNear;
+    float     zFar;
+    float     lodScale;               // Pixels covered by one unit at distance 1 - |proj[1][1]| * height / 2
+    float     lodErrorThreshold;
+    uint32_t  instanceCount;
+    uint32_t  phase = 0;              // OcclusionCullPhase - ignored by instanceCull.spv
+};
+static_assert(sizeof(InstanceCullConstants) <= 128, "Push constants are only guaranteed 128 bytes");
+
+// What a dispatch of the occlusion culling shader (instanceCull.comp built with OCCLUSION_CULLING) tests the instances against
+enum class OcclusionCullPhase : uint32_t {
+    FRUSTUM = 0,    // The view frustum alone
+    EARLY   = 1,    // Last frame's depth pyramid too - the instances it rejects are kept for LATE
+    LATE    = 2     // The rejected ones, against the depth of what EARLY drew
+};
+
+// Push constants of the depth pyramid shader (shaders/glsl/depthPyramid.comp)
+struct DepthPyramidConstants {
+    glm::uvec2 size;                  // Of level 0
+    uint32_t   levelCount;
+};
+
+// Header of the instance culling mesh buffer - the model's MeshLod ranges follow it
+struct CullMesh {
+    glm::vec4 boundingSphere;         // Model space - xyz center, w radius
+    uint32_t  lodCount;
+    uint32_t  padding[3];
 };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <bits/stdc++.h>
+
+
+struct WeldOptions {
+    // 0 welds bit-identical vertices only (+0.0 and -0.0 compare equal)
+    // Otherwise positions/texture coordinates are snapped to a grid of this size before comparing, and
+    // the first corner of each cell is kept - close vertices straddling a cell boundary are not merged
+    float positionEpsilon = 0.0f;
+    float texCoordEpsilon = 0.0f;
+};
+
+
+// Merges identical triangle corners into shared vertices
+//  - Open addressing tables keyed on a 64-bit hash of the raw vertex bytes
+//  - Corners are split into contiguous shards welded in parallel, then the shard results are merged
+//    in parallel by hash partition. Vertices come out in order of first use, same as a serial
+//    std::unordered_map pass, regardless of the thread count
+class VertexWelder {
+public:
+    static void weld(const std::vector<Vertex>& corners,
+                     std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                     const WeldOptions& options = WeldOptions{});
+};
@@ -1,2 +1,11 @@
+mkdir -p spirv
 glslc glsl/shader.vert -o spirv/vert.spv
 glslc glsl/shader.frag -o spirv/frag.spv
+glslc glsl/bindless.frag -o spirv/bindlessFrag.spv
+glslc glsl/packed.vert -o spirv/packedVert.spv
+glslc glsl/meshletCull.comp -o spirv/meshletCull.spv
+glslc glsl/instanceCull.comp -o spirv/instanceCull.spv
+glslc -DOCCLUSION_CULLING glsl/instanceCull.comp -o spirv/occlusionCull.spv
+glslc glsl/depthPyramid.comp -o spirv/depthPyramid.spv
+glslc --target-env=vulkan1.2 glsl/meshlet.task -o spirv/meshletTask.spv
+glslc --target-env=vulkan1.2 glsl/meshlet.mesh -o spirv/meshletMesh.spv
@@ -0,0 +1,18 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// shader.frag sampling the instance's material out of the bindless texture array (BINDLESS_TEXTURE_SET)
+
+// Partially bound - only the slots registered by the renderer are ever indexed
+layout(set = 2, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main(){
+    // Instances of one draw can use different materials
+    outColor = texture(textures[nonuniformEXT(fragMaterial)], fragTexCoord) * vec4(fragColor, 1.0);
+}
@@ -0,0 +1,37 @@
+// Meshlet culling shared by meshletCull.comp and meshlet.task
+//  - Meshlet matches Meshlet in include/meshletBuilder.hpp, CullConstants matches MeshletCullConstants in include/utilities.hpp
+
+const uint MESHLET_TASK_GROUP_SIZE = 32;
+
+struct Meshlet {
+    vec3  center;
+    float radius;
+    vec3  coneAxis;
+    float coneCutoff;
+    uint  vertexOffset;
+    uint  triangleOffset;
+    uint  vertexCount;
+    uint  triangleCount;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Meshlets {
+    Meshlet meshlets[];
+};
+
+layout(push_constant) uniform CullConstants {
+    vec4 frustumPlanes[6];      // Model space, normalized - inside when dot(plane.xyz, p) + plane.w >= 0
+    vec3 cameraPosition;        // Model space
+    uint meshletCount;          // Meshlets of the LOD being drawn
+    uint meshletOffset;
+} cull;
+
+
+bool isMeshletVisible(Meshlet meshlet){
+    for (int i=0; i < 6; ++i) {
+        if (dot(cull.frustumPlanes[i].xyz, meshlet.center) + cull.frustumPlanes[i].w < -meshlet.radius) return false;
+    }
+
+    // Back-facing when the camera is inside the cone's "back" region
+    vec3 offset = meshlet.center - cull.cameraPosition;
+    return dot(offset, meshlet.coneAxis) < meshlet.coneCutoff * length(offset) + meshlet.radius;
+}
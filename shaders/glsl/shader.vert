@@ -1,20 +1,27 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
+    mat4 dequantization;    // Quantized positions to model space - identity for float positions
 } ubo;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
+// InstanceData - per instance (binding 1)
+layout(location = 3) in mat4 inInstanceTransform;
+layout(location = 7) in vec3 inInstanceTint;
+layout(location = 8) in uint inInstanceMaterial;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterial;
 
 void main() {
-    gl_Position  = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor    = inColor;
+    gl_Position  = ubo.proj * ubo.view * inInstanceTransform * ubo.dequantization * vec4(inPosition, 1.0);
+    fragColor    = inColor * inInstanceTint;
     fragTexCoord = inTexCoord;
+    fragMaterial = inInstanceMaterial;
 }
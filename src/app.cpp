@@ -1,5 +1,6 @@
 #include <app.hpp>
 #include <logger.hpp>
+#include <threadPool.hpp>
 
 
 // Main Functions
@@ -39,6 +40,8 @@ void App::cleanup(){
 
     glfwTerminate();
 
+    ThreadPool::destroy();
+
     Logger::get().destroy();
 }
 
@@ -0,0 +1,155 @@
+#include <descriptorAllocator.hpp>
+#include <logger.hpp>
+
+
+void DescriptorAllocator::init(VkDevice logicalDevice, const std::vector<DescriptorPoolRatio>& poolRatios, uint32_t frameCount){
+    device        = logicalDevice;
+    ratios        = poolRatios;
+    currentFrame  = 0;
+    stats         = DescriptorAllocatorStats{};
+
+    persistent = PoolChain{};
+    transient.assign(frameCount, PoolChain{});
+}
+
+void DescriptorAllocator::destroy(){
+    for (VkDescriptorUpdateTemplate updateTemplate : templates) vkDestroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+    templates.clear();
+
+    for (VkDescriptorPool pool : persistent.pools) vkDestroyDescriptorPool(device, pool, nullptr);
+    persistent = PoolChain{};
+
+    for (PoolChain& chain : transient) {
+        for (VkDescriptorPool pool : chain.pools) vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    transient.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout){
+    return allocate(persistent, layout);
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frame){
+    currentFrame = frame % transient.size();
+    ++stats.frames;
+
+    // The frame's previous submit has completed - nothing it bound is in use anymore
+    PoolChain& chain = transient[currentFrame];
+    if (chain.setCount == 0) return;
+
+    for (size_t i=0; i <= chain.current && i < chain.pools.size(); ++i) {
+        vkResetDescriptorPool(device, chain.pools[i], 0);
+    }
+
+    chain.current  = 0;
+    chain.setCount = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout){
+    auto start = std::chrono::steady_clock::now();
+
+    PoolChain&      chain = transient[currentFrame];
+    VkDescriptorSet set   = allocate(chain, layout);
+
+    stats.transientSets     = std::max(stats.transientSets, chain.setCount);
+    ++stats.transientSetsTotal;
+    stats.transientSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return set;
+}
+
+VkDescriptorUpdateTemplate DescriptorAllocator::createTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries){
+    VkDescriptorUpdateTemplateCreateInfo createInfo{};
+    createInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    createInfo.pDescriptorUpdateEntries   = entries.data();
+    createInfo.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    createInfo.descriptorSetLayout        = layout;
+
+    VkDescriptorUpdateTemplate updateTemplate;
+
+    LOG_RESULT(
+        vkCreateDescriptorUpdateTemplate(device, &createInfo, nullptr, &updateTemplate),
+        "Create descriptor update template"
+    );
+
+    templates.push_back(updateTemplate);
+    return updateTemplate;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::getStats() const{
+    DescriptorAllocatorStats result = stats;
+    result.pools          = static_cast<uint32_t>(persistent.pools.size());
+    result.persistentSets = persistent.setCount;
+
+    for (const PoolChain& chain : transient) result.pools += static_cast<uint32_t>(chain.pools.size());
+
+    return result;
+}
+
+
+// Helper Functions
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout){
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    // Out of sets or descriptors - on to the next pool of the chain, created when there's none left
+    while (true) {
+        uint32_t newPoolSets = 0;
+
+        if (chain.current == chain.pools.size()) {
+            newPoolSets = chain.nextSets;
+            chain.pools.push_back(createPool(newPoolSets));
+            chain.nextSets = std::min(chain.nextSets * 2, DESCRIPTOR_POOL_MAX_SETS);
+        }
+
+        allocInfo.descriptorPool = chain.pools[chain.current];
+
+        VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+        if (result == VK_SUCCESS) break;
+
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+            LOG_RESULT(result, "Allocate descriptor set");
+        }
+
+        // A set that doesn't fit in an empty pool of the largest size never will
+        if (newPoolSets == DESCRIPTOR_POOL_MAX_SETS) {
+            LOG_FATAL("Descriptor allocator : the set layout needs more descriptors than a pool holds - check the pool ratios");
+        }
+
+        ++chain.current;
+        ++stats.poolOverflows;
+    }
+
+    ++chain.setCount;
+    return set;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount){
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(ratios.size());
+
+    for (const DescriptorPoolRatio& ratio : ratios) {
+        poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(std::ceil(ratio.perSet * setCount))) });
+    }
+
+    VkDescriptorPoolCreateInfo createInfo{};
+    createInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    createInfo.pPoolSizes    = poolSizes.data();
+    createInfo.maxSets       = setCount;
+
+    VkDescriptorPool pool;
+
+    LOG_RESULT(
+        vkCreateDescriptorPool(device, &createInfo, nullptr, &pool),
+        "Create descriptor pool"
+    );
+
+    LOG_TRACE_S("Descriptor allocator : new pool of " << setCount << " sets");
+    return pool;
+}
@@ -0,0 +1,43 @@
+#include <frameRing.hpp>
+#include <logger.hpp>
+
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){ return (value + alignment - 1) / alignment * alignment; }
+
+
+void FrameRing::init(void* memory, VkDeviceSize size, uint32_t frames){
+    mapped      = static_cast<char*>(memory);
+    regionSize  = size;
+    frameCount  = frames;
+    regionStart = 0;
+    head        = 0;
+    peak        = 0;
+}
+
+void FrameRing::begin(uint32_t frame){
+    regionStart = regionSize * (frame % frameCount);
+    head        = regionStart;
+}
+
+FrameAllocation FrameRing::allocate(VkDeviceSize size, VkDeviceSize alignment){
+    // Regions start aligned to anything a device asks for, so aligning from the buffer start is enough
+    VkDeviceSize start = alignUp(head, std::max<VkDeviceSize>(1, alignment));
+
+    if (start + size > regionStart + regionSize) {
+        LOG_FATAL_S("Frame ring : " << size << " bytes don't fit in a " << regionSize << " byte region (" << getUsed() << " used)");
+    }
+
+    head = start + size;
+    peak = std::max(peak, getUsed());
+
+    FrameAllocation allocation{};
+    allocation.offset = static_cast<uint32_t>(start);
+    allocation.mapped = mapped + start;
+    return allocation;
+}
+
+VkDeviceSize FrameRing::getRegionSize() const{ return regionSize; }
+
+VkDeviceSize FrameRing::getUsed() const{ return head - regionStart; }
+
+VkDeviceSize FrameRing::getPeak() const{ return peak; }
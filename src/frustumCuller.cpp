@@ -0,0 +1,215 @@
+#include <frustumCuller.hpp>
+#include <threadPool.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    #include <emmintrin.h>
+    #define FRUSTUM_CULLER_SSE
+#endif
+
+// AVX2 is compiled per function and only called when the CPU reports it - MSVC only has it with /arch:AVX2
+#if defined(FRUSTUM_CULLER_SSE) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define FRUSTUM_CULLER_AVX2
+    #define FRUSTUM_CULLER_AVX2_TARGET __attribute__((target("avx2,fma")))
+#elif defined(__AVX2__)
+    #include <immintrin.h>
+    #define FRUSTUM_CULLER_AVX2
+    #define FRUSTUM_CULLER_AVX2_TARGET
+#endif
+
+
+struct Planes {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* w;
+};
+
+// Writes the indices of the visible objects of [begin, end) to out, returns how many
+using CullFunction = uint32_t (*)(const Planes& planes, const CullBounds& bounds, size_t begin, size_t end, uint32_t* out);
+
+
+static uint32_t cullScalar(const Planes& planes, const CullBounds& bounds, size_t begin, size_t end, uint32_t* out){
+    uint32_t count = 0;
+
+    for (size_t i=begin; i < end; ++i) {
+        bool inside = true;
+        for (int p=0; p < 6; ++p) {
+            float distance = bounds.centerX[i] * planes.x[p] + bounds.centerY[i] * planes.y[p] + bounds.centerZ[i] * planes.z[p] + planes.w[p];
+            inside &= (distance >= -bounds.radius[i]);
+        }
+
+        // Written either way, only kept when visible - no branch on the result
+        out[count] = static_cast<uint32_t>(i);
+        count     += inside;
+    }
+    return count;
+}
+
+#ifdef FRUSTUM_CULLER_SSE
+static uint32_t cullSse(const Planes& planes, const CullBounds& bounds, size_t begin, size_t end, uint32_t* out){
+    uint32_t count = 0;
+    size_t   i     = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 x      = _mm_loadu_ps(bounds.centerX.data() + i);
+        __m128 y      = _mm_loadu_ps(bounds.centerY.data() + i);
+        __m128 z      = _mm_loadu_ps(bounds.centerZ.data() + i);
+        __m128 negR   = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(bounds.radius.data() + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p=0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes.x[p])), _mm_mul_ps(y, _mm_set1_ps(planes.y[p]))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes.z[p])), _mm_set1_ps(planes.w[p])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negR));
+        }
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        for (uint32_t lane=0; lane < 4; ++lane) {
+            out[count] = static_cast<uint32_t>(i + lane);
+            count     += (mask >> lane) & 1;
+        }
+    }
+
+    return count + cullScalar(planes, bounds, i, end, out + count);
+}
+#endif
+
+#ifdef FRUSTUM_CULLER_AVX2
+FRUSTUM_CULLER_AVX2_TARGET
+static uint32_t cullAvx2(const Planes& planes, const CullBounds& bounds, size_t begin, size_t end, uint32_t* out){
+    uint32_t count = 0;
+    size_t   i     = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 x      = _mm256_loadu_ps(bounds.centerX.data() + i);
+        __m256 y      = _mm256_loadu_ps(bounds.centerY.data() + i);
+        __m256 z      = _mm256_loadu_ps(bounds.centerZ.data() + i);
+        __m256 negR   = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(bounds.radius.data() + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p=0; p < 6; ++p) {
+            __m256 distance = _mm256_fmadd_ps(x, _mm256_set1_ps(planes.x[p]),
+                              _mm256_fmadd_ps(y, _mm256_set1_ps(planes.y[p]),
+                              _mm256_fmadd_ps(z, _mm256_set1_ps(planes.z[p]), _mm256_set1_ps(planes.w[p]))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negR, _CMP_GE_OQ));
+        }
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        for (uint32_t lane=0; lane < 8; ++lane) {
+            out[count] = static_cast<uint32_t>(i + lane);
+            count     += (mask >> lane) & 1;
+        }
+    }
+
+    return count + cullScalar(planes, bounds, i, end, out + count);
+}
+#endif
+
+
+bool FrustumCuller::isSupported(CullKernel kernel){
+    switch (kernel) {
+        case CullKernel::SCALAR: return true;
+#ifdef FRUSTUM_CULLER_SSE
+        case CullKernel::SSE:    return true;
+#endif
+#ifdef FRUSTUM_CULLER_AVX2
+    #if defined(__GNUC__) || defined(__clang__)
+        case CullKernel::AVX2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    #else
+        case CullKernel::AVX2:   return true;
+    #endif
+#endif
+        default:                 return false;
+    }
+}
+
+CullKernel FrustumCuller::getBestKernel(){
+    static const CullKernel best = isSupported(CullKernel::AVX2)? CullKernel::AVX2 :
+                                   isSupported(CullKernel::SSE)?  CullKernel::SSE  :
+                                                                  CullKernel::SCALAR;
+    return best;
+}
+
+const char* FrustumCuller::getKernelName(CullKernel kernel){
+    switch (kernel) {
+        case CullKernel::SSE:  return "SSE";
+        case CullKernel::AVX2: return "AVX2";
+        default:               return "scalar";
+    }
+}
+
+void FrustumCuller::setFrustum(const glm::mat4& clip){
+    // Gribb & Hartmann - the near plane depends on glm's clip depth range ([0, 1] for Vulkan, see CMakeLists.txt)
+    glm::mat4 rows = glm::transpose(clip);
+
+#if GLM_CONFIG_CLIP_CONTROL & GLM_CLIP_CONTROL_ZO_BIT
+    glm::vec4 nearPlane = rows[2];
+#else
+    glm::vec4 nearPlane = rows[3] + rows[2];
+#endif
+
+    glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],       // Left, right
+        rows[3] + rows[1], rows[3] - rows[1],       // Bottom, top
+        nearPlane,         rows[3] - rows[2]        // Near, far
+    };
+
+    for (int p=0; p < 6; ++p) {
+        glm::vec4 plane = planes[p] / glm::length(glm::vec3(planes[p]));
+
+        planeX[p] = plane.x;
+        planeY[p] = plane.y;
+        planeZ[p] = plane.z;
+        planeW[p] = plane.w;
+    }
+}
+
+uint32_t FrustumCuller::cull(const CullBounds& bounds, std::vector<uint32_t>& visible){
+    return cull(bounds, visible, getBestKernel(), true);
+}
+
+uint32_t FrustumCuller::cull(const CullBounds& bounds, std::vector<uint32_t>& visible, CullKernel kernel, bool threaded){
+    // Unsupported kernels fall back to the scalar one
+    CullFunction function = cullScalar;
+#ifdef FRUSTUM_CULLER_SSE
+    if (kernel == CullKernel::SSE) function = cullSse;
+#endif
+#ifdef FRUSTUM_CULLER_AVX2
+    if (kernel == CullKernel::AVX2 && isSupported(kernel)) function = cullAvx2;
+#endif
+
+    Planes planes{ planeX, planeY, planeZ, planeW };
+
+    size_t objectCount = bounds.size();
+    size_t batchCount  = (objectCount + FRUSTUM_CULL_BATCH_SIZE - 1) / FRUSTUM_CULL_BATCH_SIZE;
+
+    // Each batch writes its visible indices at the start of its own range
+    visible.resize(objectCount);
+    batchCounts.assign(batchCount, 0);
+
+    auto cullBatches = [&](size_t first, size_t last){
+        for (size_t b=first; b < last; ++b) {
+            size_t begin = b * FRUSTUM_CULL_BATCH_SIZE;
+            size_t end   = std::min(begin + FRUSTUM_CULL_BATCH_SIZE, objectCount);
+
+            batchCounts[b] = function(planes, bounds, begin, end, visible.data() + begin);
+        }
+    };
+
+    if (threaded) ThreadPool::get().parallelFor(batchCount, 1, cullBatches);
+    else          cullBatches(0, batchCount);
+
+
+    // Compaction - batches only ever move towards the front
+    uint32_t visibleCount = 0;
+    for (size_t b=0; b < batchCount; ++b) {
+        auto batchStart = visible.begin() + b * FRUSTUM_CULL_BATCH_SIZE;
+        if (visibleCount != b * FRUSTUM_CULL_BATCH_SIZE) std::copy(batchStart, batchStart + batchCounts[b], visible.begin() + visibleCount);
+
+        visibleCount += batchCounts[b];
+    }
+
+    visible.resize(visibleCount);
+    return visibleCount;
+}
@@ -0,0 +1,224 @@
+#include <gpuAllocator.hpp>
+#include <logger.hpp>
+
+
+static double toMiB(VkDeviceSize bytes){ return bytes / (1024.0 * 1024.0); }
+
+
+void GpuAllocator::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize preferredBlockSize){
+    device = logicalDevice;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    bufferImageGranularity   = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+    maxDeviceAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+    // Small heaps (e.g. the 256 MB host visible device local one without resizable BAR) shouldn't go in a few blocks
+    for (uint32_t i=0; i < memoryProperties.memoryTypeCount; ++i) {
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+        blockSizes[i] = std::min(preferredBlockSize, std::max<VkDeviceSize>(heapSize / 8, 1ull << 20));
+    }
+
+    LOG_TRACE_S("GPU allocator : " << toMiB(preferredBlockSize) << " MiB blocks, bufferImageGranularity " << bufferImageGranularity);
+}
+
+void GpuAllocator::destroy(){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (uint32_t type=0; type < VK_MAX_MEMORY_TYPES; ++type) {
+        for (auto& block : blocks[type]) {
+            if (!block) continue;
+
+            if (!block->ranges.isEmpty()) {
+                LOG_WARNING_S("GPU allocator : " << block->ranges.getAllocationCount() << " allocations still live in a memory type " << type << " block");
+            }
+            if (!block->ranges.validate()) {
+                LOG_ERROR_S("GPU allocator : inconsistent bookkeeping in a memory type " << type << " block");
+            }
+
+            freeDeviceMemory(block->memory, block->mapped);
+        }
+        blocks[type].clear();
+    }
+
+    if (dedicatedCount > 0) {
+        LOG_WARNING_S("GPU allocator : " << dedicatedCount << " dedicated allocations still live");
+    }
+
+    device = VK_NULL_HANDLE;
+}
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const{
+    for (uint32_t i=0; i < memoryProperties.memoryTypeCount; ++i) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    LOG_FATAL("Failed to find suitable memory type");
+    abort();      // Already called in LOG_FATAL();
+}
+
+GpuAllocation GpuAllocator::allocate(const std::string& name, const VkMemoryRequirements& requirements,
+                                     VkMemoryPropertyFlags properties, SuballocationType type
+){
+    std::lock_guard<std::mutex> lock(mutex);
+
+    GpuAllocation allocation{};
+    allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    allocation.size       = requirements.size;
+
+    VkDeviceSize blockSize = blockSizes[allocation.memoryType];
+
+    if (requirements.size > blockSize / 2) {
+        LOG_RESULT(
+            allocateDeviceMemory(requirements.size, allocation.memoryType, allocation.memory, allocation.mapped),
+            "Allocate " + name + " memory (dedicated)"
+        );
+
+        ++dedicatedCount;
+        dedicatedBytes += requirements.size;
+        return allocation;
+    }
+
+    auto& typeBlocks = blocks[allocation.memoryType];
+
+    auto subAllocate = [&](uint32_t blockIndex) -> bool{
+        MemoryBlock& block = *typeBlocks[blockIndex];
+
+        uint64_t offset;
+        uint32_t handle = block.ranges.allocate(requirements.size, requirements.alignment, type, offset);
+        if (handle == TlsfAllocator::INVALID_HANDLE) return false;
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.mapped = block.mapped? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.block  = blockIndex;
+        allocation.handle = handle;
+        return true;
+    };
+
+    for (uint32_t i=0; i < typeBlocks.size(); ++i) {
+        if (typeBlocks[i] && subAllocate(i)) return allocation;
+    }
+
+    // No room left - new block, halved while the device refuses it
+    auto block = std::make_unique<MemoryBlock>();
+
+    VkResult result = allocateDeviceMemory(blockSize, allocation.memoryType, block->memory, block->mapped);
+    while (result != VK_SUCCESS && blockSize / 2 >= requirements.size) {
+        blockSize /= 2;
+        result = allocateDeviceMemory(blockSize, allocation.memoryType, block->memory, block->mapped);
+    }
+    LOG_RESULT(result, "Allocate " + name + " memory block");
+
+    block->ranges.init(blockSize, bufferImageGranularity);
+
+    auto slot = std::find(typeBlocks.begin(), typeBlocks.end(), nullptr);
+    if (slot == typeBlocks.end()) slot = typeBlocks.insert(typeBlocks.end(), nullptr);
+    *slot = std::move(block);
+
+    subAllocate(static_cast<uint32_t>(slot - typeBlocks.begin()));
+    return allocation;
+}
+
+void GpuAllocator::free(GpuAllocation& allocation){
+    if (!allocation.isValid()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.handle == TlsfAllocator::INVALID_HANDLE) {
+        freeDeviceMemory(allocation.memory, allocation.mapped);
+
+        --dedicatedCount;
+        dedicatedBytes -= allocation.size;
+
+    } else {
+        auto& typeBlocks = blocks[allocation.memoryType];
+        auto& block      = typeBlocks[allocation.block];
+
+        block->ranges.free(allocation.handle);
+
+        // Keep one block per type around so a resource recreated every resize doesn't allocate device memory each time
+        if (block->ranges.isEmpty()) {
+            size_t liveBlocks = std::count_if(typeBlocks.begin(), typeBlocks.end(), [](const auto& other){ return other != nullptr; });
+            if (liveBlocks > 1) {
+                freeDeviceMemory(block->memory, block->mapped);
+                block.reset();
+            }
+        }
+    }
+
+    allocation = GpuAllocation{};
+}
+
+GpuAllocatorStats GpuAllocator::getStats() const{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    GpuAllocatorStats stats{};
+    stats.dedicatedCount           = dedicatedCount;
+    stats.allocationCount          = dedicatedCount;
+    stats.dedicatedBytes           = dedicatedBytes;
+    stats.deviceAllocationCount    = deviceAllocationCount;
+    stats.maxDeviceAllocationCount = maxDeviceAllocationCount;
+
+    for (const auto& typeBlocks : blocks) {
+        for (const auto& block : typeBlocks) {
+            if (!block) continue;
+
+            stats.blockCount      += 1;
+            stats.allocationCount += block->ranges.getAllocationCount();
+            stats.blockBytes      += block->ranges.getSize();
+            stats.usedBytes       += block->ranges.getUsedSize();
+        }
+    }
+
+    return stats;
+}
+
+void GpuAllocator::logStats() const{
+    GpuAllocatorStats stats = getStats();
+
+    LOG_DEBUG_S("GPU memory : " << stats.allocationCount << " allocations in "
+                << stats.deviceAllocationCount << "/" << stats.maxDeviceAllocationCount << " device allocations");
+    LOG_DEBUG_S("  - " << stats.blockCount << " blocks : " << std::fixed << std::setprecision(2)
+                << toMiB(stats.usedBytes) << " / " << toMiB(stats.blockBytes) << " MiB used");
+    LOG_DEBUG_S("  - " << stats.dedicatedCount << " dedicated : " << std::fixed << std::setprecision(2)
+                << toMiB(stats.dedicatedBytes) << " MiB");
+}
+
+
+VkResult GpuAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory& memory, void*& mapped){
+    if (deviceAllocationCount >= maxDeviceAllocationCount) {
+        LOG_WARNING_S("GPU allocator : over maxMemoryAllocationCount (" << maxDeviceAllocationCount << ")");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) return result;
+
+    ++deviceAllocationCount;
+
+    mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS) freeDeviceMemory(memory, nullptr);
+    }
+
+    return result;
+}
+
+void GpuAllocator::freeDeviceMemory(VkDeviceMemory memory, void* mapped){
+    if (mapped) vkUnmapMemory(device, memory);
+    vkFreeMemory(device, memory, nullptr);
+
+    --deviceAllocationCount;
+}
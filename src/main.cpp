@@ -3,14 +3,14 @@
 // Issues:
 // ** App uses Vulkan 1.4 which might not be the latest version installed in end user machine
 // FIXED: Transfer command pool cleanup in the case of it being the same as the graphics queue
-// ** Due to relative file paths in Renderer (shader files) executable must be ran from ${PROJECT_ROOT}/bin
+// ** Due to relative file paths in Renderer (models and textures) executable must be ran from ${PROJECT_ROOT}/bin - CMake builds point it at their own shaders
 // ** The size of the window is not always WIDTH x HEIGHT due to scale (see app.cpp)
 // ** VK_PRESENT_MODE_MAILBOX_KHR is causing GPU to go 100% - solution: vsync/ max frame rate (see Renderer::chooseSwapPresentMode())
 //    - https://www.reddit.com/r/vulkan/comments/awaoy1/really_high_gpu_usage_with_small_vulkan_apps_c/
 //    - https://www.youtube.com/watch?v=FX78gvy5IR0
-// ** vkQueueWaitIdle(transferQueue); in Renderer::copyBuffer()
+// FIXED: vkQueueWaitIdle(transferQueue); in Renderer::copyBuffer() - uploads go through UploadBatcher
 // ** vkDeviceWaitIdle(device); in Renderer::recreateSwapchain()
-// ** Concurrent sharing mode for graphics x transfer queues in Renderer::createBuffer() & Renderer::createImage() 
+// FIXED: Concurrent sharing mode for graphics x transfer queues in Renderer::createBuffer() & Renderer::createImage() 
 //    - Fix : Memory barriers with VK_SHARING_MODE_EXCLUSIVE
 // ** Logger ANSI colors not working correctly in other machines
 //
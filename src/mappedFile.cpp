@@ -0,0 +1,129 @@
+#include <mappedFile.hpp>
+#include <logger.hpp>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+    if (this != &other) {
+        close();
+
+        std::swap(mappedData, other.mappedData);
+        std::swap(mappedSize, other.mappedSize);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& fileName){
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+    // Zero sized files cannot be mapped - treat them as an open, empty file
+    if (mappedSize == 0) {
+        mappedData = "";
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    mappedData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mappedData == nullptr) {
+        close();
+        return false;
+    }
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+
+    if (mappedSize == 0) {
+        ::close(file);
+        mappedData = "";
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);      // The mapping keeps its own reference to the file
+
+    if (mapping == MAP_FAILED) {
+        mappedSize = 0;
+        return false;
+    }
+
+    // Mapped files are read in full - let the kernel start reading ahead right away
+    madvise(mapping, mappedSize, MADV_WILLNEED);
+
+    mappedData = static_cast<const char*>(mapping);
+#endif
+
+    LOG_TRACE_S("Mapped file : " << fileName << " (" << mappedSize << " bytes)");
+
+    return true;
+}
+
+void MappedFile::close(){
+#ifdef _WIN32
+    if (mappingHandle != nullptr && mappedData != nullptr) UnmapViewOfFile(mappedData);
+    if (mappingHandle != nullptr) CloseHandle(static_cast<HANDLE>(mappingHandle));
+    if (fileHandle != nullptr) CloseHandle(static_cast<HANDLE>(fileHandle));
+
+    fileHandle    = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (mappedData != nullptr && mappedSize != 0) {
+        munmap(const_cast<char*>(mappedData), mappedSize);
+    }
+#endif
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+bool        MappedFile::isOpen() const{ return mappedData != nullptr; }
+const char* MappedFile::data()   const{ return mappedData; }
+size_t      MappedFile::size()   const{ return mappedSize; }
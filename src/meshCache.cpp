@@ -0,0 +1,255 @@
+#include <meshCache.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// Source files are hashed in blocks in parallel, then the block hashes are hashed together
+static const size_t HASH_BLOCK_SIZE = 16 << 20;
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment){
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+
+bool MeshCache::hashSource(const std::string& fileName, uint64_t& hash, uint64_t& size){
+    MappedFile source;
+    if (!source.open(fileName)) return false;
+
+    size_t blockCount = std::max<size_t>(1, (source.size() + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE);
+    std::vector<uint64_t> blockHashes(blockCount);
+
+    ThreadPool::get().parallelFor(blockCount, 1, [&](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            size_t offset  = i * HASH_BLOCK_SIZE;
+            size_t length  = std::min(HASH_BLOCK_SIZE, source.size() - std::min(offset, source.size()));
+            blockHashes[i] = hashBytes(source.data() + offset, length, i);
+        }
+    });
+
+    hash = hashBytes(blockHashes.data(), blockHashes.size() * sizeof(uint64_t), source.size());
+    size = source.size();
+
+    return true;
+}
+
+bool MeshCache::write(const std::string& fileName,
+                      const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                      const std::vector<MeshLod>& lods, const MeshletData& meshletData,
+                      uint64_t sourceHash, uint64_t sourceSize,
+                      bool packVertices)
+{
+    if (lods.size() > MAX_MESH_LODS) {
+        LOG_ERROR_S("Failed to write mesh cache " << fileName << " : " << lods.size() << " LODs (at most " << MAX_MESH_LODS << ")");
+        return false;
+    }
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    bool      unormTexCoords = true;
+
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+
+        unormTexCoords &= glm::all(glm::greaterThanEqual(vertex.texCoord, glm::vec2(0.0f))) &&
+                          glm::all(glm::lessThanEqual(vertex.texCoord, glm::vec2(1.0f)));
+    }
+    if (vertices.empty()) boundsMin = boundsMax = glm::vec3(0.0f);
+
+
+    // Vertex/index data in the layout it is stored in
+    VertexFormat vertexFormat = VertexFormat::FULL;
+    if (packVertices) {
+        vertexFormat = unormTexCoords? VertexFormat::PACKED_UNORM_UV : VertexFormat::PACKED_HALF_UV;
+    }
+
+    uint32_t vertexStride = Vertex::getStride(vertexFormat);
+    uint32_t indexStride  = (vertices.size() < 65536)? sizeof(uint16_t) : sizeof(uint32_t);
+
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint16_t>     narrowIndices;
+
+    const void* vertexData = vertices.data();
+    const void* indexData  = indices.data();
+
+    if (vertexFormat != VertexFormat::FULL) {
+        packedVertices.resize(vertices.size());
+        ThreadPool::get().parallelFor(vertices.size(), 1 << 14, [&](size_t begin, size_t end){
+            for (size_t i=begin; i < end; ++i) {
+                packedVertices[i] = PackedVertex::pack(vertices[i], vertexFormat, boundsMin, boundsMax);
+            }
+        });
+        vertexData = packedVertices.data();
+    }
+
+    if (indexStride == sizeof(uint16_t)) {
+        narrowIndices.assign(indices.begin(), indices.end());
+        indexData = narrowIndices.data();
+    }
+
+    // Sections in file order
+    struct Section {
+        const void* data;
+        size_t      size;
+        uint64_t*   offset;
+    };
+
+    MeshCacheHeader header{};
+
+    std::array<Section, 5> sections = {{
+        { vertexData,                   vertices.size() * vertexStride,                  &header.vertexOffset          },
+        { indexData,                    indices.size()  * indexStride,                   &header.indexOffset           },
+        { meshletData.meshlets.data(),  meshletData.meshlets.size()  * sizeof(Meshlet),  &header.meshletOffset         },
+        { meshletData.vertices.data(),  meshletData.vertices.size()  * sizeof(uint32_t), &header.meshletVertexOffset   },
+        { meshletData.triangles.data(), meshletData.triangles.size() * sizeof(uint32_t), &header.meshletTriangleOffset }
+    }};
+
+    uint64_t fileSize = sizeof(MeshCacheHeader);
+    for (Section& section : sections) {
+        *section.offset = alignOffset(fileSize, 64);
+        fileSize        = *section.offset + section.size;
+    }
+
+    header.magic              = MESH_CACHE_MAGIC;
+    header.version            = MESH_CACHE_VERSION;
+    header.vertexStride       = vertexStride;
+    header.indexStride        = indexStride;
+    header.vertexFormat       = static_cast<uint32_t>(vertexFormat);
+    header.vertexCount        = vertices.size();
+    header.indexCount         = indices.size();
+    header.meshletCount       = meshletData.meshlets.size();
+    header.meshletVertexCount = meshletData.vertices.size();
+    header.sourceHash         = sourceHash;
+    header.sourceSize         = sourceSize;
+
+    memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+
+    if (lods.empty()) {
+        header.lodCount = 1;
+        header.lods[0]  = MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0, static_cast<uint32_t>(meshletData.meshlets.size()), 0.0f, {} };
+    } else {
+        header.lodCount = static_cast<uint32_t>(lods.size());
+        std::copy(lods.begin(), lods.end(), header.lods);
+    }
+
+
+    // Written to a temporary file first so a failed write never leaves a truncated cache behind
+    std::string tempFileName = fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR_S("Failed to create mesh cache : " << fileName);
+            return false;
+        }
+
+        const char padding[64] = {};
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        uint64_t position = sizeof(header);
+        for (const Section& section : sections) {
+            file.write(padding, *section.offset - position);
+            file.write(static_cast<const char*>(section.data), section.size);
+            position = *section.offset + section.size;
+        }
+
+        if (!file.good()) {
+            LOG_ERROR_S("Failed to write mesh cache : " << fileName);
+            file.close();
+            std::remove(tempFileName.c_str());
+            return false;
+        }
+    }
+
+    // rename() replaces the old file atomically on POSIX, readers see either one - Windows needs it gone first
+#ifdef _WIN32
+    std::remove(fileName.c_str());
+#endif
+    if (std::rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+        LOG_ERROR_S("Failed to write mesh cache : " << fileName);
+        std::remove(tempFileName.c_str());
+        return false;
+    }
+
+    LOG_DEBUG_S("Wrote mesh cache " << fileName << " : " << vertices.size() << " vertices (" << sections[0].size << " bytes), "
+                << indices.size() << " indices (" << sections[1].size << " bytes), " << meshletData.meshlets.size() << " meshlets, "
+                << header.lodCount << " LODs");
+
+    return true;
+}
+
+bool MeshCache::open(const std::string& fileName, uint64_t sourceHash, uint64_t sourceSize){
+    close();
+
+    if (!file.open(fileName)) return false;
+
+    if (file.size() < sizeof(MeshCacheHeader)) {
+        LOG_WARNING_S("Mesh cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+        header.vertexFormat > static_cast<uint32_t>(VertexFormat::PACKED_HALF_UV) ||
+        header.vertexStride != Vertex::getStride(getVertexFormat()) ||
+        (header.indexStride != sizeof(uint16_t) && header.indexStride != sizeof(uint32_t)))
+    {
+        LOG_DEBUG_S("Mesh cache " << fileName << " was cooked by another version");
+        close();
+        return false;
+    }
+
+    if (header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+        LOG_DEBUG_S("Mesh cache " << fileName << " is out of date");
+        close();
+        return false;
+    }
+
+    if (header.vertexOffset % alignof(Vertex) != 0 || header.indexOffset % header.indexStride != 0 ||
+        header.meshletOffset % alignof(Meshlet) != 0 || header.meshletVertexOffset % sizeof(uint32_t) != 0 ||
+        header.meshletTriangleOffset % sizeof(uint32_t) != 0 ||
+        header.vertexOffset          + header.vertexCount        * header.vertexStride > file.size() ||
+        header.indexOffset           + header.indexCount         * header.indexStride  > file.size() ||
+        header.meshletOffset         + header.meshletCount       * sizeof(Meshlet)     > file.size() ||
+        header.meshletVertexOffset   + header.meshletVertexCount * sizeof(uint32_t)    > file.size() ||
+        header.meshletTriangleOffset + header.indexCount / 3     * sizeof(uint32_t)    > file.size())
+    {
+        LOG_WARNING_S("Mesh cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+    bool validLods = header.lodCount >= 1 && header.lodCount <= MAX_MESH_LODS;
+    for (uint32_t l=0; validLods && l < header.lodCount; ++l) {
+        const MeshLod& lod = header.lods[l];
+        validLods = uint64_t(lod.indexOffset)   + lod.indexCount   <= header.indexCount &&
+                    uint64_t(lod.meshletOffset) + lod.meshletCount <= header.meshletCount;
+    }
+
+    if (!validLods) {
+        LOG_WARNING_S("Mesh cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close(){
+    file.close();
+    header = {};
+}
+
+bool                   MeshCache::isOpen()          const{ return file.isOpen(); }
+const MeshCacheHeader& MeshCache::getHeader()       const{ return header; }
+VertexFormat           MeshCache::getVertexFormat() const{ return static_cast<VertexFormat>(header.vertexFormat); }
+VkIndexType            MeshCache::getIndexType()    const{ return (header.indexStride == sizeof(uint16_t))? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+const void*            MeshCache::getVertexData()   const{ return file.data() + header.vertexOffset; }
+const void*            MeshCache::getIndexData()    const{ return file.data() + header.indexOffset; }
+
+const Meshlet*  MeshCache::getMeshlets()         const{ return reinterpret_cast<const Meshlet*>(file.data() + header.meshletOffset); }
+const uint32_t* MeshCache::getMeshletVertices()  const{ return reinterpret_cast<const uint32_t*>(file.data() + header.meshletVertexOffset); }
+const uint32_t* MeshCache::getMeshletTriangles() const{ return reinterpret_cast<const uint32_t*>(file.data() + header.meshletTriangleOffset); }
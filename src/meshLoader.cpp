@@ -0,0 +1,43 @@
+#include <meshLoader.hpp>
+#include <objParser.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+bool MeshLoader::loadObj(const std::string& fileName,
+                         std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                         const WeldOptions& weldOptions)
+{
+    ObjMesh mesh;
+
+    if (!ObjParser::load(fileName, mesh)) {
+        return false;
+    }
+
+    // Expand every triangle corner to a full vertex, then weld identical ones
+    std::vector<Vertex> corners(mesh.indices.size());
+
+    ThreadPool::get().parallelFor(corners.size(), 1 << 14, [&](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            const ObjIndex& index  = mesh.indices[i];
+            Vertex&         vertex = corners[i];
+
+            vertex.pos = mesh.positions[index.position];
+
+            if (index.texCoord >= 0) {
+                vertex.texCoord = {
+                    mesh.texCoords[index.texCoord].x,
+                    1.0f - mesh.texCoords[index.texCoord].y
+                };
+            } else {
+                vertex.texCoord = { 0.0f, 0.0f };
+            }
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+        }
+    });
+
+    VertexWelder::weld(corners, vertices, indices, weldOptions);
+
+    return true;
+}
@@ -0,0 +1,323 @@
+#include <meshOptimizer.hpp>
+#include <logger.hpp>
+
+
+static const uint32_t NO_VERTEX = UINT32_MAX;
+
+
+// FIFO cache simulated with timestamps - a vertex is still cached while fewer than VERTEX_CACHE_SIZE
+// vertices were transformed after it
+class VertexCacheSimulator {
+public:
+    explicit VertexCacheSimulator(size_t vertexCount)
+        : timestamps(vertexCount, 0)
+    {}
+
+    bool isCached(uint32_t vertex) const{
+        return time - timestamps[vertex] <= VERTEX_CACHE_SIZE;
+    }
+
+    // Returns the number of misses (transformed vertices)
+    uint32_t access(const uint32_t* triangle){
+        uint32_t misses = 0;
+        for (int i=0; i < 3; ++i) {
+            if (!isCached(triangle[i])) {
+                timestamps[triangle[i]] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void reset(){
+        time += VERTEX_CACHE_SIZE + 1;
+    }
+
+private:
+    std::vector<uint32_t> timestamps;
+    uint32_t              time = VERTEX_CACHE_SIZE + 1;
+};
+
+
+// Vertex -> triangles adjacency, stored as one flat list with per vertex offsets
+struct VertexTriangles {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    VertexTriangles(const std::vector<uint32_t>& indices, size_t vertexCount)
+        : offsets(vertexCount + 1, 0), triangles(indices.size())
+    {
+        for (uint32_t index : indices) ++offsets[index + 1];
+        for (size_t v=0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i=0; i < indices.size(); ++i) {
+            triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    uint32_t count(uint32_t vertex) const{ return offsets[vertex + 1] - offsets[vertex]; }
+    const uint32_t* begin(uint32_t vertex) const{ return triangles.data() + offsets[vertex]; }
+    const uint32_t* end(uint32_t vertex)   const{ return triangles.data() + offsets[vertex + 1]; }
+};
+
+
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizeOptions& options){
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), &clusters);
+
+    if (options.overdrawThreshold > 0.0f) {
+        optimizeOverdraw(indices, vertices, clusters, options.overdrawThreshold);
+    }
+
+    optimizeVertexFetch(vertices, indices);
+
+    VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    LOG_INFO_S("Vertex cache (" << VERTEX_CACHE_SIZE << " entries) : ACMR " << before.acmr << " -> " << after.acmr
+               << ", ATVR " << before.atvr << " -> " << after.atvr);
+    LOG_DEBUG_S("Optimized " << indices.size() / 3 << " triangles in " << elapsedMs << " ms (" << clusters.size() << " clusters)");
+}
+
+
+//---Vertex Cache---------------------------------------------------------------------
+// Fans around one vertex at a time, emitting all of its remaining triangles, then moves on to the
+// neighbour that will still be cached (or the oldest one that won't be evicted by its own triangles).
+// When no neighbour has triangles left, restarts from the most recently used vertex that does - each
+// restart begins a new cluster
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusters){
+    size_t triangleCount = indices.size() / 3;
+
+    if (clusters) clusters->clear();
+    if (triangleCount == 0) return;
+
+    VertexTriangles adjacency(indices, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v=0; v < vertexCount; ++v) liveTriangles[v] = adjacency.count(static_cast<uint32_t>(v));
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool>     emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result(indices.size());
+
+    uint32_t time        = VERTEX_CACHE_SIZE + 1;
+    uint32_t cursor      = 0;
+    size_t   outputCount = 0;
+    uint32_t fanVertex   = indices[0];
+
+    if (clusters) clusters->push_back(0);
+
+    while (fanVertex != NO_VERTEX) {
+        candidates.clear();
+
+        for (const uint32_t* triangle=adjacency.begin(fanVertex); triangle != adjacency.end(fanVertex); ++triangle) {
+            if (emitted[*triangle]) continue;
+            emitted[*triangle] = true;
+
+            for (int i=0; i < 3; ++i) {
+                uint32_t vertex = indices[*triangle * 3 + i];
+
+                result[outputCount++] = vertex;
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+
+                if (time - timestamps[vertex] > VERTEX_CACHE_SIZE) {
+                    timestamps[vertex] = time++;
+                }
+            }
+        }
+
+        // Best neighbour : the oldest cached one whose remaining triangles won't push it out of the cache
+        uint32_t next         = NO_VERTEX;
+        int64_t  bestPriority = -1;
+
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) continue;
+
+            int64_t priority = 0;
+            if (time - timestamps[vertex] + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE) {
+                priority = time - timestamps[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next         = vertex;
+            }
+        }
+
+        // Dead end - most recently emitted vertex with triangles left, or the next one in input order
+        if (next == NO_VERTEX) {
+            while (!deadEnd.empty() && next == NO_VERTEX) {
+                uint32_t vertex = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[vertex] > 0) next = vertex;
+            }
+            while (cursor < vertexCount && next == NO_VERTEX) {
+                if (liveTriangles[cursor] > 0) next = cursor;
+                ++cursor;
+            }
+
+            if (clusters && next != NO_VERTEX) clusters->push_back(static_cast<uint32_t>(outputCount / 3));
+        }
+
+        fanVertex = next;
+    }
+
+    indices.swap(result);
+}
+
+
+//---Overdraw-------------------------------------------------------------------------
+// Sander et al. 2007 : clusters are split further wherever the vertex cache has warmed up enough that
+// cutting there keeps the cluster's ACMR within threshold, then sorted by how far out along their own
+// normal they sit from the mesh centroid - outer clusters are drawn first and occlude the inner ones
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                     const std::vector<uint32_t>& clusters, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) return;
+
+    // Soft boundaries
+    VertexCacheSimulator  cache(vertices.size());
+    std::vector<uint32_t> boundaries;
+
+    for (size_t c=0; c < clusters.size(); ++c) {
+        uint32_t begin = clusters[c];
+        uint32_t end   = (c + 1 < clusters.size())? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        cache.reset();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t=begin; t < end; ++t) clusterMisses += cache.access(&indices[t * 3]);
+
+        float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+        cache.reset();
+        boundaries.push_back(begin);
+
+        uint32_t misses = 0, count = 0;
+        for (uint32_t t=begin; t < end; ++t) {
+            misses += cache.access(&indices[t * 3]);
+            ++count;
+
+            if (t + 1 < end && static_cast<float>(misses) / count <= clusterThreshold) {
+                boundaries.push_back(t + 1);
+                misses = count = 0;
+                cache.reset();
+            }
+        }
+    }
+
+
+    // Cluster centroids/normals, area weighted
+    size_t clusterCount = boundaries.size();
+    boundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    std::vector<float>     areas(clusterCount, 0.0f);
+
+    glm::vec3 meshCentroid(0.0f);
+    float     meshArea = 0.0f;
+
+    for (size_t c=0; c < clusterCount; ++c) {
+        for (uint32_t t=boundaries[c]; t < boundaries[c + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].pos;
+
+            glm::vec3 normal   = glm::cross(b - a, d - a);
+            float     area     = glm::length(normal);
+            glm::vec3 centroid = (a + b + d) / 3.0f;
+
+            centroids[c] += centroid * area;
+            normals[c]   += normal;
+            areas[c]     += area;
+        }
+
+        meshCentroid += centroids[c];
+        meshArea     += areas[c];
+    }
+
+    meshCentroid /= std::max(meshArea, 1e-30f);
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c=0; c < clusterCount; ++c) {
+        glm::vec3 centroid = centroids[c] / std::max(areas[c], 1e-30f);
+        float     length   = glm::length(normals[c]);
+        glm::vec3 normal   = (length > 0.0f)? normals[c] / length : glm::vec3(0.0f);
+
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b){
+        return sortKeys[a] > sortKeys[b];
+    });
+
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices.begin() + boundaries[c] * 3, indices.begin() + boundaries[c + 1] * 3);
+    }
+
+    indices.swap(result);
+}
+
+
+//---Vertex Fetch---------------------------------------------------------------------
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex>   result;
+    result.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+
+//---Statistics-----------------------------------------------------------------------
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount){
+    VertexCacheStats stats{};
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return stats;
+
+    VertexCacheSimulator cache(vertexCount);
+    std::vector<bool>    used(vertexCount, false);
+
+    size_t misses = 0, usedCount = 0;
+    for (size_t t=0; t < triangleCount; ++t) {
+        misses += cache.access(&indices[t * 3]);
+
+        for (int i=0; i < 3; ++i) {
+            if (!used[indices[t * 3 + i]]) {
+                used[indices[t * 3 + i]] = true;
+                ++usedCount;
+            }
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / triangleCount;
+    stats.atvr = static_cast<float>(misses) / usedCount;
+
+    return stats;
+}
@@ -0,0 +1,479 @@
+#include <meshSimplifier.hpp>
+#include <meshOptimizer.hpp>
+#include <logger.hpp>
+
+
+static const uint32_t NO_VERTEX   = UINT32_MAX;
+static const uint32_t MANY_VERTEX = UINT32_MAX - 1;       // More than one open edge
+
+// Open edges get quadrics of planes standing on them, so sliding off the outline costs like leaving the surface
+static const float BORDER_WEIGHT = 10.0f;
+static const float SEAM_WEIGHT   = 1.0f;
+
+// A pass only takes collapses up to the error of this many times the collapses it still needs - keeps one pass
+// from eating into expensive collapses while cheap ones are only blocked by their neighbours
+static const float PASS_COLLAPSE_MARGIN = 1.5f;
+
+
+enum class VertexKind : uint8_t {
+    MANIFOLD,       // Interior vertex - collapses onto any neighbour
+    BORDER,         // On one open edge loop of the mesh - collapses along it
+    SEAM,           // One of two vertices split by their attributes - both collapse together along the seam
+    LOCKED          // Anything else (corners, seams meeting, non-manifold) - never moves
+};
+
+
+// Sum of weighted squared distances to planes - upper half of a symmetric 4x4 matrix
+struct Quadric {
+    float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+    float a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+    float b0  = 0.0f, b1  = 0.0f, b2  = 0.0f;
+    float c   = 0.0f;
+    float weight = 0.0f;
+
+    static Quadric fromPlane(const glm::vec3& normal, float distance, float weight){
+        Quadric quadric;
+        quadric.a00    = normal.x * normal.x * weight;
+        quadric.a11    = normal.y * normal.y * weight;
+        quadric.a22    = normal.z * normal.z * weight;
+        quadric.a10    = normal.y * normal.x * weight;
+        quadric.a20    = normal.z * normal.x * weight;
+        quadric.a21    = normal.z * normal.y * weight;
+        quadric.b0     = normal.x * distance * weight;
+        quadric.b1     = normal.y * distance * weight;
+        quadric.b2     = normal.z * distance * weight;
+        quadric.c      = distance * distance * weight;
+        quadric.weight = weight;
+        return quadric;
+    }
+
+    Quadric& operator+=(const Quadric& other){
+        a00 += other.a00; a11 += other.a11; a22 += other.a22;
+        a10 += other.a10; a20 += other.a20; a21 += other.a21;
+        b0  += other.b0;  b1  += other.b1;  b2  += other.b2;
+        c   += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances from p to the planes
+    float error(const glm::vec3& p) const{
+        float quadratic = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                          2.0f * (a10 * p.x * p.y + a20 * p.x * p.z + a21 * p.y * p.z);
+        float linear    = 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z);
+
+        return (weight > 0.0f)? std::fabs(quadratic + linear + c) / weight : 0.0f;
+    }
+};
+
+
+// Directed edges (a -> b for every triangle corner a followed by b), stored as one flat list with per vertex offsets
+struct EdgeAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> targets;
+
+    EdgeAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+        : offsets(vertexCount + 1, 0), targets(indices.size())
+    {
+        for (uint32_t index : indices) ++offsets[index + 1];
+        for (size_t v=0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i=0; i < indices.size(); ++i) {
+            size_t next = (i % 3 == 2)? i - 2 : i + 1;
+            targets[cursors[indices[i]]++] = indices[next];
+        }
+    }
+
+    bool hasEdge(uint32_t a, uint32_t b) const{
+        for (uint32_t e=offsets[a]; e < offsets[a + 1]; ++e) {
+            if (targets[e] == b) return true;
+        }
+        return false;
+    }
+};
+
+
+// Vertex -> triangles, same layout
+struct VertexTriangles {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    VertexTriangles(const std::vector<uint32_t>& indices, size_t vertexCount)
+        : offsets(vertexCount + 1, 0), triangles(indices.size())
+    {
+        for (uint32_t index : indices) ++offsets[index + 1];
+        for (size_t v=0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+        std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i=0; i < indices.size(); ++i) {
+            triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+
+struct Collapse {
+    uint32_t vertex;
+    uint32_t target;
+    float    error;
+};
+
+
+// remap : first vertex with the same position - wedges : next vertex with the same position (a ring)
+static void buildPositionRemap(const std::vector<Vertex>& vertices, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedges){
+    size_t vertexCount = vertices.size();
+
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&vertices](uint32_t a, uint32_t b){
+        const glm::vec3& pa = vertices[a].pos;
+        const glm::vec3& pb = vertices[b].pos;
+        return std::tie(pa.x, pa.y, pa.z, a) < std::tie(pb.x, pb.y, pb.z, b);
+    });
+
+    remap.resize(vertexCount);
+    wedges.resize(vertexCount);
+
+    for (size_t begin=0, end=0; begin < vertexCount; begin = end) {
+        end = begin + 1;
+        while (end < vertexCount && vertices[order[end]].pos == vertices[order[begin]].pos) ++end;
+
+        for (size_t i=begin; i < end; ++i) {
+            remap[order[i]]  = order[begin];
+            wedges[order[i]] = order[(i + 1 < end)? i + 1 : begin];
+        }
+    }
+}
+
+static void addOpenEdge(std::vector<uint32_t>& loop, uint32_t vertex, uint32_t next){
+    loop[vertex] = (loop[vertex] == NO_VERTEX || loop[vertex] == next)? next : MANY_VERTEX;
+}
+
+// A collapse onto a neighbour that was itself collapsed keeps the loop going through its old next vertex
+static void remapEdgeLoop(std::vector<uint32_t>& loop, const std::vector<uint32_t>& collapseRemap){
+    for (size_t v=0; v < loop.size(); ++v) {
+        if (loop[v] >= MANY_VERTEX) continue;
+
+        uint32_t next = collapseRemap[loop[v]];
+        if (next == v) {
+            next = (loop[loop[v]] < MANY_VERTEX)? collapseRemap[loop[loop[v]]] : NO_VERTEX;
+        }
+        loop[v] = (next == v)? NO_VERTEX : next;
+    }
+}
+
+
+float MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                               size_t targetIndexCount, float maxError, std::vector<uint32_t>& result)
+{
+    result = indices;
+
+    size_t vertexCount = vertices.size();
+    if (indices.size() <= targetIndexCount || vertexCount == 0) return 0.0f;
+
+
+    // Positions scaled into the unit cube, so the quadrics don't depend on the size of the model
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t index : indices) {
+        boundsMin = glm::min(boundsMin, vertices[index].pos);
+        boundsMax = glm::max(boundsMax, vertices[index].pos);
+    }
+
+    float extent = std::max({ boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z });
+    if (extent <= 0.0f) extent = 1.0f;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t v=0; v < vertexCount; ++v) {
+        positions[v] = (vertices[v].pos - boundsMin) / extent;
+    }
+
+    std::vector<uint32_t> remap, wedges;
+    buildPositionRemap(vertices, remap, wedges);
+
+
+    // Open edges (no opposite edge between the same vertices) - per vertex, the one leaving and the one arriving
+    EdgeAdjacency adjacency(indices, vertexCount);
+
+    std::vector<uint32_t> openOut(vertexCount, NO_VERTEX);
+    std::vector<uint32_t> openIn(vertexCount, NO_VERTEX);
+
+    for (size_t i=0; i < indices.size(); ++i) {
+        uint32_t a = indices[i];
+        uint32_t b = indices[(i % 3 == 2)? i - 2 : i + 1];
+
+        if (!adjacency.hasEdge(b, a)) {
+            addOpenEdge(openOut, a, b);
+            addOpenEdge(openIn, b, a);
+        }
+    }
+
+    auto isOpenAtPosition = [&](uint32_t a, uint32_t b){
+        uint32_t wedge = b;
+        do {
+            for (uint32_t e=adjacency.offsets[wedge]; e < adjacency.offsets[wedge + 1]; ++e) {
+                if (remap[adjacency.targets[e]] == remap[a]) return false;
+            }
+            wedge = wedges[wedge];
+        } while (wedge != b);
+        return true;
+    };
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::LOCKED);
+
+    for (uint32_t v=0; v < vertexCount; ++v) {
+        bool closed   = openOut[v] == NO_VERTEX && openIn[v] == NO_VERTEX;
+        bool openLoop = openOut[v] < MANY_VERTEX && openIn[v] < MANY_VERTEX;
+
+        if (wedges[v] == v) {
+            if (closed)        kinds[v] = VertexKind::MANIFOLD;
+            else if (openLoop) kinds[v] = VertexKind::BORDER;
+        } else if (wedges[wedges[v]] == v && openLoop) {
+            // Both sides of the seam run along the same positions, in opposite directions
+            uint32_t w = wedges[v];
+            if (openOut[w] < MANY_VERTEX && openIn[w] < MANY_VERTEX &&
+                remap[openOut[v]] == remap[openIn[w]] && remap[openIn[v]] == remap[openOut[w]])
+            {
+                kinds[v] = VertexKind::SEAM;
+            }
+        }
+    }
+
+
+    // Quadrics - per position, from the triangles around it and the open edges through it
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t t=0; t < indices.size() / 3; ++t) {
+        const uint32_t* triangle = &indices[t * 3];
+        const glm::vec3& p0 = positions[triangle[0]];
+        const glm::vec3& p1 = positions[triangle[1]];
+        const glm::vec3& p2 = positions[triangle[2]];
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float     area   = glm::length(normal);
+        if (area == 0.0f) continue;
+
+        normal /= area;
+        Quadric faceQuadric = Quadric::fromPlane(normal, -glm::dot(normal, p0), area);
+        for (int i=0; i < 3; ++i) quadrics[remap[triangle[i]]] += faceQuadric;
+
+        for (int i=0; i < 3; ++i) {
+            uint32_t a = triangle[i];
+            uint32_t b = triangle[(i + 1) % 3];
+            if (adjacency.hasEdge(b, a)) continue;
+
+            glm::vec3 edge       = positions[b] - positions[a];
+            float     length     = glm::length(edge);
+            glm::vec3 edgeNormal = glm::cross(edge, normal);
+            float     normalSize = glm::length(edgeNormal);
+            if (normalSize == 0.0f) continue;
+
+            edgeNormal /= normalSize;
+            float   weight      = length * (isOpenAtPosition(a, b)? BORDER_WEIGHT : SEAM_WEIGHT);
+            Quadric edgeQuadric = Quadric::fromPlane(edgeNormal, -glm::dot(edgeNormal, positions[a]), weight);
+
+            quadrics[remap[a]] += edgeQuadric;
+            quadrics[remap[b]] += edgeQuadric;
+        }
+    }
+
+
+    // Collapse rules
+    auto seamTarget = [&](uint32_t vertex, uint32_t target){
+        // The other side of the seam runs the opposite way
+        uint32_t wedge = wedges[vertex];
+        return (target == openOut[vertex])? openIn[wedge] : openOut[wedge];
+    };
+
+    auto canCollapse = [&](uint32_t vertex, uint32_t target){
+        VertexKind targetKind = kinds[target];
+        bool       alongLoop  = (target == openOut[vertex] || target == openIn[vertex]);
+
+        switch (kinds[vertex]) {
+            case VertexKind::MANIFOLD:
+                return true;
+            case VertexKind::BORDER:
+                return alongLoop && (targetKind == VertexKind::BORDER || targetKind == VertexKind::LOCKED);
+            case VertexKind::SEAM: {
+                if (!alongLoop || (targetKind != VertexKind::SEAM && targetKind != VertexKind::LOCKED)) return false;
+                uint32_t wedgeTarget = seamTarget(vertex, target);
+                return wedgeTarget < MANY_VERTEX && remap[wedgeTarget] == remap[target];
+            }
+            default:
+                return false;
+        }
+    };
+
+
+    // Collapse passes - cheapest first, each position touched at most once per pass
+    float errorLimit   = (maxError < std::sqrt(std::numeric_limits<float>::max()))? (maxError / extent) * (maxError / extent)
+                                                                                 : std::numeric_limits<float>::max();
+    float resultError  = 0.0f;
+    size_t targetCount = targetIndexCount / 3;
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseRemap(vertexCount);
+    std::vector<bool>     collapseLocked(vertexCount);
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        collapses.clear();
+        for (size_t i=0; i < result.size(); ++i) {
+            uint32_t a = result[i];
+            uint32_t b = result[(i % 3 == 2)? i - 2 : i + 1];
+
+            // Interior edges show up once per direction
+            if (openOut[a] == NO_VERTEX && a > b) continue;
+
+            bool  forward       = canCollapse(a, b);
+            bool  backward      = canCollapse(b, a);
+            float forwardError  = forward?  quadrics[remap[a]].error(positions[b]) : 0.0f;
+            float backwardError = backward? quadrics[remap[b]].error(positions[a]) : 0.0f;
+
+            if (forward && (!backward || forwardError <= backwardError)) {
+                collapses.push_back(Collapse{ a, b, forwardError });
+            } else if (backward) {
+                collapses.push_back(Collapse{ b, a, backwardError });
+            }
+        }
+
+        if (collapses.empty()) break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){
+            return a.error < b.error;
+        });
+
+        size_t neededCollapses = (triangleCount - targetCount + 1) / 2;
+        size_t marginIndex     = std::min(collapses.size() - 1, static_cast<size_t>(neededCollapses * PASS_COLLAPSE_MARGIN));
+        float  passErrorLimit  = std::min(errorLimit, std::max(collapses[marginIndex].error, collapses[0].error));
+
+
+        VertexTriangles vertexTriangles(result, vertexCount);
+
+        // Whether moving vertex onto target turns any of its remaining triangles over
+        auto hasFlips = [&](uint32_t vertex, uint32_t target){
+            const glm::vec3& targetPosition = positions[target];
+
+            for (uint32_t e=vertexTriangles.offsets[vertex]; e < vertexTriangles.offsets[vertex + 1]; ++e) {
+                const uint32_t* triangle = &result[vertexTriangles.triangles[e] * 3];
+
+                if (remap[triangle[0]] == remap[target] || remap[triangle[1]] == remap[target] || remap[triangle[2]] == remap[target]) {
+                    continue;       // Collapses away
+                }
+
+                glm::vec3 before[3], after[3];
+                for (int i=0; i < 3; ++i) {
+                    before[i] = positions[triangle[i]];
+                    after[i]  = (triangle[i] == vertex)? targetPosition : before[i];
+                }
+
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter  = glm::cross(after[1]  - after[0],  after[2]  - after[0]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.0f) return true;
+            }
+            return false;
+        };
+
+        std::iota(collapseRemap.begin(), collapseRemap.end(), 0u);
+        std::fill(collapseLocked.begin(), collapseLocked.end(), false);
+
+        size_t appliedCollapses  = 0;
+        size_t removedTriangles  = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > passErrorLimit || triangleCount - removedTriangles <= targetCount) break;
+
+            uint32_t vertex = collapse.vertex;
+            uint32_t target = collapse.target;
+            if (collapseLocked[remap[vertex]] || collapseLocked[remap[target]]) continue;
+
+            bool     seam        = kinds[vertex] == VertexKind::SEAM;
+            uint32_t wedge       = wedges[vertex];
+            uint32_t wedgeTarget = seam? seamTarget(vertex, target) : NO_VERTEX;
+
+            if (hasFlips(vertex, target) || (seam && hasFlips(wedge, wedgeTarget))) continue;
+
+            collapseRemap[vertex] = target;
+            if (seam) collapseRemap[wedge] = wedgeTarget;
+
+            quadrics[remap[target]] += quadrics[remap[vertex]];
+
+            collapseLocked[remap[vertex]] = true;
+            collapseLocked[remap[target]] = true;
+
+            resultError       = std::max(resultError, collapse.error);
+            removedTriangles += (kinds[vertex] == VertexKind::BORDER)? 1 : 2;
+            ++appliedCollapses;
+        }
+
+        if (appliedCollapses == 0) break;
+
+
+        // Rewrite the triangles, dropping the ones that collapsed
+        size_t writeCount = 0;
+        for (size_t t=0; t < triangleCount; ++t) {
+            uint32_t a = collapseRemap[result[t * 3 + 0]];
+            uint32_t b = collapseRemap[result[t * 3 + 1]];
+            uint32_t c = collapseRemap[result[t * 3 + 2]];
+
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) continue;
+
+            result[writeCount++] = a;
+            result[writeCount++] = b;
+            result[writeCount++] = c;
+        }
+        result.resize(writeCount);
+
+        remapEdgeLoop(openOut, collapseRemap);
+        remapEdgeLoop(openIn, collapseRemap);
+    }
+
+    return std::sqrt(resultError) * extent;
+}
+
+
+void MeshSimplifier::buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods,
+                               const MeshLodOptions& options)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    lods.clear();
+    lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0, 0, 0.0f, {} });
+
+    std::vector<uint32_t> baseIndices(indices);
+    std::vector<uint32_t> lodIndices;
+
+    for (float ratio : options.targetRatios) {
+        if (lods.size() == MAX_MESH_LODS) break;
+
+        size_t targetIndexCount = static_cast<size_t>(baseIndices.size() / 3 * ratio) * 3;
+        float  error            = simplify(vertices, baseIndices, targetIndexCount, std::numeric_limits<float>::max(), lodIndices);
+
+        if (lodIndices.empty() || lodIndices.size() > lods.back().indexCount * options.maxKeptRatio) {
+            LOG_DEBUG_S("LOD chain stopped at " << lods.size() << " levels - simplification got stuck at "
+                        << lodIndices.size() / 3 << " triangles");
+            break;
+        }
+
+        MeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+
+        MeshLod lod{};
+        lod.indexOffset = static_cast<uint32_t>(indices.size());
+        lod.indexCount  = static_cast<uint32_t>(lodIndices.size());
+        lod.error       = std::max(error, lods.back().error);
+        lods.push_back(lod);
+
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    for (size_t l=1; l < lods.size(); ++l) {
+        float keptPercent = 100.0f * lods[l].indexCount / lods[0].indexCount;
+        LOG_INFO_S("LOD " << l << " : " << lods[l].indexCount / 3 << " triangles (" << keptPercent << "%), error " << lods[l].error);
+    }
+    LOG_DEBUG_S("Built " << lods.size() << " LODs in " << elapsedMs << " ms");
+}
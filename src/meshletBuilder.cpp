@@ -0,0 +1,157 @@
+#include <meshletBuilder.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// Cones wider than this (cos of the half angle between the axis and the furthest normal) never cull anything
+static const float MIN_CONE_SPREAD = 0.1f;
+
+
+void MeshletData::clear(){
+    meshlets.clear();
+    vertices.clear();
+    triangles.clear();
+}
+
+
+static void computeBounds(Meshlet& meshlet, const MeshletData& meshletData, const std::vector<Vertex>& vertices){
+    const uint32_t* meshletVertices  = meshletData.vertices.data()  + meshlet.vertexOffset;
+    const uint32_t* meshletTriangles = meshletData.triangles.data() + meshlet.triangleOffset;
+
+    // Bounding sphere around the box center
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t v=0; v < meshlet.vertexCount; ++v) {
+        boundsMin = glm::min(boundsMin, vertices[meshletVertices[v]].pos);
+        boundsMax = glm::max(boundsMax, vertices[meshletVertices[v]].pos);
+    }
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float     radius = 0.0f;
+    for (uint32_t v=0; v < meshlet.vertexCount; ++v) {
+        radius = std::max(radius, glm::length(vertices[meshletVertices[v]].pos - center));
+    }
+
+
+    // Normal cone - average of the triangle normals, opened up to the furthest one
+    std::array<glm::vec3, MESHLET_MAX_TRIANGLES> normals;
+    uint32_t  normalCount = 0;
+    glm::vec3 axis(0.0f);
+
+    for (uint32_t t=0; t < meshlet.triangleCount; ++t) {
+        uint32_t  packed = meshletTriangles[t];
+        glm::vec3 a      = vertices[meshletVertices[(packed >>  0) & 0xFF]].pos;
+        glm::vec3 b      = vertices[meshletVertices[(packed >>  8) & 0xFF]].pos;
+        glm::vec3 c      = vertices[meshletVertices[(packed >> 16) & 0xFF]].pos;
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float     length = glm::length(normal);
+        if (length == 0.0f) continue;       // Degenerate triangles face nowhere
+
+        normals[normalCount++] = normal / length;
+        axis += normal / length;
+    }
+
+    float axisLength = glm::length(axis);
+    float minDot     = 1.0f;
+
+    if (axisLength > 0.0f) {
+        axis /= axisLength;
+        for (uint32_t n=0; n < normalCount; ++n) {
+            minDot = std::min(minDot, glm::dot(normals[n], axis));
+        }
+    }
+
+    memcpy(meshlet.center, &center, sizeof(meshlet.center));
+    meshlet.radius = radius;
+
+    if (axisLength == 0.0f || minDot <= MIN_CONE_SPREAD) {
+        meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+        meshlet.coneCutoff  = 1.0f;
+    } else {
+        memcpy(meshlet.coneAxis, &axis, sizeof(meshlet.coneAxis));
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);      // sin of the cone half angle
+    }
+}
+
+
+void MeshletBuilder::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                           std::vector<MeshLod>& lods, MeshletData& meshletData)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    meshletData.clear();
+
+    size_t triangleCount = indices.size() / 3;
+    meshletData.triangles.resize(triangleCount);
+    meshletData.meshlets.reserve(triangleCount / MESHLET_MAX_TRIANGLES + lods.size());
+    meshletData.vertices.reserve(triangleCount);
+
+
+    // Greedy pass over the triangles - a meshlet is closed as soon as the next triangle doesn't fit
+    std::vector<uint8_t> localIndices(vertices.size(), 0xFF);        // 0xFF : not in the current meshlet
+
+    Meshlet current{};
+
+    auto closeMeshlet = [&](){
+        for (uint32_t v=0; v < current.vertexCount; ++v) {
+            localIndices[meshletData.vertices[current.vertexOffset + v]] = 0xFF;
+        }
+        meshletData.meshlets.push_back(current);
+
+        current                = Meshlet{};
+        current.vertexOffset   = static_cast<uint32_t>(meshletData.vertices.size());
+        current.triangleOffset = static_cast<uint32_t>(meshletData.meshlets.back().triangleOffset + meshletData.meshlets.back().triangleCount);
+    };
+
+    for (MeshLod& lod : lods) {
+        lod.meshletOffset = static_cast<uint32_t>(meshletData.meshlets.size());
+
+        for (size_t t=lod.indexOffset / 3; t < (lod.indexOffset + lod.indexCount) / 3; ++t) {
+            const uint32_t* triangle = &indices[t * 3];
+
+            uint32_t newVertices = (localIndices[triangle[0]] == 0xFF) +
+                                   (localIndices[triangle[1]] == 0xFF && triangle[1] != triangle[0]) +
+                                   (localIndices[triangle[2]] == 0xFF && triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+
+            if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount == MESHLET_MAX_TRIANGLES) {
+                closeMeshlet();
+            }
+
+            uint32_t packed = 0;
+            for (int i=0; i < 3; ++i) {
+                if (localIndices[triangle[i]] == 0xFF) {
+                    localIndices[triangle[i]] = static_cast<uint8_t>(current.vertexCount++);
+                    meshletData.vertices.push_back(triangle[i]);
+                }
+                packed |= static_cast<uint32_t>(localIndices[triangle[i]]) << (8 * i);
+            }
+
+            meshletData.triangles[t] = packed;
+            ++current.triangleCount;
+        }
+
+        // Meshlets never straddle two LODs
+        if (current.triangleCount > 0) closeMeshlet();
+
+        lod.meshletCount = static_cast<uint32_t>(meshletData.meshlets.size()) - lod.meshletOffset;
+    }
+
+
+    // Bounds are independent per meshlet
+    ThreadPool::get().parallelFor(meshletData.meshlets.size(), 256, [&](size_t begin, size_t end){
+        for (size_t m=begin; m < end; ++m) {
+            computeBounds(meshletData.meshlets[m], meshletData, vertices);
+        }
+    });
+
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    float averageTriangles = meshletData.meshlets.empty()? 0.0f : static_cast<float>(triangleCount) / meshletData.meshlets.size();
+    float averageVertices  = meshletData.meshlets.empty()? 0.0f : static_cast<float>(meshletData.vertices.size()) / meshletData.meshlets.size();
+
+    LOG_DEBUG_S("Built " << meshletData.meshlets.size() << " meshlets (" << averageVertices << " vertices, "
+                << averageTriangles << " triangles on average) in " << elapsedMs << " ms");
+}
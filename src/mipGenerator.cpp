@@ -0,0 +1,225 @@
+#include <mipGenerator.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    #include <emmintrin.h>
+    #define MIP_GENERATOR_SSE2
+#endif
+
+
+// Lanczos-2 lobes, in destination pixels
+static const float FILTER_SUPPORT = 2.0f;
+
+// Linear -> sRGB encoding table resolution
+static const uint32_t SRGB_TABLE_SIZE = 1 << 14;
+
+
+static float lanczos2(float x){
+    x = std::fabs(x);
+    if (x < 1e-6f)          return 1.0f;
+    if (x >= FILTER_SUPPORT) return 0.0f;
+
+    const float pi = 3.14159265358979f;
+    float px = pi * x;
+    return FILTER_SUPPORT * std::sin(px) * std::sin(px / FILTER_SUPPORT) / (px * px);
+}
+
+
+// Polyphase filter - per destination pixel, tapCount source pixels (already clamped/wrapped) and their weights
+struct FilterTable {
+    uint32_t              tapCount = 0;
+    std::vector<uint32_t> sources;
+    std::vector<float>    weights;
+
+    FilterTable(uint32_t sourceSize, uint32_t destinationSize, bool wrap){
+        float scale   = static_cast<float>(sourceSize) / destinationSize;
+        float support = FILTER_SUPPORT * scale;
+
+        tapCount = static_cast<uint32_t>(std::ceil(support * 2.0f)) + 1;
+        sources.resize(destinationSize * tapCount);
+        weights.resize(destinationSize * tapCount);
+
+        for (uint32_t d=0; d < destinationSize; ++d) {
+            float   center = (d + 0.5f) * scale;                                   // In source pixels
+            int32_t first  = static_cast<int32_t>(std::floor(center - support));
+
+            float total = 0.0f;
+            for (uint32_t t=0; t < tapCount; ++t) {
+                int32_t source = first + static_cast<int32_t>(t);
+                float   weight = lanczos2((source + 0.5f - center) / scale);
+
+                if (wrap) {
+                    source %= static_cast<int32_t>(sourceSize);
+                    if (source < 0) source += sourceSize;
+                } else {
+                    source = std::clamp<int32_t>(source, 0, sourceSize - 1);
+                }
+
+                sources[d * tapCount + t] = static_cast<uint32_t>(source);
+                weights[d * tapCount + t] = weight;
+                total += weight;
+            }
+
+            for (uint32_t t=0; t < tapCount; ++t) weights[d * tapCount + t] /= total;
+        }
+    }
+};
+
+
+// One RGBA pixel (4 floats) - out = sum of weights[t] * row[sources[t]]
+static inline void filterPixel(float* out, const float* row, const uint32_t* sources, const float* weights, uint32_t tapCount){
+#ifdef MIP_GENERATOR_SSE2
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t t=0; t < tapCount; ++t) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + sources[t] * 4), _mm_set1_ps(weights[t])));
+    }
+    _mm_storeu_ps(out, sum);
+#else
+    float sum[4] = {};
+    for (uint32_t t=0; t < tapCount; ++t) {
+        const float* pixel = row + sources[t] * 4;
+        for (int c=0; c < 4; ++c) sum[c] += pixel[c] * weights[t];
+    }
+    memcpy(out, sum, sizeof(sum));
+#endif
+}
+
+// out += weight * row, over count floats
+static inline void accumulateRow(float* out, const float* row, float weight, size_t count){
+    size_t i = 0;
+#ifdef MIP_GENERATOR_SSE2
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+    }
+#endif
+    for (; i < count; ++i) out[i] += row[i] * weight;
+}
+
+
+uint32_t MipGenerator::getMipLevelCount(uint32_t width, uint32_t height){
+    uint32_t levelCount = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) ++levelCount;
+    return levelCount;
+}
+
+void MipGenerator::generate(const uint8_t* pixels, uint32_t width, uint32_t height,
+                            std::vector<MipLevel>& levels, std::vector<uint8_t>& data,
+                            const MipOptions& options)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    ThreadPool& threadPool = ThreadPool::get();
+
+    // Layout
+    levels.clear();
+    size_t dataSize = 0;
+    for (uint32_t l=0, w=width, h=height; l < getMipLevelCount(width, height); ++l) {
+        levels.push_back(MipLevel{ w, h, dataSize, size_t(w) * h * 4 });
+        dataSize += levels.back().size;
+
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    data.resize(dataSize);
+    memcpy(data.data(), pixels, levels[0].size);
+    if (levels.size() == 1) return;
+
+
+    // Conversion tables
+    std::array<float, 256> decode;
+    for (uint32_t i=0; i < 256; ++i) {
+        float value = i / 255.0f;
+        decode[i] = (!options.srgb)?     value :
+                    (value <= 0.04045f)? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    std::vector<uint8_t> encode(SRGB_TABLE_SIZE);
+    for (uint32_t i=0; i < SRGB_TABLE_SIZE; ++i) {
+        float value = static_cast<float>(i) / (SRGB_TABLE_SIZE - 1);
+        value = (!options.srgb)?        value :
+                (value <= 0.0031308f)? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        encode[i] = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    auto encodeChannel = [&encode](float value, bool linear){
+        value = std::clamp(value, 0.0f, 1.0f);      // Lanczos lobes overshoot
+        return linear? static_cast<uint8_t>(value * 255.0f + 0.5f)
+                     : encode[static_cast<uint32_t>(value * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+    };
+
+
+    // Level 0 to linear floats, premultiplied
+    std::vector<float> source(size_t(width) * height * 4);
+    threadPool.parallelFor(height, 16, [&](size_t begin, size_t end){
+        for (size_t i=begin * width * 4; i < end * width * 4; i += 4) {
+            float alpha = pixels[i + 3] / 255.0f;
+            float scale = options.premultiplyAlpha? alpha : 1.0f;
+
+            for (size_t c=0; c < 3; ++c) source[i + c] = decode[pixels[i + c]] * scale;
+            source[i + 3] = alpha;
+        }
+    });
+
+    std::vector<float> horizontal, destination;
+
+    for (size_t l=1; l < levels.size(); ++l) {
+        uint32_t sourceWidth  = levels[l - 1].width;
+        uint32_t sourceHeight = levels[l - 1].height;
+        uint32_t levelWidth   = levels[l].width;
+        uint32_t levelHeight  = levels[l].height;
+
+        FilterTable columns(sourceWidth, levelWidth, options.wrap);
+        FilterTable rows(sourceHeight, levelHeight, options.wrap);
+
+        // Horizontal pass - every source row down to levelWidth pixels
+        horizontal.resize(size_t(levelWidth) * sourceHeight * 4);
+        threadPool.parallelFor(sourceHeight, 16, [&](size_t begin, size_t end){
+            for (size_t y=begin; y < end; ++y) {
+                const float* sourceRow = source.data() + y * sourceWidth * 4;
+                float*       outRow    = horizontal.data() + y * levelWidth * 4;
+
+                for (uint32_t x=0; x < levelWidth; ++x) {
+                    filterPixel(outRow + x * 4, sourceRow,
+                                &columns.sources[x * columns.tapCount], &columns.weights[x * columns.tapCount], columns.tapCount);
+                }
+            }
+        });
+
+        // Vertical pass - whole rows at a time, then encoded into the level
+        destination.assign(size_t(levelWidth) * levelHeight * 4, 0.0f);
+        uint8_t* levelData = data.data() + levels[l].offset;
+
+        threadPool.parallelFor(levelHeight, 4, [&](size_t begin, size_t end){
+            size_t rowFloats = size_t(levelWidth) * 4;
+
+            for (size_t y=begin; y < end; ++y) {
+                float* outRow = destination.data() + y * rowFloats;
+
+                for (uint32_t t=0; t < rows.tapCount; ++t) {
+                    accumulateRow(outRow, horizontal.data() + rows.sources[y * rows.tapCount + t] * rowFloats,
+                                  rows.weights[y * rows.tapCount + t], rowFloats);
+                }
+
+                // Back to straight alpha - nothing is left to recover where it filtered down to 0
+                for (size_t i=0; i < rowFloats; i += 4) {
+                    float alpha = std::clamp(outRow[i + 3], 0.0f, 1.0f);
+                    float scale = !options.premultiplyAlpha? 1.0f :
+                                  (alpha > 0.0f)?            1.0f / alpha : 0.0f;
+
+                    for (size_t c=0; c < 3; ++c) levelData[y * rowFloats + i + c] = encodeChannel(outRow[i + c] * scale, false);
+                    levelData[y * rowFloats + i + 3] = encodeChannel(alpha, true);
+                }
+            }
+        });
+
+        source.swap(destination);
+    }
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    LOG_DEBUG_S("Generated " << levels.size() << " mip levels for " << width << "x" << height << " in " << elapsedMs << " ms");
+}
@@ -0,0 +1,506 @@
+#include <objParser.hpp>
+#include <mappedFile.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// Chunks smaller than this aren't worth a task of their own
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+struct ObjChunk {
+    const char*           begin;
+    const char*           end;
+
+    std::vector<float>    positions;             // xyz
+    std::vector<float>    texCoords;             // uv
+    std::vector<ObjIndex> corners;               // Polygon corners - not triangulated yet
+    std::vector<uint32_t> faceSizes;
+    size_t                triangleCount = 0;
+
+    // Corners using negative (relative) indices - resolved against the chunk's own attributes
+    // until the number of attributes in the preceding chunks is known
+    std::vector<size_t>   relativePositions;
+    std::vector<size_t>   relativeTexCoords;
+
+    std::string           error;
+};
+
+
+//---Scanning-------------------------------------------------------------------------
+static inline bool isBlank(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c){
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+static inline const char* skipBlanks(const char* p, const char* end){
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+static inline const char* skipToken(const char* p, const char* end){
+    while (p < end && !isBlank(*p)) ++p;
+    return p;
+}
+
+static bool parseInt(const char*& p, const char* end, int& value){
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p >= end || !isDigit(*p)) return false;
+
+    int64_t result = 0;
+    while (p < end && isDigit(*p)) {
+        result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+        ++p;
+    }
+
+    value = static_cast<int>(negative? -result : result);
+    return true;
+}
+
+// Fast path for plain decimal numbers, which is all exporters write in practice
+//  - Up to 19 significant digits with a small exponent are converted exactly (Clinger's fast path)
+//  - Anything else (long mantissas, large exponents, inf/nan) falls back to strtod
+static bool parseFloat(const char*& p, const char* end, float& value){
+    static const double powersOfTen[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* start = p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa    = 0;
+    int      exponent    = 0;
+    int      digitCount  = 0;      // Significant digits kept in the mantissa
+    bool     truncated   = false;
+    bool     foundDigits = false;
+
+    for (; p < end && isDigit(*p); ++p) {
+        foundDigits = true;
+        if (digitCount < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            if (mantissa) ++digitCount;
+        } else {
+            ++exponent;
+            truncated = true;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            foundDigits = true;
+            if (digitCount < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa) ++digitCount;
+                --exponent;
+            } else {
+                truncated = true;
+            }
+        }
+    }
+
+    if (foundDigits && p < end && (*p == 'e' || *p == 'E')) {
+        const char* exponentStart = p++;
+        int exponentValue;
+        if (parseInt(p, end, exponentValue)) {
+            exponent += std::clamp(exponentValue, -9999, 9999);
+        } else {
+            p = exponentStart;      // Not an exponent - leave the 'e' unconsumed
+        }
+    }
+
+    if (foundDigits && !truncated && (mantissa == 0 || (exponent >= -22 && exponent <= 22 && mantissa <= (1ull << 53)))) {
+        double result = static_cast<double>(mantissa);
+        result = (exponent < 0)? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+
+        value = static_cast<float>(negative? -result : result);
+        return true;
+    }
+
+
+    // Slow path - strtod needs a null-terminated copy of the token
+    const char* tokenEnd = skipToken(start, end);
+    std::string token(start, tokenEnd);
+
+    char* parsedEnd = nullptr;
+    double result   = std::strtod(token.c_str(), &parsedEnd);
+
+    if (parsedEnd == token.c_str()) {
+        p = start;
+        return false;
+    }
+
+    p     = start + (parsedEnd - token.c_str());
+    value = static_cast<float>(result);
+    return true;
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to a 0-based index local to the chunk
+static bool resolveIndex(int index, size_t attributeCount, int32_t& resolved, std::vector<size_t>& relativeCorners, size_t corner){
+    if (index > 0) {
+        resolved = index - 1;
+    } else if (index < 0) {
+        resolved = static_cast<int32_t>(attributeCount) + index;
+        relativeCorners.push_back(corner);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+//---Parsing--------------------------------------------------------------------------
+static void parseFace(const char* p, const char* lineEnd, ObjChunk& chunk){
+    size_t   firstCorner       = chunk.corners.size();
+    size_t   relativePositions = chunk.relativePositions.size();
+    size_t   relativeTexCoords = chunk.relativeTexCoords.size();
+    uint32_t faceSize          = 0;
+
+    while (true) {
+        p = skipBlanks(p, lineEnd);
+        if (p >= lineEnd || *p == '#') break;
+
+        int positionIndex = 0, texCoordIndex = 0, normalIndex = 0;
+
+        if (!parseInt(p, lineEnd, positionIndex)) {
+            chunk.error = "Invalid face statement";
+            return;
+        }
+
+        if (p < lineEnd && *p == '/') {
+            ++p;
+            if (p < lineEnd && *p != '/' && !parseInt(p, lineEnd, texCoordIndex)) {
+                chunk.error = "Invalid face statement";
+                return;
+            }
+            if (p < lineEnd && *p == '/') {
+                ++p;
+                parseInt(p, lineEnd, normalIndex);       // Normals are not used
+            }
+        }
+
+        ObjIndex corner{ -1, -1 };
+        size_t   cornerIndex = chunk.corners.size();
+
+        if (!resolveIndex(positionIndex, chunk.positions.size() / 3, corner.position, chunk.relativePositions, cornerIndex)) {
+            chunk.error = "Invalid face vertex index";
+            return;
+        }
+        if (texCoordIndex != 0) {
+            resolveIndex(texCoordIndex, chunk.texCoords.size() / 2, corner.texCoord, chunk.relativeTexCoords, cornerIndex);
+        }
+
+        chunk.corners.push_back(corner);
+        ++faceSize;
+
+        p = skipToken(p, lineEnd);
+    }
+
+    if (faceSize < 3) {
+        // Degenerate face - dropped, same as tinyobj
+        chunk.corners.resize(firstCorner);
+        chunk.relativePositions.resize(relativePositions);
+        chunk.relativeTexCoords.resize(relativeTexCoords);
+        return;
+    }
+
+    chunk.faceSizes.push_back(faceSize);
+    chunk.triangleCount += faceSize - 2;
+}
+
+static void parseChunk(ObjChunk& chunk){
+    const char* p   = chunk.begin;
+    const char* end = chunk.end;
+
+    while (p < end && chunk.error.empty()) {
+        p = skipBlanks(p, end);
+
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (lineEnd == nullptr) lineEnd = end;
+
+        if (lineEnd - p >= 2) {
+            if (p[0] == 'v' && isBlank(p[1])) {
+                float xyz[3] = { 0.0f, 0.0f, 0.0f };
+                const char* q = p + 2;
+                for (float& value : xyz) {
+                    q = skipBlanks(q, lineEnd);
+                    if (!parseFloat(q, lineEnd, value)) break;
+                }
+                chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+            }
+            else if (p[0] == 'v' && p[1] == 't' && lineEnd - p >= 3 && isBlank(p[2])) {
+                float uv[2] = { 0.0f, 0.0f };
+                const char* q = p + 3;
+                for (float& value : uv) {
+                    q = skipBlanks(q, lineEnd);
+                    if (!parseFloat(q, lineEnd, value)) break;
+                }
+                chunk.texCoords.insert(chunk.texCoords.end(), uv, uv + 2);
+            }
+            else if (p[0] == 'f' && isBlank(p[1])) {
+                parseFace(p + 2, lineEnd, chunk);
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// Even-odd test of a point against a triangle, like tinyobj's pnpoly()
+static bool insideTriangle(const float* x, const float* y, float testX, float testY){
+    bool inside = false;
+    for (int i=0, j=2; i < 3; j = i++) {
+        if (((y[i] > testY) != (y[j] > testY)) && (testX < (x[j] - x[i]) * (testY - y[i]) / (y[j] - y[i]) + x[i])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// Ear clipping in the axis plane the polygon faces most - the same ears, in the same order, as tinyobj
+//  - Whatever can't be clipped (degenerate or self-intersecting polygons) is fanned, tinyobj drops it
+static void clipEars(const ObjIndex* face, uint32_t faceSize, const std::vector<glm::vec3>& positions, ObjIndex* out){
+    const float epsilon = std::numeric_limits<float>::epsilon();
+
+    int axes[2] = { 1, 2 };
+    for (uint32_t k=0; k < faceSize; ++k) {
+        const glm::vec3& p0 = positions[face[k].position];
+        const glm::vec3& p1 = positions[face[(k + 1) % faceSize].position];
+        const glm::vec3& p2 = positions[face[(k + 2) % faceSize].position];
+
+        glm::vec3 normal = glm::abs(glm::cross(p1 - p0, p2 - p1));
+
+        if (normal.x > epsilon || normal.y > epsilon || normal.z > epsilon) {
+            if (!(normal.x > normal.y && normal.x > normal.z)) {
+                axes[0] = 0;
+                if (normal.z > normal.x && normal.z > normal.y) axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    std::vector<ObjIndex> remaining(face, face + faceSize);
+    size_t guess               = 0;
+    size_t iterationsLeft      = faceSize;
+    size_t previousVertexCount = faceSize;
+
+    while (remaining.size() > 3 && iterationsLeft > 0) {
+        size_t vertexCount = remaining.size();
+        if (guess >= vertexCount) guess -= vertexCount;
+
+        // The budget resets with every ear clipped - once every vertex was tried without one, give up
+        if (previousVertexCount != vertexCount) {
+            previousVertexCount = vertexCount;
+            iterationsLeft      = vertexCount;
+        } else {
+            --iterationsLeft;
+        }
+
+        float x[3], y[3];
+        for (size_t k=0; k < 3; ++k) {
+            const glm::vec3& p = positions[remaining[(guess + k) % vertexCount].position];
+            x[k] = p[axes[0]];
+            y[k] = p[axes[1]];
+        }
+
+        // Reflex corner (the "area" term is tinyobj's, kept so the same ears are picked)
+        float cross = (x[1] - x[0]) * (y[2] - y[1]) - (y[1] - y[0]) * (x[2] - x[1]);
+        float area  = (x[0] * y[1] - y[0] * x[1]) * 0.5f;
+        if (cross * area < 0.0f) {
+            ++guess;
+            continue;
+        }
+
+        // Another vertex inside the candidate ear
+        bool overlap = false;
+        for (size_t other=3; other < vertexCount && !overlap; ++other) {
+            const glm::vec3& p = positions[remaining[(guess + other) % vertexCount].position];
+            overlap = insideTriangle(x, y, p[axes[0]], p[axes[1]]);
+        }
+        if (overlap) {
+            ++guess;
+            continue;
+        }
+
+        for (size_t k=0; k < 3; ++k) *out++ = remaining[(guess + k) % vertexCount];
+        remaining.erase(remaining.begin() + static_cast<ptrdiff_t>((guess + 1) % vertexCount));
+    }
+
+    for (size_t i=1; i + 1 < remaining.size(); ++i) {
+        *out++ = remaining[0];
+        *out++ = remaining[i];
+        *out++ = remaining[i + 1];
+    }
+}
+
+// Splits a polygon into triangles - writes (faceSize - 2) * 3 indices
+static void triangulateFace(const ObjIndex* face, uint32_t faceSize, const std::vector<glm::vec3>& positions, ObjIndex* out){
+    if (faceSize == 4) {
+        // Split along the shorter diagonal
+        glm::vec3 diagonal02 = positions[face[2].position] - positions[face[0].position];
+        glm::vec3 diagonal13 = positions[face[3].position] - positions[face[1].position];
+
+        if (glm::dot(diagonal02, diagonal02) < glm::dot(diagonal13, diagonal13)) {
+            const ObjIndex quad[6] = { face[0], face[1], face[2], face[0], face[2], face[3] };
+            std::copy(quad, quad + 6, out);
+        } else {
+            const ObjIndex quad[6] = { face[0], face[1], face[3], face[1], face[2], face[3] };
+            std::copy(quad, quad + 6, out);
+        }
+        return;
+    }
+
+    if (faceSize > 4) {
+        clipEars(face, faceSize, positions, out);
+        return;
+    }
+
+    std::copy(face, face + 3, out);
+}
+
+
+//---Loading--------------------------------------------------------------------------
+bool ObjParser::load(const std::string& fileName, ObjMesh& mesh){
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    MappedFile file;
+    if (!file.open(fileName)) {
+        LOG_ERROR_S("Failed to open model file : " << fileName);
+        return false;
+    }
+
+    const char* fileBegin = file.data();
+    const char* fileEnd   = file.data() + file.size();
+
+    ThreadPool& threadPool = ThreadPool::get();
+
+
+    // Split into line-aligned chunks
+    size_t chunkCount = std::clamp<size_t>(file.size() / MIN_CHUNK_SIZE, 1, threadPool.getThreadCount() * 8);
+
+    std::vector<ObjChunk> chunks(chunkCount);
+
+    const char* chunkBegin = fileBegin;
+    for (size_t i=0; i < chunkCount; ++i) {
+        const char* chunkEnd = fileEnd;
+
+        if (i + 1 < chunkCount) {
+            chunkEnd = std::max(chunkBegin, fileBegin + file.size() * (i + 1) / chunkCount);
+
+            const char* lineEnd = static_cast<const char*>(std::memchr(chunkEnd, '\n', fileEnd - chunkEnd));
+            chunkEnd = (lineEnd == nullptr)? fileEnd : lineEnd + 1;
+        }
+
+        chunks[i].begin = chunkBegin;
+        chunks[i].end   = chunkEnd;
+        chunkBegin      = chunkEnd;
+    }
+
+
+    // Parse chunks in parallel
+    threadPool.parallelFor(chunkCount, 1, [&chunks](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            parseChunk(chunks[i]);
+        }
+    });
+
+
+    // Offsets of every chunk's data in the merged arrays
+    std::vector<size_t> positionOffsets(chunkCount), texCoordOffsets(chunkCount), indexOffsets(chunkCount);
+    size_t positionCount = 0, texCoordCount = 0, indexCount = 0;
+
+    for (size_t i=0; i < chunkCount; ++i) {
+        if (!chunks[i].error.empty()) {
+            LOG_ERROR_S("Failed to parse model " << fileName << " : " << chunks[i].error);
+            return false;
+        }
+
+        positionOffsets[i] = positionCount;
+        texCoordOffsets[i] = texCoordCount;
+        indexOffsets[i]    = indexCount;
+
+        positionCount += chunks[i].positions.size() / 3;
+        texCoordCount += chunks[i].texCoords.size() / 2;
+        indexCount    += chunks[i].triangleCount * 3;
+    }
+
+    mesh.positions.resize(positionCount);
+    mesh.texCoords.resize(texCoordCount);
+    mesh.indices.resize(indexCount);
+
+
+    // Merge attributes and resolve relative indices
+    threadPool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            ObjChunk& chunk = chunks[i];
+
+            std::memcpy(mesh.positions.data() + positionOffsets[i], chunk.positions.data(), chunk.positions.size() * sizeof(float));
+            std::memcpy(mesh.texCoords.data() + texCoordOffsets[i], chunk.texCoords.data(), chunk.texCoords.size() * sizeof(float));
+
+            for (size_t corner : chunk.relativePositions) chunk.corners[corner].position += static_cast<int32_t>(positionOffsets[i]);
+            for (size_t corner : chunk.relativeTexCoords) chunk.corners[corner].texCoord += static_cast<int32_t>(texCoordOffsets[i]);
+
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.texCoords);
+        }
+    });
+
+
+    // Triangulate - needs the merged positions to split quads
+    threadPool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            ObjChunk& chunk = chunks[i];
+
+            for (const ObjIndex& corner : chunk.corners) {
+                if (corner.position < 0 || static_cast<size_t>(corner.position) >= positionCount ||
+                    corner.texCoord < -1 || (corner.texCoord >= 0 && static_cast<size_t>(corner.texCoord) >= texCoordCount))
+                {
+                    chunk.error = "Face with invalid vertex index";
+                    break;
+                }
+            }
+            if (!chunk.error.empty()) continue;
+
+            const ObjIndex* face = chunk.corners.data();
+            ObjIndex*       out  = mesh.indices.data() + indexOffsets[i];
+
+            for (uint32_t faceSize : chunk.faceSizes) {
+                triangulateFace(face, faceSize, mesh.positions, out);
+                face += faceSize;
+                out  += (faceSize - 2) * 3;
+            }
+        }
+    });
+
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            LOG_ERROR_S("Failed to parse model " << fileName << " : " << chunk.error);
+            return false;
+        }
+    }
+
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    LOG_DEBUG_S("Parsed model " << fileName << " : "
+                << positionCount << " positions, "
+                << texCoordCount << " texture coordinates, "
+                << indexCount / 3 << " triangles in "
+                << elapsedMs << " ms ("
+                << chunkCount << " chunks, " << threadPool.getThreadCount() << " threads)");
+
+    return true;
+}
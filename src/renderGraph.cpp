@@ -0,0 +1,513 @@
+#include <renderGraph.hpp>
+#include <logger.hpp>
+
+
+// Accesses that make a use a write even without write()
+static const VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+                                           VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static inline bool contains(uint64_t flags, uint64_t subset){ return (flags & subset) == subset; }
+
+
+void RenderGraph::init(VkDevice logicalDevice, GpuAllocator& gpuAllocator, bool useSynchronization2){
+    device           = logicalDevice;
+    allocator        = &gpuAllocator;
+    synchronization2 = useSynchronization2;
+}
+
+void RenderGraph::destroy(){
+    clear();
+}
+
+
+// Topology --------------------------------------------------------------------------
+void RenderGraph::clear(){
+    destroyTransientImages();
+
+    resources.clear();
+    passes.clear();
+    batches.clear();
+    stats    = RenderGraphStats{};
+    compiled = false;
+}
+
+RenderResource RenderGraph::importImage(const std::string& name, VkImageAspectFlags aspect, const ResourceAccess& initial, VkImageLayout finalLayout){
+    Resource resource;
+    resource.name        = name;
+    resource.isImage     = true;
+    resource.imported    = true;
+    resource.aspect      = aspect;
+    resource.initial     = initial;
+    resource.finalLayout = finalLayout;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::importBuffer(const std::string& name, const ResourceAccess& initial){
+    Resource resource;
+    resource.name     = name;
+    resource.imported = true;
+    resource.initial  = initial;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc){
+    Resource resource;
+    resource.name    = name;
+    resource.isImage = true;
+    resource.aspect  = desc.aspect;
+    resource.desc    = desc;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, RecordFunction record){
+    Pass pass;
+    pass.name   = name;
+    pass.record = std::move(record);
+
+    passes.push_back(std::move(pass));
+    compiled = false;
+
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, RenderResource resource, const ResourceAccess& access){
+    use(pass, resource, access, false);
+}
+
+void RenderGraph::write(uint32_t pass, RenderResource resource, const ResourceAccess& access){
+    use(pass, resource, access, true);
+}
+
+void RenderGraph::compile(){
+    if (compiled) return;
+
+    computeLifetimes();
+    createTransientImages();
+    computeBarriers();
+
+    compiled = true;
+
+    LOG_TRACE_S("Render graph : " << stats.passes << " passes, " << stats.barrierBatches << " barrier batches, "
+                << stats.imageBarriers << " image barriers, " << stats.transientImages << " transient images in "
+                << (stats.transientBytes >> 10) << " KiB (" << (stats.aliasedBytes >> 10) << " KiB aliased)");
+}
+
+
+// Per Frame -------------------------------------------------------------------------
+void RenderGraph::setImage(RenderResource resource, VkImage image, VkImageView view){
+    resources[resource].image = image;
+    resources[resource].view  = view;
+}
+
+void RenderGraph::setBuffer(RenderResource resource, VkBuffer buffer){
+    resources[resource].buffer = buffer;
+}
+
+VkImage RenderGraph::getImage(RenderResource resource) const{ return resources[resource].image; }
+
+VkImageView RenderGraph::getImageView(RenderResource resource) const{ return resources[resource].view; }
+
+VkImageView RenderGraph::getMipView(RenderResource resource, uint32_t level) const{ return resources[resource].mipViews[level]; }
+
+VkBuffer RenderGraph::getBuffer(RenderResource resource) const{ return resources[resource].buffer; }
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer){
+    compile();
+
+    for (size_t p=0; p < passes.size(); ++p) {
+        recordBarriers(commandBuffer, batches[p]);
+        passes[p].record(commandBuffer);
+    }
+
+    recordBarriers(commandBuffer, batches.back());
+}
+
+RenderGraphStats RenderGraph::getStats() const{ return stats; }
+
+
+// Helper Functions
+void RenderGraph::use(uint32_t pass, RenderResource resource, const ResourceAccess& access, bool write){
+    write |= (access.access & WRITE_ACCESS) != 0;
+
+    // Several uses of a resource by one pass are one use - a pass can't see two layouts of an image at once
+    for (Use& existing : passes[pass].uses) {
+        if (existing.resource != resource) continue;
+
+        if (resources[resource].isImage && existing.access.layout != access.layout) {
+            LOG_FATAL_S("Render graph : pass " << passes[pass].name << " uses " << resources[resource].name << " in two layouts");
+        }
+
+        existing.access.stages |= access.stages;
+        existing.access.access |= access.access;
+        existing.write         |= write;
+        return;
+    }
+
+    passes[pass].uses.push_back({ resource, access, write });
+    compiled = false;
+}
+
+void RenderGraph::computeLifetimes(){
+    for (Resource& resource : resources) {
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass  = 0;
+    }
+
+    for (uint32_t p=0; p < passes.size(); ++p) {
+        for (const Use& use : passes[p].uses) {
+            Resource& resource = resources[use.resource];
+            resource.firstPass = std::min(resource.firstPass, p);
+            resource.lastPass  = std::max(resource.lastPass,  p);
+        }
+    }
+}
+
+void RenderGraph::createTransientImages(){
+    destroyTransientImages();
+
+    // Images --------------------------------
+    std::vector<RenderResource>       transients;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+
+    for (RenderResource r=0; r < resources.size(); ++r) {
+        Resource& resource = resources[r];
+        if (resource.imported || !resource.isImage || resource.firstPass == UINT32_MAX) continue;
+
+        VkImageCreateInfo createInfo{};
+        createInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        createInfo.imageType     = VK_IMAGE_TYPE_2D;
+        createInfo.extent        = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+        createInfo.mipLevels     = resource.desc.mipLevels;
+        createInfo.arrayLayers   = 1;
+        createInfo.format        = resource.desc.format;
+        createInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        createInfo.usage         = resource.desc.usage;
+        createInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        createInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+
+        LOG_RESULT(
+            vkCreateImage(device, &createInfo, nullptr, &resource.image),
+            "Create " + resource.name + " image"
+        );
+
+        vkGetImageMemoryRequirements(device, resource.image, &requirements[r]);
+        transients.push_back(r);
+    }
+
+
+    // Aliasing --------------------------------
+    // Largest first, each into the first slot whose images all live in other passes
+    std::sort(transients.begin(), transients.end(), [&requirements](RenderResource a, RenderResource b){
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<VkMemoryRequirements> slotRequirements;
+
+    for (RenderResource r : transients) {
+        Resource&                   resource = resources[r];
+        const VkMemoryRequirements& required = requirements[r];
+
+        uint32_t slot = 0;
+        for (; slot < slots.size(); ++slot) {
+            if (!(slotRequirements[slot].memoryTypeBits & required.memoryTypeBits)) continue;
+
+            bool overlaps = false;
+            for (RenderResource other : slots[slot].images) {
+                overlaps |= resource.firstPass <= resources[other].lastPass && resources[other].firstPass <= resource.lastPass;
+            }
+            if (!overlaps) break;
+        }
+
+        if (slot == slots.size()) {
+            slots.emplace_back();
+            slotRequirements.push_back(required);
+        }
+
+        VkMemoryRequirements& slotRequired = slotRequirements[slot];
+        slotRequired.size            = std::max(slotRequired.size, required.size);
+        slotRequired.alignment       = std::max(slotRequired.alignment, required.alignment);
+        slotRequired.memoryTypeBits &= required.memoryTypeBits;
+
+        slots[slot].images.push_back(r);
+        resource.slot = slot;
+
+        stats.aliasedBytes += required.size;
+    }
+
+
+    // Memory & Views --------------------------------
+    for (uint32_t slot=0; slot < slots.size(); ++slot) {
+        slots[slot].memory = allocator->allocate("render graph slot " + std::to_string(slot), slotRequirements[slot],
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SuballocationType::OPTIMAL);
+        stats.transientBytes += slotRequirements[slot].size;
+
+        for (RenderResource r : slots[slot].images) {
+            Resource& resource = resources[r];
+
+            vkBindImageMemory(device, resource.image, slots[slot].memory.memory, slots[slot].memory.offset);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image                           = resource.image;
+            viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format                          = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask     = resource.aspect;
+            viewInfo.subresourceRange.baseMipLevel   = 0;
+            viewInfo.subresourceRange.levelCount     = resource.desc.mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount     = 1;
+
+            LOG_RESULT(
+                vkCreateImageView(device, &viewInfo, nullptr, &resource.view),
+                "Create " + resource.name + " image view"
+            );
+
+            resource.mipViews.resize(resource.desc.mipLevels);
+
+            for (uint32_t level=0; level < resource.desc.mipLevels; ++level) {
+                viewInfo.subresourceRange.baseMipLevel = level;
+                viewInfo.subresourceRange.levelCount   = 1;
+
+                LOG_RESULT(
+                    vkCreateImageView(device, &viewInfo, nullptr, &resource.mipViews[level]),
+                    "Create " + resource.name + " mip view"
+                );
+            }
+        }
+    }
+
+    stats.transientImages = static_cast<uint32_t>(transients.size());
+    stats.aliasedBytes   -= std::min(stats.aliasedBytes, stats.transientBytes);
+}
+
+void RenderGraph::destroyTransientImages(){
+    for (Resource& resource : resources) {
+        if (resource.imported || !resource.isImage) continue;
+
+        for (VkImageView mipView : resource.mipViews) vkDestroyImageView(device, mipView, nullptr);
+        resource.mipViews.clear();
+
+        if (resource.view  != VK_NULL_HANDLE) vkDestroyImageView(device, resource.view, nullptr);
+        if (resource.image != VK_NULL_HANDLE) vkDestroyImage(device, resource.image, nullptr);
+
+        resource.view  = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+        resource.slot  = UINT32_MAX;
+    }
+
+    for (MemorySlot& slot : slots) allocator->free(slot.memory);
+    slots.clear();
+
+    stats.transientImages = 0;
+    stats.transientBytes  = 0;
+    stats.aliasedBytes    = 0;
+}
+
+void RenderGraph::computeBarriers(){
+    // Where each resource is at, as the passes run
+    struct State {
+        VkPipelineStageFlags2 writeStages   = VK_PIPELINE_STAGE_2_NONE;     // Last write (or layout transition)
+        VkAccessFlags2        writeAccess   = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 readStages    = VK_PIPELINE_STAGE_2_NONE;     // Since then - a write has to wait on them
+        VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;     // Already waiting on the last write
+        VkAccessFlags2        visibleAccess = VK_ACCESS_2_NONE;
+        VkImageLayout         layout        = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    std::vector<State> states(resources.size());
+
+    for (RenderResource r=0; r < resources.size(); ++r) {
+        const Resource& resource = resources[r];
+        State&          state    = states[r];
+
+        if (resource.imported) {
+            state.writeStages = resource.initial.stages;
+            state.writeAccess = resource.initial.access;
+            state.layout      = resource.initial.layout;
+        } else if (resource.slot != UINT32_MAX) {
+            // Every use of the memory - the other images of the slot, and the image itself in the previous frame
+            for (RenderResource other : slots[resource.slot].images) {
+                for (const Pass& pass : passes) {
+                    for (const Use& use : pass.uses) {
+                        if (use.resource != other) continue;
+                        state.writeStages |= use.access.stages;
+                        state.writeAccess |= use.access.access & WRITE_ACCESS;
+                    }
+                }
+            }
+        }
+    }
+
+    batches.assign(passes.size() + 1, BarrierBatch{});
+
+    auto addMemory = [](BarrierBatch& batch, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess){
+        batch.memory.srcStageMask  |= srcStages;
+        batch.memory.srcAccessMask |= srcAccess;
+        batch.memory.dstStageMask  |= dstStages;
+        batch.memory.dstAccessMask |= dstAccess;
+    };
+
+
+    // Passes --------------------------------
+    for (size_t p=0; p < passes.size(); ++p) {
+        BarrierBatch& batch = batches[p];
+
+        for (const Use& use : passes[p].uses) {
+            const Resource& resource = resources[use.resource];
+            State&          state    = states[use.resource];
+
+            bool layoutChange = resource.isImage && use.access.layout != state.layout;
+
+            if (use.write || layoutChange) {
+                // Write after write / read, or a transition - waits on every use since the last write
+                VkPipelineStageFlags2 srcStages = state.writeStages | state.readStages;
+
+                if (layoutChange) {
+                    batch.images.push_back({ use.resource, srcStages, state.writeAccess, use.access.stages, use.access.access,
+                                             state.layout, use.access.layout });
+                } else if (srcStages != VK_PIPELINE_STAGE_2_NONE) {
+                    addMemory(batch, srcStages, state.writeAccess, use.access.stages, use.access.access);
+                }
+
+                state.writeStages   = use.access.stages;
+                state.writeAccess   = use.write? (use.access.access & WRITE_ACCESS) : VK_ACCESS_2_NONE;
+                state.readStages    = VK_PIPELINE_STAGE_2_NONE;
+                state.visibleStages = use.write? VK_PIPELINE_STAGE_2_NONE : use.access.stages;
+                state.visibleAccess = use.write? VK_ACCESS_2_NONE         : use.access.access;
+                state.layout        = use.access.layout;
+            } else {
+                // Read after write - once per stage and access
+                if (state.writeStages != VK_PIPELINE_STAGE_2_NONE &&
+                    !(contains(state.visibleStages, use.access.stages) && contains(state.visibleAccess, use.access.access)))
+                {
+                    addMemory(batch, state.writeStages, state.writeAccess, use.access.stages, use.access.access);
+
+                    state.visibleStages |= use.access.stages;
+                    state.visibleAccess |= use.access.access;
+                }
+
+                state.readStages |= use.access.stages;
+            }
+        }
+    }
+
+
+    // Final Layouts --------------------------------
+    BarrierBatch& finalBatch = batches.back();
+
+    for (RenderResource r=0; r < resources.size(); ++r) {
+        const Resource& resource = resources[r];
+        const State&    state    = states[r];
+
+        if (!resource.isImage || !resource.imported || resource.firstPass == UINT32_MAX) continue;
+        if (resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout) continue;
+
+        // Whatever comes next (presentation, the next frame) waits on its own semaphores or barriers
+        finalBatch.images.push_back({ r, state.writeStages | state.readStages, state.writeAccess, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                                      state.layout, resource.finalLayout });
+    }
+
+
+    // Stats --------------------------------
+    stats.passes         = static_cast<uint32_t>(passes.size());
+    stats.barrierBatches = 0;
+    stats.imageBarriers  = 0;
+
+    for (const BarrierBatch& batch : batches) {
+        stats.barrierBatches += !batch.empty();
+        stats.imageBarriers  += static_cast<uint32_t>(batch.images.size());
+    }
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch){
+    if (batch.empty()) return;
+
+    imageBarriers.clear();
+
+    for (const ImageBarrier& barrier : batch.images) {
+        const Resource& resource = resources[barrier.resource];
+
+        VkImageMemoryBarrier2 imageBarrier{};
+        imageBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        imageBarrier.srcStageMask                    = barrier.srcStages;
+        imageBarrier.srcAccessMask                   = barrier.srcAccess;
+        imageBarrier.dstStageMask                    = barrier.dstStages;
+        imageBarrier.dstAccessMask                   = barrier.dstAccess;
+        imageBarrier.oldLayout                       = barrier.oldLayout;
+        imageBarrier.newLayout                       = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image                           = resource.image;
+        imageBarrier.subresourceRange.aspectMask     = resource.aspect;
+        imageBarrier.subresourceRange.baseMipLevel   = 0;
+        imageBarrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    if (synchronization2) {
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependencyInfo.memoryBarrierCount      = batch.hasMemory()? 1 : 0;
+        dependencyInfo.pMemoryBarriers         = &batch.memory;
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+        dependencyInfo.pImageMemoryBarriers    = imageBarriers.data();
+
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        return;
+    }
+
+
+    // vkCmdPipelineBarrier - one pair of stage masks for the whole batch, the legacy bits are the same values
+    VkPipelineStageFlags srcStages = static_cast<VkPipelineStageFlags>(batch.memory.srcStageMask);
+    VkPipelineStageFlags dstStages = static_cast<VkPipelineStageFlags>(batch.memory.dstStageMask);
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = static_cast<VkAccessFlags>(batch.memory.srcAccessMask);
+    memoryBarrier.dstAccessMask = static_cast<VkAccessFlags>(batch.memory.dstAccessMask);
+
+    std::vector<VkImageMemoryBarrier> legacyImageBarriers(imageBarriers.size());
+
+    for (size_t i=0; i < imageBarriers.size(); ++i) {
+        const VkImageMemoryBarrier2& barrier = imageBarriers[i];
+
+        legacyImageBarriers[i].sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        legacyImageBarriers[i].srcAccessMask       = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+        legacyImageBarriers[i].dstAccessMask       = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+        legacyImageBarriers[i].oldLayout           = barrier.oldLayout;
+        legacyImageBarriers[i].newLayout           = barrier.newLayout;
+        legacyImageBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        legacyImageBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        legacyImageBarriers[i].image               = barrier.image;
+        legacyImageBarriers[i].subresourceRange    = barrier.subresourceRange;
+
+        srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+        dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+    }
+
+    // No stage is NONE to vkCmdPipelineBarrier
+    if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (dstStages == 0) dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+                         batch.hasMemory()? 1 : 0, &memoryBarrier,
+                         0, nullptr,
+                         static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+}
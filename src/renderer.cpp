@@ -1,20 +1,18 @@
 #include "glm/trigonometric.hpp"
 #include <renderer.hpp>
 #include <logger.hpp>
+#include <meshLoader.hpp>
+#include <meshOptimizer.hpp>
+#include <meshSimplifier.hpp>
+#include <threadPool.hpp>
 
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tol/tiny_obj_loader.h>
-
-
 
 /*
 std::vector<Vertex> vertices{
@@ -63,6 +61,14 @@ const std::vector<uint16_t> vertexIndices{
 */
 
 
+// Depth pyramid set, written through depthPyramidSetTemplate
+struct DepthPyramidDescriptors {
+    VkDescriptorImageInfo                                       depth;
+    std::array<VkDescriptorImageInfo, DEPTH_PYRAMID_MAX_LEVELS> levels;
+    VkDescriptorBufferInfo                                      counter;
+};
+
+
 //==================================Main Functions==================================
 void Renderer::init(GLFWwindow * appWindow){
     LOG_DEBUG("Initializing renderer");
@@ -77,30 +83,88 @@ void Renderer::init(GLFWwindow * appWindow){
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createGpuAllocator();
+    createStagingRing();
     createSwapchain();
     createSwapchainImageViews();
+    loadModel();
+    selectGeometryPath();
+    createObjects();
     createRenderPass();
     createDescriptorSetLayout();
     createGraphicsPipeline();
+    createMeshletCullPipeline();
+    createInstanceCullPipeline();
+    createDepthPyramidPipeline();
     createCommandPools();
+    createSyncObjects();
+    createUploadBatcher();
     createDepthResources();
     createFramebuffers();
+    createPlaceholderTexture();
     createTextureImage();
-    createTextureImageView();
     createTextureSampler();
-    loadModel();
     createVertexBuffer();
     createIndexBuffer();
-    createUniformBuffers();
-    createDescriptorPool();
+    createMeshletBuffers();
+    createInstanceCullBuffers();
+    submitUploads();
+    releaseModelData();
+    createFrameRing();
+    createDescriptorAllocator();
     createDescriptorSets();
-    createGraphicsCommandBuffers();
-    createSyncObjects();
+    createFrameCommands();
+    createRenderGraph();
+}
+
+void Renderer::submitInstances(const std::vector<InstanceData>& instances){
+    submittedInstances.insert(submittedInstances.end(), instances.begin(), instances.end());
+}
+
+Scene& Renderer::getScene(){
+    return scene;
+}
+
+uint32_t Renderer::registerTexture(VkImageView imageView, VkSampler sampler){
+    if (!bindlessTextures) {
+        LOG_WARNING("Bindless textures disabled - the texture isn't registered, material 0 samples the model texture");
+        return 0;
+    }
+
+    // A new slot or one no frame in flight samples anymore - written in every frame's set, pending or not
+    uint32_t slot = textureRegistry.allocate();
+
+    for (uint32_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        writeBindlessDescriptor(i, slot, imageView, (sampler != VK_NULL_HANDLE)? sampler : textureSampler);
+    }
+
+    return slot;
+}
+
+void Renderer::retireTexture(uint32_t material){
+    if (!bindlessTextures) return;
+
+    if (material == modelTextureSlot) {
+        LOG_ERROR("The model texture's slot can't be retired");
+        return;
+    }
+
+    // The descriptor stays as is until the slot is registered again - instances mustn't use the material from the next frame on
+    textureRegistry.retire(material);
 }
 
 void Renderer::drawFrame(){
     vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+    // Before the fence gets reset - staging space handed to it (or to completed uploads) comes back
+    stagingRing.reclaim();
+
+    // Transient descriptor sets of this frame's previous submit go back to the pools
+    descriptorAllocator.beginFrame(currentFrame);
+
+    // Texture slots retired before the frames that have now completed can be registered again
+    if (bindlessTextures) textureRegistry.beginFrame();
+
     uint32_t imageIndex;
     VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -116,20 +180,33 @@ void Renderer::drawFrame(){
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
     updateUniformBuffer(currentFrame);
+    updateTextureStream(currentFrame);
+
+    // The frame's previous submit has completed - its primary goes back to its pool, recordCommandBuffer() decides for the secondaries
+    FrameCommands& commands = frameCommands[currentFrame];
+
+    vkResetCommandPool(device, commands.primaryPool, 0);
 
-    vkResetCommandBuffer(graphicsCommandBuffers[currentFrame], 0);
-    recordCommandBuffer(graphicsCommandBuffers[currentFrame], imageIndex);
+    recordCommandBuffer(commands.primary, imageIndex);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[]      = { imageAvailableSemaphores[currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount     = 1;
+    VkSemaphore waitSemaphores[]      = { imageAvailableSemaphores[currentFrame], uploadBatcher.getTimeline() };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, frameUploadWait.stages };
+    uint64_t waitValues[]             = { 0, frameUploadWait.value };      // Binary semaphores ignore their value
+    submitInfo.waitSemaphoreCount     = (frameUploadWait.value > 0)? 2 : 1;
     submitInfo.pWaitSemaphores        = waitSemaphores;
     submitInfo.pWaitDstStageMask      = waitStages;
+
+    // Frames acquiring uploaded resources wait on the transfers that released them
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = submitInfo.waitSemaphoreCount;
+    timelineInfo.pWaitSemaphoreValues      = waitValues;
+    submitInfo.pNext                       = (frameUploadWait.value > 0)? &timelineInfo : nullptr;
     submitInfo.commandBufferCount     = 1;
-    submitInfo.pCommandBuffers        = &graphicsCommandBuffers[currentFrame];
+    submitInfo.pCommandBuffers        = &commands.primary;
 
     VkSemaphore signalSemaphores[]    = { renderFinishedSemaphores[currentFrame] };
     submitInfo.signalSemaphoreCount   = 1;
@@ -174,33 +251,101 @@ void Renderer::cleanup(){
     cleanupSwapchain();
 
     LOG_TRACE("Cleanup : texture images");
+    if (textureStream.decoded.valid()) textureStream.decoded.wait();          // The worker writes into textureStream
+
     vkDestroySampler(device, textureSampler, nullptr);
     vkDestroyImageView(device, textureImageView, nullptr);
     vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
-
-    LOG_TRACE("Cleanup : uniform buffers");
-    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-        vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-    }
+    gpuAllocator.free(textureImageMemory);
+    vkDestroyImageView(device, placeholderImageView, nullptr);
+    vkDestroyImage(device, placeholderImage, nullptr);
+    gpuAllocator.free(placeholderImageMemory);
+
+    LOG_TRACE("Cleanup : render graph");
+    RenderGraphStats graphStats = renderGraph.getStats();
+    LOG_DEBUG_S("Render graph : " << graphStats.passes << " passes, " << graphStats.barrierBatches << " barrier batches per frame, "
+                << (graphStats.transientBytes >> 10) << " KiB of transient images (" << (graphStats.aliasedBytes >> 10) << " KiB aliased)");
+    renderGraph.destroy();
+
+    LOG_TRACE("Cleanup : frame ring");
+    LOG_DEBUG_S("Frame ring : peak " << (frameRing.getPeak() >> 10) << " / " << (frameRing.getRegionSize() >> 10) << " KiB per frame");
+    vkDestroyBuffer(device, frameRingBuffer, nullptr);
+    gpuAllocator.free(frameRingMemory);
 
     LOG_TRACE("Cleanup : descriptor pool");
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    if (bindlessTextures) {
+        LOG_DEBUG_S("Bindless textures : " << textureRegistry.getCount() << " / " << textureRegistry.getCapacity() << " slots registered");
+    }
+    vkDestroyDescriptorPool(device, bindlessDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, bindlessSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, emptySetLayout, nullptr);
+    DescriptorAllocatorStats descriptorStats = descriptorAllocator.getStats();
+    LOG_DEBUG_S("Descriptor allocator : " << descriptorStats.persistentSets << " sets, " << descriptorStats.transientSets
+                << " transient sets per frame at most, " << descriptorStats.pools << " pools (" << descriptorStats.poolOverflows
+                << " allocations overflowed a pool)");
+    if (descriptorStats.transientSetsTotal > 0) {
+        LOG_DEBUG_S("Descriptor allocator : " << descriptorStats.transientSetsTotal / (double) std::max(1u, descriptorStats.frames)
+                    << " transient sets per frame on average, "
+                    << descriptorStats.transientSeconds * 1e6 / descriptorStats.transientSetsTotal << " us per set");
+    }
+    descriptorAllocator.destroy();
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, meshletSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, instanceCullSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, occlusionSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, depthPyramidSetLayout, nullptr);
 
     LOG_TRACE("Cleanup : pipeline");
+    vkDestroySampler(device, depthPyramidSampler, nullptr);
+    vkDestroyPipeline(device, depthPyramidPipeline, nullptr);
+    vkDestroyPipelineLayout(device, depthPyramidPipelineLayout, nullptr);
+    vkDestroyPipeline(device, instanceCullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, instanceCullPipelineLayout, nullptr);
+    vkDestroyPipeline(device, meshletCullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, meshletCullPipelineLayout, nullptr);
     vkDestroyPipeline(device, graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyRenderPass(device, lateRenderPass, nullptr);
+
+    LOG_TRACE("Cleanup : meshlet buffers");
+    for (size_t i=0; i < meshletDrawBuffers.size(); ++i) {
+        vkDestroyBuffer(device, meshletDrawBuffers[i], nullptr);
+        gpuAllocator.free(meshletDrawBuffersMemory[i]);
+    }
+    vkDestroyBuffer(device, meshletTriangleBuffer, nullptr);
+    gpuAllocator.free(meshletTriangleBufferMemory);
+    vkDestroyBuffer(device, meshletVertexBuffer, nullptr);
+    gpuAllocator.free(meshletVertexBufferMemory);
+    vkDestroyBuffer(device, meshletBuffer, nullptr);
+    gpuAllocator.free(meshletBufferMemory);
+
+    LOG_TRACE("Cleanup : instance cull buffers");
+    for (size_t i=0; i < instanceDrawBuffers.size(); ++i) {
+        vkDestroyBuffer(device, instanceDrawBuffers[i], nullptr);
+        gpuAllocator.free(instanceDrawBuffersMemory[i]);
+    }
+    for (size_t i=0; i < lateDrawBuffers.size(); ++i) {
+        vkDestroyBuffer(device, lateDrawBuffers[i], nullptr);
+        gpuAllocator.free(lateDrawBuffersMemory[i]);
+        vkDestroyBuffer(device, occludedInstanceBuffers[i], nullptr);
+        gpuAllocator.free(occludedInstanceBuffersMemory[i]);
+    }
+    vkDestroyBuffer(device, depthPyramidCounter, nullptr);
+    gpuAllocator.free(depthPyramidCounterMemory);
+    vkDestroyBuffer(device, cullMeshBuffer, nullptr);
+    gpuAllocator.free(cullMeshBufferMemory);
 
     LOG_TRACE("Cleanup : index buffer");
     vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    gpuAllocator.free(indexBufferMemory);
 
     LOG_TRACE("Cleanup : vertex buffer");
     vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    gpuAllocator.free(vertexBufferMemory);
+
+    LOG_TRACE("Cleanup : upload batcher");
+    uploadBatcher.destroy();
 
     LOG_TRACE("Cleanup : sync objects");
     for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
@@ -208,8 +353,15 @@ void Renderer::cleanup(){
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
+    vkDestroySemaphore(device, transferTimeline, nullptr);
 
     LOG_TRACE("Cleanup : command pools");
+    LOG_DEBUG_S("Draw commands : recorded for " << drawRecordCount << " of " << frameCount << " frames");
+    for (FrameCommands& commands : frameCommands) {
+        for (VkCommandPool pool : commands.workerPools) vkDestroyCommandPool(device, pool, nullptr);
+        vkDestroyCommandPool(device, commands.primaryPool, nullptr);
+    }
+
     if (transferCommandPool == graphicsCommandPool) {
         vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
     } else {
@@ -217,6 +369,16 @@ void Renderer::cleanup(){
         vkDestroyCommandPool(device, transferCommandPool, nullptr);
     }
 
+    LOG_TRACE("Cleanup : staging ring");
+    StagingRingStats stagingStats = stagingRing.getStats();
+    LOG_DEBUG_S("Staging ring : peak " << (stagingStats.peak >> 10) << " / " << (stagingStats.capacity >> 10) << " KiB, "
+                << stagingStats.overflowCount << " uploads through temporary buffers");
+    stagingRing.destroy();
+
+    LOG_TRACE("Cleanup : GPU allocator");
+    gpuAllocator.logStats();
+    gpuAllocator.destroy();
+
     LOG_TRACE("Cleanup : device");
     vkDestroyDevice(device, nullptr);
 
@@ -345,20 +507,120 @@ void Renderer::createLogicalDevice(){
     }
 
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // Optional Features --------------------------------
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    bool vulkan12            = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    bool vulkan13            = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+    bool meshShaderExtension = USE_MESHLET_CULLING && OBJECT_COUNT <= 1 && vulkan12 && checkDeviceExtensionSupport(physicalDevice, { VK_EXT_MESH_SHADER_EXTENSION_NAME });
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT supportedMeshShaderFeatures{};
+    supportedMeshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+    VkPhysicalDeviceVulkan13Features supportedVulkan13Features{};
+    supportedVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    supportedVulkan13Features.pNext = meshShaderExtension? &supportedMeshShaderFeatures : nullptr;
+
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supportedVulkan12Features.pNext = vulkan13? static_cast<void*>(&supportedVulkan13Features) :
+                                      meshShaderExtension? static_cast<void*>(&supportedMeshShaderFeatures) : nullptr;
+
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 deviceProperties2{};
+    deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties2.pNext = &vulkan12Properties;
+
+    if (vulkan12) vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = vulkan12? &supportedVulkan12Features : nullptr;
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+    deviceFeatureSupport.meshShader                = meshShaderExtension && supportedMeshShaderFeatures.taskShader && supportedMeshShaderFeatures.meshShader;
+    deviceFeatureSupport.multiDrawIndirect         = supportedFeatures.features.multiDrawIndirect;
+    deviceFeatureSupport.drawIndirectCount         = vulkan12 && supportedVulkan12Features.drawIndirectCount;
+    deviceFeatureSupport.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+    deviceFeatureSupport.maxDrawIndirectCount      = deviceProperties.limits.maxDrawIndirectCount;
+    deviceFeatureSupport.textureCompressionBC      = supportedFeatures.features.textureCompressionBC;
+    deviceFeatureSupport.timelineSemaphore         = vulkan12 && supportedVulkan12Features.timelineSemaphore;
+    deviceFeatureSupport.descriptorIndexing        = vulkan12 &&
+                                                     supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing &&
+                                                     supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+                                                     supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+                                                     supportedVulkan12Features.descriptorBindingPartiallyBound &&
+                                                     supportedVulkan12Features.runtimeDescriptorArray;
+    deviceFeatureSupport.synchronization2          = vulkan13 && supportedVulkan13Features.synchronization2;
+    deviceFeatureSupport.dynamicRendering          = vulkan13 && supportedVulkan13Features.dynamicRendering;
+    deviceFeatureSupport.storageImageArrayIndexing = supportedFeatures.features.shaderStorageImageArrayDynamicIndexing;
+    deviceFeatureSupport.maxBindlessTextures       = std::min({ vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                                vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                                vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                                                vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                                                vulkan12Properties.maxUpdateAfterBindDescriptorsInAllPools / MAX_FRAMES_IN_FLIGHT });
+
+    bindlessTextures = USE_BINDLESS_TEXTURES && deviceFeatureSupport.descriptorIndexing && deviceFeatureSupport.maxBindlessTextures > 0;
+    bindlessTextures? LOG_DEBUG("Bindless textures enabled") : LOG_DEBUG("Bindless textures disabled");
+
+    dynamicRendering = USE_DYNAMIC_RENDERING && deviceFeatureSupport.dynamicRendering;
+    dynamicRendering? LOG_DEBUG("Dynamic rendering enabled") : LOG_DEBUG("Dynamic rendering disabled");
+
+
+    // Enabled Features --------------------------------
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    meshShaderFeatures.sType      = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    meshShaderFeatures.taskShader = deviceFeatureSupport.meshShader;
+    meshShaderFeatures.meshShader = deviceFeatureSupport.meshShader;
+
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13Features.pNext            = deviceFeatureSupport.meshShader? &meshShaderFeatures : nullptr;
+    vulkan13Features.synchronization2 = deviceFeatureSupport.synchronization2;
+    vulkan13Features.dynamicRendering = dynamicRendering;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext             = vulkan13? static_cast<void*>(&vulkan13Features) :
+                                         deviceFeatureSupport.meshShader? static_cast<void*>(&meshShaderFeatures) : nullptr;
+    vulkan12Features.drawIndirectCount = deviceFeatureSupport.drawIndirectCount;
+    vulkan12Features.timelineSemaphore = deviceFeatureSupport.timelineSemaphore;
+
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing    = bindlessTextures;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = bindlessTextures;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending    = bindlessTextures;
+    vulkan12Features.descriptorBindingPartiallyBound              = bindlessTextures;
+    vulkan12Features.runtimeDescriptorArray                       = bindlessTextures;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType                              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext                              = vulkan12? &vulkan12Features : nullptr;
+    deviceFeatures.features.samplerAnisotropy         = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect         = deviceFeatureSupport.multiDrawIndirect;
+    deviceFeatures.features.drawIndirectFirstInstance = deviceFeatureSupport.drawIndirectFirstInstance;
+    deviceFeatures.features.textureCompressionBC      = deviceFeatureSupport.textureCompressionBC;
+
+    deviceFeatures.features.shaderStorageImageArrayDynamicIndexing = USE_OCCLUSION_CULLING && deviceFeatureSupport.storageImageArrayIndexing;
 
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext                   = &deviceFeatures;
     createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos       = queueCreateInfos.data();
-    createInfo.pEnabledFeatures        = &deviceFeatures;
+    createInfo.pEnabledFeatures        = nullptr;           // Passed through pNext
 
 
     // Extensions
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> extensions = deviceExtensions;
+    if (deviceFeatureSupport.meshShader) extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     
     LOG_RESULT(
@@ -366,12 +628,32 @@ void Renderer::createLogicalDevice(){
         "Create logical device"
     );
 
+    if (deviceFeatureSupport.meshShader) {
+        cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT) vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT");
+    }
+
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value() , 0, &presentQueue);
     vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
 }
 
+void Renderer::createGpuAllocator(){
+    // Every buffer and image below is bound to a range of a shared block instead of its own vkAllocateMemory
+    gpuAllocator.init(physicalDevice, device);
+}
+
+void Renderer::createStagingRing(){
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    // Only ever read by the upload batcher's copies, on the transfer queue
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+    stagingRing.init(device, gpuAllocator, STAGING_RING_SIZE, deviceProperties.limits.optimalBufferCopyOffsetAlignment,
+                     { indices.transferFamily.value() });
+}
+
 void Renderer::createSwapchain(){
     SwapchainSupportDetails swapchainSupport = querySwapchainSupport(physicalDevice);
 
@@ -441,6 +723,11 @@ void Renderer::createSwapchainImageViews(){
 }
 
 void Renderer::createRenderPass(){
+    depthFormat = findDepthFormat();
+
+    // The attachments are named when rendering begins, and their formats when the pipeline is created
+    if (dynamicRendering) return;
+
     // Color attachment
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format         = swapchainImageFormat;
@@ -449,8 +736,8 @@ void Renderer::createRenderPass(){
     colorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;     // Transitions are the render graph's - see createRenderGraph()
+    colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment  = 0;
@@ -459,13 +746,13 @@ void Renderer::createRenderPass(){
 
     // Depth attachment
     VkAttachmentDescription depthAttachment{};
-    depthAttachment.format         = findDepthFormat();
+    depthAttachment.format         = depthFormat;
     depthAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.storeOp        = occlusionCulling? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;     // The depth pyramids are built from it
     depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     depthAttachment.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
@@ -480,18 +767,6 @@ void Renderer::createRenderPass(){
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
 
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass    = 0;
-    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    
     std::array<VkAttachmentDescription, 2> attachments = {
         colorAttachment,
         depthAttachment
@@ -503,22 +778,41 @@ void Renderer::createRenderPass(){
     renderPassInfo.pAttachments    = attachments.data();
     renderPassInfo.subpassCount    = 1;
     renderPassInfo.pSubpasses      = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies   = &dependency;
 
 
     LOG_RESULT(
         vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass),
         "Create render pass"
     );
+
+
+    // Late Render Pass --------------------------------
+    // Occlusion culling draws what the first pass missed on top of it - compatible with the framebuffers and the pipeline
+    if (!occlusionCulling) return;
+
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+    LOG_RESULT(
+        vkCreateRenderPass(device, &renderPassInfo, nullptr, &lateRenderPass),
+        "Create late render pass"
+    );
 }
 
 void Renderer::createDescriptorSetLayout(){
+    // Frame data and instance data live in the frame ring - dynamic offsets pick the frame's allocations
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding         = 0;
-    uboLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+    uboLayoutBinding.stageFlags      = (geometryPath == GeometryPath::MESHLET_MESH_SHADER)? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+
+    // Instances are read as a vertex stream, except by the mesh shader
+    VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+    instanceLayoutBinding.binding         = 2;
+    instanceLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    instanceLayoutBinding.descriptorCount = 1;
+    instanceLayoutBinding.stageFlags      = uboLayoutBinding.stageFlags;
 
     VkDescriptorSetLayoutBinding samplerLayoutBinding{};
     samplerLayoutBinding.binding            = 1;
@@ -528,7 +822,7 @@ void Renderer::createDescriptorSetLayout(){
     samplerLayoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, instanceLayoutBinding};
 
     VkDescriptorSetLayoutCreateInfo createInfo{};
     createInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -539,45 +833,220 @@ void Renderer::createDescriptorSetLayout(){
         vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &descriptorSetLayout),
         "Create descriptor set layout"
     );
+
+
+    // Instance Cull Set --------------------------------
+    //  0 : instances (frame ring, dynamic offset) - 1 : cull mesh - 2 : draw commands
+    //  Occlusion culling - 3 : frame uniforms (frame ring, dynamic offset) - 4 : occluded instances - 5 : late draw commands
+    if (gpuInstanceCulling) {
+        std::vector<VkDescriptorSetLayoutBinding> cullBindings(occlusionCulling? 6 : 3);
+
+        for (uint32_t b=0; b < cullBindings.size(); ++b) {
+            cullBindings[b].binding         = b;
+            cullBindings[b].descriptorType  = (b == 0)? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC :
+                                              (b == 3)? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            cullBindings[b].descriptorCount = 1;
+            cullBindings[b].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo cullCreateInfo{};
+        cullCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        cullCreateInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+        cullCreateInfo.pBindings    = cullBindings.data();
+
+        LOG_RESULT(
+            vkCreateDescriptorSetLayout(device, &cullCreateInfo, nullptr, &instanceCullSetLayout),
+            "Create instance cull descriptor set layout"
+        );
+    }
+
+
+    // Occlusion Cull Set (set 1) & Depth Pyramid Set --------------------------------
+    //  Occlusion cull - 0 : depth pyramid
+    //  Depth pyramid  - 0 : depth - 1 : pyramid levels (storage images) - 2 : workgroup counter
+    if (occlusionCulling) {
+        VkDescriptorSetLayoutBinding pyramidBinding{};
+        pyramidBinding.binding         = 0;
+        pyramidBinding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pyramidBinding.descriptorCount = 1;
+        pyramidBinding.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo occlusionCreateInfo{};
+        occlusionCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        occlusionCreateInfo.bindingCount = 1;
+        occlusionCreateInfo.pBindings    = &pyramidBinding;
+
+        LOG_RESULT(
+            vkCreateDescriptorSetLayout(device, &occlusionCreateInfo, nullptr, &occlusionSetLayout),
+            "Create occlusion cull descriptor set layout"
+        );
+
+        std::array<VkDescriptorSetLayoutBinding, 3> reduceBindings{};
+        reduceBindings[0] = pyramidBinding;
+
+        reduceBindings[1].binding         = 1;
+        reduceBindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        reduceBindings[1].descriptorCount = DEPTH_PYRAMID_MAX_LEVELS;
+        reduceBindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        reduceBindings[2].binding         = 2;
+        reduceBindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        reduceBindings[2].descriptorCount = 1;
+        reduceBindings[2].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo reduceCreateInfo{};
+        reduceCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        reduceCreateInfo.bindingCount = static_cast<uint32_t>(reduceBindings.size());
+        reduceCreateInfo.pBindings    = reduceBindings.data();
+
+        LOG_RESULT(
+            vkCreateDescriptorSetLayout(device, &reduceCreateInfo, nullptr, &depthPyramidSetLayout),
+            "Create depth pyramid descriptor set layout"
+        );
+    }
+
+
+    // Bindless Texture Set (set BINDLESS_TEXTURE_SET) --------------------------------
+    //  0 : texture array - slots are written while the set is bound (cached secondaries stay valid) or in use by a pending frame
+    //      (as long as that frame doesn't sample them), and only the registered ones are valid
+    if (bindlessTextures) {
+        VkDescriptorSetLayoutBinding texturesBinding{};
+        texturesBinding.binding         = 0;
+        texturesBinding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        texturesBinding.descriptorCount = std::min(BINDLESS_TEXTURE_CAPACITY, deviceFeatureSupport.maxBindlessTextures);
+        texturesBinding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount  = 1;
+        bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo bindlessCreateInfo{};
+        bindlessCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        bindlessCreateInfo.pNext        = &bindingFlagsInfo;
+        bindlessCreateInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        bindlessCreateInfo.bindingCount = 1;
+        bindlessCreateInfo.pBindings    = &texturesBinding;
+
+        LOG_RESULT(
+            vkCreateDescriptorSetLayout(device, &bindlessCreateInfo, nullptr, &bindlessSetLayout),
+            "Create bindless texture descriptor set layout"
+        );
+
+        textureRegistry.init(texturesBinding.descriptorCount, MAX_FRAMES_IN_FLIGHT);
+
+        // Stands in for set 1 when there is no meshlet set to put there
+        if (geometryPath != GeometryPath::MESHLET_MESH_SHADER) {
+            VkDescriptorSetLayoutCreateInfo emptyCreateInfo{};
+            emptyCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+            LOG_RESULT(
+                vkCreateDescriptorSetLayout(device, &emptyCreateInfo, nullptr, &emptySetLayout),
+                "Create empty descriptor set layout"
+            );
+        }
+    }
+
+
+    // Meshlet Set (set 1) --------------------------------
+    if (geometryPath == GeometryPath::INDEXED) return;
+
+    bool meshShader = (geometryPath == GeometryPath::MESHLET_MESH_SHADER);
+
+    //  0 : meshlets - 1 : draw commands (indirect path) - 2, 3, 4 : meshlet vertices, meshlet triangles, vertices (mesh shader path)
+    std::vector<VkDescriptorSetLayoutBinding> meshletBindings;
+
+    auto addStorageBinding = [&meshletBindings](uint32_t binding, VkShaderStageFlags stages){
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding         = binding;
+        layoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBinding.descriptorCount = 1;
+        layoutBinding.stageFlags      = stages;
+        meshletBindings.push_back(layoutBinding);
+    };
+
+    if (meshShader) {
+        addStorageBinding(0, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT);
+        addStorageBinding(2, VK_SHADER_STAGE_MESH_BIT_EXT);
+        addStorageBinding(3, VK_SHADER_STAGE_MESH_BIT_EXT);
+        addStorageBinding(4, VK_SHADER_STAGE_MESH_BIT_EXT);
+    } else {
+        addStorageBinding(0, VK_SHADER_STAGE_COMPUTE_BIT);
+        addStorageBinding(1, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    VkDescriptorSetLayoutCreateInfo meshletCreateInfo{};
+    meshletCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    meshletCreateInfo.bindingCount = static_cast<uint32_t>(meshletBindings.size());
+    meshletCreateInfo.pBindings    = meshletBindings.data();
+
+    LOG_RESULT(
+        vkCreateDescriptorSetLayout(device, &meshletCreateInfo, nullptr, &meshletSetLayout),
+        "Create meshlet descriptor set layout"
+    );
 }
 
 void Renderer::createGraphicsPipeline(){
     // Shader Stages --------------------------------
-    auto vertShaderCode = readFile(VERTEX_SHADER_CODE);
-    auto fragShaderCode = readFile(FRAGMENT_SHADER_CODE);
-
-    VkShaderModule vertShaderModule = createShaderModule("vertex", vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule("fragment", fragShaderCode);
-
-    // - Vertex Shader
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName  = "main";
-
-    // - Fragment Shader
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName  = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = {
-        vertShaderStageInfo,
-        fragShaderStageInfo
+    bool meshShader = (geometryPath == GeometryPath::MESHLET_MESH_SHADER);
+
+    std::vector<VkShaderModule>                  shaderModules;
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+    auto addShaderStage = [&](const std::string& name, const std::string& fileName, VkShaderStageFlagBits stage, const VkSpecializationInfo* specializationInfo){
+        shaderModules.push_back(createShaderModule(name, readFile(fileName)));
+
+        VkPipelineShaderStageCreateInfo shaderStageInfo{};
+        shaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStageInfo.stage               = stage;
+        shaderStageInfo.module              = shaderModules.back();
+        shaderStageInfo.pName               = "main";
+        shaderStageInfo.pSpecializationInfo = specializationInfo;
+        shaderStages.push_back(shaderStageInfo);
     };
 
+    // - Mesh shader path : the mesh shader decodes the vertex format itself
+    uint32_t                 vertexFormatConstant = static_cast<uint32_t>(vertexFormat);
+    VkSpecializationMapEntry vertexFormatEntry{ 0, 0, sizeof(uint32_t) };
+
+    VkSpecializationInfo vertexFormatInfo{};
+    vertexFormatInfo.mapEntryCount = 1;
+    vertexFormatInfo.pMapEntries   = &vertexFormatEntry;
+    vertexFormatInfo.dataSize      = sizeof(uint32_t);
+    vertexFormatInfo.pData         = &vertexFormatConstant;
+
+    if (meshShader) {
+        addShaderStage("task", MESHLET_TASK_SHADER_CODE, VK_SHADER_STAGE_TASK_BIT_EXT, nullptr);
+        addShaderStage("mesh", MESHLET_MESH_SHADER_CODE, VK_SHADER_STAGE_MESH_BIT_EXT, &vertexFormatInfo);
+    } else {
+        // - Vertex shader for the vertex layout of the loaded model
+        addShaderStage("vertex", (vertexFormat == VertexFormat::FULL)? VERTEX_SHADER_CODE : PACKED_VERTEX_SHADER_CODE, VK_SHADER_STAGE_VERTEX_BIT, nullptr);
+    }
+
+    // - Fragment Shader - sampling the instance's material out of the bindless array, or binding 1
+    addShaderStage("fragment", bindlessTextures? BINDLESS_FRAGMENT_SHADER_CODE : FRAGMENT_SHADER_CODE, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr);
+
 
     // Vertex Input --------------------------------
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-    auto bindingDescription    = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    // - Binding 0 : vertices, binding 1 : InstanceData
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+        Vertex::getBindingDescription(vertexFormat),
+        InstanceData::getBindingDescription()
+    };
+
+    auto attributeDescriptions = Vertex::getAttributeDescriptions(vertexFormat);
+    auto instanceAttributes    = InstanceData::getAttributeDescriptions();
+    attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
 
-    vertexInputInfo.vertexBindingDescriptionCount   = 1;
-    vertexInputInfo.pVertexBindingDescriptions      = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions      = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions    = attributeDescriptions.data();
 
@@ -655,10 +1124,21 @@ void Renderer::createGraphicsPipeline(){
     
 
     // Pipeline Layout --------------------------------
+    // - Mesh shader path : meshlet set + culling push constants
+    // - Bindless textures : texture set, after the meshlet set or an empty one
+    std::array<VkDescriptorSetLayout, 3> setLayouts = { descriptorSetLayout, meshShader? meshletSetLayout : emptySetLayout, bindlessSetLayout };
+
+    VkPushConstantRange cullConstantsRange{};
+    cullConstantsRange.stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    cullConstantsRange.offset     = 0;
+    cullConstantsRange.size       = sizeof(MeshletCullConstants);
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts    = &descriptorSetLayout;
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = bindlessTextures? 3 : meshShader? 2 : 1;
+    pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = meshShader? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges    = meshShader? &cullConstantsRange : nullptr;
 
     LOG_RESULT(
         vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout),
@@ -669,11 +1149,11 @@ void Renderer::createGraphicsPipeline(){
     // Pipeline Creation --------------------------------
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount          = 2;
-    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.stageCount          = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages             = shaderStages.data();
 
-    pipelineInfo.pVertexInputState   = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+    pipelineInfo.pVertexInputState   = meshShader? nullptr : &vertexInputInfo;        // Mesh pipelines have no vertex input
+    pipelineInfo.pInputAssemblyState = meshShader? nullptr : &inputAssemblyInfo;
     pipelineInfo.pViewportState      = &viewportInfo;
     pipelineInfo.pRasterizationState = &rasterizerInfo;
     pipelineInfo.pMultisampleState   = &multisamplingInfo;
@@ -682,9 +1162,18 @@ void Renderer::createGraphicsPipeline(){
     pipelineInfo.pDynamicState       = &dynamicStateInfo;
 
     pipelineInfo.layout              = pipelineLayout;
-    pipelineInfo.renderPass          = renderPass;
+    pipelineInfo.renderPass          = renderPass;          // VK_NULL_HANDLE with dynamic rendering - the formats below instead
     pipelineInfo.subpass             = 0;
 
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount    = 1;
+    renderingInfo.pColorAttachmentFormats = &swapchainImageFormat;
+    renderingInfo.depthAttachmentFormat   = depthFormat;
+    renderingInfo.stencilAttachmentFormat = hasStencilComponent(depthFormat)? depthFormat : VK_FORMAT_UNDEFINED;
+
+    if (dynamicRendering) pipelineInfo.pNext = &renderingInfo;
+
     LOG_RESULT(
         vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline),
         "Create graphics pipeline"
@@ -692,11 +1181,196 @@ void Renderer::createGraphicsPipeline(){
 
 
     // Cleanup --------------------------------
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    for (VkShaderModule shaderModule : shaderModules) {
+        vkDestroyShaderModule(device, shaderModule, nullptr);
+    }
+}
+
+void Renderer::createMeshletCullPipeline(){
+    if (geometryPath != GeometryPath::MESHLET_INDIRECT) return;
+
+    VkShaderModule cullShaderModule = createShaderModule("meshlet cull", readFile(MESHLET_CULL_SHADER_CODE));
+
+    // Compacted draws need vkCmdDrawIndexedIndirectCount to read the count back
+    VkBool32                 compactConstant = deviceFeatureSupport.drawIndirectCount;
+    VkSpecializationMapEntry compactEntry{ 0, 0, sizeof(VkBool32) };
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries   = &compactEntry;
+    specializationInfo.dataSize      = sizeof(VkBool32);
+    specializationInfo.pData         = &compactConstant;
+
+    VkPipelineShaderStageCreateInfo shaderStageInfo{};
+    shaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageInfo.module              = cullShaderModule;
+    shaderStageInfo.pName               = "main";
+    shaderStageInfo.pSpecializationInfo = &specializationInfo;
+
+
+    // Pipeline Layout --------------------------------
+    // Set 0 is unused - the meshlet set stays at index 1 like in the mesh shader pipeline
+    std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout, meshletSetLayout };
+
+    VkPushConstantRange cullConstantsRange{};
+    cullConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullConstantsRange.offset     = 0;
+    cullConstantsRange.size       = sizeof(MeshletCullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &cullConstantsRange;
+
+    LOG_RESULT(
+        vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &meshletCullPipelineLayout),
+        "Create meshlet cull pipeline layout"
+    );
+
+
+    // Pipeline Creation --------------------------------
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage  = shaderStageInfo;
+    pipelineInfo.layout = meshletCullPipelineLayout;
+
+    LOG_RESULT(
+        vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &meshletCullPipeline),
+        "Create meshlet cull pipeline"
+    );
+
+    vkDestroyShaderModule(device, cullShaderModule, nullptr);
+}
+
+void Renderer::createInstanceCullPipeline(){
+    if (!gpuInstanceCulling) return;
+
+    // The occlusion culling build adds the depth pyramid tests, and the bindings they need
+    VkShaderModule cullShaderModule = occlusionCulling? createShaderModule("occlusion cull", readFile(OCCLUSION_CULL_SHADER_CODE)) :
+                                                        createShaderModule("instance cull", readFile(INSTANCE_CULL_SHADER_CODE));
+
+    // Same as the meshlet cull - compacting needs vkCmdDrawIndexedIndirectCount
+    VkBool32                 compactConstant = deviceFeatureSupport.drawIndirectCount;
+    VkSpecializationMapEntry compactEntry{ 0, 0, sizeof(VkBool32) };
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries   = &compactEntry;
+    specializationInfo.dataSize      = sizeof(VkBool32);
+    specializationInfo.pData         = &compactConstant;
+
+    VkPipelineShaderStageCreateInfo shaderStageInfo{};
+    shaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageInfo.module              = cullShaderModule;
+    shaderStageInfo.pName               = "main";
+    shaderStageInfo.pSpecializationInfo = &specializationInfo;
+
+
+    // Pipeline Layout --------------------------------
+    std::array<VkDescriptorSetLayout, 2> setLayouts = { instanceCullSetLayout, occlusionSetLayout };
+
+    VkPushConstantRange cullConstantsRange{};
+    cullConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullConstantsRange.offset     = 0;
+    cullConstantsRange.size       = sizeof(InstanceCullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = occlusionCulling? 2 : 1;
+    pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &cullConstantsRange;
+
+    LOG_RESULT(
+        vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &instanceCullPipelineLayout),
+        "Create instance cull pipeline layout"
+    );
+
+
+    // Pipeline Creation --------------------------------
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage  = shaderStageInfo;
+    pipelineInfo.layout = instanceCullPipelineLayout;
+
+    LOG_RESULT(
+        vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &instanceCullPipeline),
+        "Create instance cull pipeline"
+    );
+
+    vkDestroyShaderModule(device, cullShaderModule, nullptr);
+}
+
+void Renderer::createDepthPyramidPipeline(){
+    if (!occlusionCulling) return;
+
+    VkShaderModule pyramidShaderModule = createShaderModule("depth pyramid", readFile(DEPTH_PYRAMID_SHADER_CODE));
+
+    VkPipelineShaderStageCreateInfo shaderStageInfo{};
+    shaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageInfo.module = pyramidShaderModule;
+    shaderStageInfo.pName  = "main";
+
+
+    // Pipeline Layout --------------------------------
+    VkPushConstantRange pyramidConstantsRange{};
+    pyramidConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pyramidConstantsRange.offset     = 0;
+    pyramidConstantsRange.size       = sizeof(DepthPyramidConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &depthPyramidSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pyramidConstantsRange;
+
+    LOG_RESULT(
+        vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &depthPyramidPipelineLayout),
+        "Create depth pyramid pipeline layout"
+    );
+
+
+    // Pipeline Creation --------------------------------
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage  = shaderStageInfo;
+    pipelineInfo.layout = depthPyramidPipelineLayout;
+
+    LOG_RESULT(
+        vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &depthPyramidPipeline),
+        "Create depth pyramid pipeline"
+    );
+
+    vkDestroyShaderModule(device, pyramidShaderModule, nullptr);
+
+
+    // Sampler --------------------------------
+    // The depth and the pyramids are only read with texelFetch
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter    = VK_FILTER_NEAREST;
+    samplerInfo.minFilter    = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod       = VK_LOD_CLAMP_NONE;
+
+    LOG_RESULT(
+        vkCreateSampler(device, &samplerInfo, nullptr, &depthPyramidSampler),
+        "Create depth pyramid sampler"
+    );
 }
 
 void Renderer::createFramebuffers(){
+    if (dynamicRendering) return;       // Rendering begins on the image views themselves
+
     swapchainFramebuffers.resize(swapchainImageViews.size());
 
     for (size_t i=0; i < swapchainImageViews.size(); ++i) {
@@ -754,12 +1428,14 @@ void Renderer::createCommandPools(){
 }
 
 void Renderer::createDepthResources(){
-    VkFormat depthFormat = findDepthFormat();   
+    // Occlusion culling samples it into the depth pyramids
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (occlusionCulling) usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
     createImage("depth", 
-                swapchainExtent.width, swapchainExtent.height, 
+                swapchainExtent.width, swapchainExtent.height, 1,
                 depthFormat, VK_IMAGE_TILING_OPTIMAL, 
-                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
+                usage, 
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
                 depthImage, depthImageMemory
     );
@@ -769,76 +1445,144 @@ void Renderer::createDepthResources(){
                                      VK_IMAGE_ASPECT_DEPTH_BIT
     );
 
-    transitionImageLayout(depthImage, 
-                          depthFormat, 
-                          VK_IMAGE_LAYOUT_UNDEFINED, 
-                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+
+    // Last Frame's Depth --------------------------------
+    // The first frame builds its early pyramid from the depth before it - cleared to the far plane, nothing is occluded
+    if (!occlusionCulling) return;
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = depthImage;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    if (hasStencilComponent(depthFormat)) barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(graphicsCommandPool);
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkClearDepthStencilValue clearValue = { 1.0f, 0 };
+    vkCmdClearDepthStencilImage(commandBuffer, depthImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &barrier.subresourceRange);
+
+    // The layout the render graph expects it in, see createRenderGraph()
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    endSingleTimeCommands(commandBuffer, graphicsCommandPool, graphicsQueue);
+}
+
+void Renderer::createPlaceholderTexture(){
+    createImage("placeholder",
+                1, 1, 1,
+                VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                placeholderImage, placeholderImageMemory
     );
+
+    // Goes out with the model's uploads
+    MipLevel level{};
+    level.width  = 1;
+    level.height = 1;
+    level.size   = sizeof(TEXTURE_PLACEHOLDER_COLOR);
+
+    uploadBatcher.uploadImage(placeholderImage, 1, { level }, TEXTURE_PLACEHOLDER_COLOR, level.size,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    placeholderImageView = createImageView("placeholder", placeholderImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
 void Renderer::createTextureImage(){
-    int texWidth, texHeight, texChannels;
+    bool compressed = USE_COMPRESSED_TEXTURES && deviceFeatureSupport.textureCompressionBC;
 
-    stbi_uc* pixels = stbi_load(MODEL_TEXTURE, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels) LOG_FATAL("Failed to load texture image");
+    textureStream.startTime = std::chrono::high_resolution_clock::now();
 
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
 
+    // Background load - picked up by updateTextureStream() every frame
+    if (STREAM_TEXTURES && transferTimeline != VK_NULL_HANDLE) {
+        TextureStream& stream = textureStream;
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer("staging",
-                 imageSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory
-    );
+        stream.state   = TextureStreamState::DECODING;
+        stream.decoded = ThreadPool::get().submit([&stream, compressed](){
+            return decodeTexture(stream, compressed, false);
+        });
 
+        LOG_TRACE_S("Streaming texture : " << MODEL_TEXTURE);
+        return;
+    }
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
 
-    stbi_image_free(pixels);
+    // Blocking load - the mip chain can be blitted on the GPU from the base level
+    bool gpuMipmaps = GENERATE_MIPMAPS_ON_GPU && checkLinearBlitSupport(VK_FORMAT_R8G8B8A8_SRGB);
+
+    if (!decodeTexture(textureStream, compressed, gpuMipmaps)) {
+        LOG_FATAL_S("Failed to load texture : " << MODEL_TEXTURE);
+    }
+
+    TextureStream& stream = textureStream;
+
+    textureFormat    = stream.format;
+    textureMipLevels = stream.mipLevels;
+
+    bool blitMipmaps = stream.levels.size() < stream.mipLevels;
+
+    LOG_TRACE_S("Texture mip chain : " << textureMipLevels << " levels, " << (blitMipmaps? "blitted on the GPU" : "uploaded"));
+
 
-    
     createImage("texture", 
-                texWidth, texHeight, 
-                VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, 
-                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+                stream.width, stream.height, textureMipLevels,
+                textureFormat, VK_IMAGE_TILING_OPTIMAL, 
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 textureImage, textureImageMemory
     );
 
+    // Blits need the graphics queue - the first frame records them once the image is acquired
+    if (blitMipmaps) {
+        uploadBatcher.uploadImage(textureImage, textureMipLevels, stream.levels, stream.getData(), stream.getSize(),
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        textureMipmapsPending = true;
+    } else {
+        uploadBatcher.uploadImage(textureImage, textureMipLevels, stream.levels, stream.getData(), stream.getSize(),
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
 
-    transitionImageLayout(textureImage, 
-                          VK_FORMAT_R8G8B8A8_SRGB, 
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
-
-    copyBufferToImage(stagingBuffer, textureImage,
-                      static_cast<uint32_t>(texWidth),
-                      static_cast<uint32_t>(texHeight)
-    );
-
-    transitionImageLayout(textureImage,
-                          VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    );
 
+    std::vector<uint8_t>().swap(stream.pixels);
+    stream.cache.close();
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    createTextureImageView();
+    stream.state = TextureStreamState::READY;
 }
 
 void Renderer::createTextureImageView(){
+    // Single channel textures are grayscale
+    VkComponentMapping components{};
+    if (textureFormat == VK_FORMAT_BC4_UNORM_BLOCK) {
+        components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+    }
+
     textureImageView = createImageView("texture", 
                                        textureImage, 
-                                       VK_FORMAT_R8G8B8A8_SRGB,
-                                       VK_IMAGE_ASPECT_COLOR_BIT
+                                       textureFormat,
+                                       VK_IMAGE_ASPECT_COLOR_BIT,
+                                       textureMipLevels,
+                                       components
     );
 }
 
@@ -865,7 +1609,7 @@ void Renderer::createTextureSampler(){
     createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     createInfo.mipLodBias = 0.0f;
     createInfo.minLod     = 0.0f;
-    createInfo.maxLod     = 0.0f;
+    createInfo.maxLod     = VK_LOD_CLAMP_NONE;         // Created before a streamed texture's mip count is known
 
     LOG_RESULT(
         vkCreateSampler(device, &createInfo, nullptr, &textureSampler), 
@@ -874,213 +1618,698 @@ void Renderer::createTextureSampler(){
 }
 
 void Renderer::loadModel(){
-    tinyobj::attrib_t                attrib;
-    std::vector<tinyobj::shape_t>    shapes;
-    std::vector<tinyobj::material_t> materials;
-
-    std::string warn, err;
+    uint64_t sourceHash = 0, sourceSize = 0;
+    if (!MeshCache::hashSource(MODEL, sourceHash, sourceSize)) {
+        LOG_FATAL_S("Failed to open model : " << MODEL);
+    }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL)) {
-        LOG_ERROR_S("Failed to load model : " << warn + err);
+    if (meshCache.open(MODEL_CACHE, sourceHash, sourceSize)) {
+        if ((meshCache.getVertexFormat() != VertexFormat::FULL) == USE_PACKED_VERTICES) {
+            LOG_TRACE_S("Loaded model from mesh cache : " << MODEL_CACHE);
+            useMeshCache();
+            return;
+        }
+        LOG_DEBUG_S("Mesh cache " << MODEL_CACHE << " was cooked with another vertex format");
+        meshCache.close();
     }
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
 
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
+    // Missing or stale cache - re-cook it
+    LOG_INFO_S("Cooking model : " << MODEL << " -> " << MODEL_CACHE);
 
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
+    if (!MeshLoader::loadObj(MODEL, vertices, vertexIndices)) {
+        LOG_FATAL_S("Failed to load model : " << MODEL);
+    }
 
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+    MeshOptimizer::optimize(vertices, vertexIndices);
+    MeshSimplifier::buildLods(vertices, vertexIndices, lods);
+    MeshletBuilder::build(vertices, vertexIndices, lods, meshletData);
+
+    // Upload from the new cache like any other launch - keep the in-memory copy if it couldn't be written
+    if (MeshCache::write(MODEL_CACHE, vertices, vertexIndices, lods, meshletData, sourceHash, sourceSize, USE_PACKED_VERTICES) &&
+        meshCache.open(MODEL_CACHE, sourceHash, sourceSize))
+    {
+        std::vector<Vertex>().swap(vertices);
+        std::vector<uint32_t>().swap(vertexIndices);
+        meshletData.clear();
+        useMeshCache();
+        return;
+    }
 
-            vertex.color = { 1.0f, 1.0f, 1.0f };
+    vertexCount  = static_cast<uint32_t>(vertices.size());
+    indexCount   = static_cast<uint32_t>(vertexIndices.size());
+    meshletCount = static_cast<uint32_t>(meshletData.meshlets.size());
 
-            // vertices.push_back(vertex);
-            // vertexIndices.push_back(vertexIndices.size());
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            vertexIndices.push_back(uniqueVertices[vertex]);
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    boundsCenter = (boundsMin + boundsMax) * 0.5f;
+    boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+}
+
+void Renderer::useMeshCache(){
+    const MeshCacheHeader& header = meshCache.getHeader();
+
+    vertexCount  = static_cast<uint32_t>(header.vertexCount);
+    indexCount   = static_cast<uint32_t>(header.indexCount);
+    meshletCount = static_cast<uint32_t>(header.meshletCount);
+    vertexFormat = meshCache.getVertexFormat();
+    indexType    = meshCache.getIndexType();
+
+    if (vertexFormat != VertexFormat::FULL) {
+        vertexDequantization = PackedVertex::getDequantizationMatrix(glm::make_vec3(header.boundsMin), glm::make_vec3(header.boundsMax));
+    }
+
+    lods.assign(header.lods, header.lods + header.lodCount);
+    boundsCenter = (glm::make_vec3(header.boundsMin) + glm::make_vec3(header.boundsMax)) * 0.5f;
+    boundsRadius = glm::length(glm::make_vec3(header.boundsMax) - glm::make_vec3(header.boundsMin)) * 0.5f;
+}
+
+void Renderer::selectGeometryPath(){
+    geometryPath = GeometryPath::INDEXED;
+
+    // LOD 0 has the most meshlets, so it sets the size of the indirect draws
+    uint32_t drawCount = lods.empty()? 0 : lods[0].meshletCount;
+
+    if (USE_MESHLET_CULLING && meshletCount > 0 && OBJECT_COUNT > 1) {
+        LOG_INFO_S("Meshlet culling draws a single instance - drawing the " << OBJECT_COUNT << " objects indexed and instanced instead");
+    } else if (USE_MESHLET_CULLING && meshletCount > 0) {
+        if (deviceFeatureSupport.meshShader && cmdDrawMeshTasks) {
+            geometryPath = GeometryPath::MESHLET_MESH_SHADER;
+        } else if (deviceFeatureSupport.multiDrawIndirect && drawCount <= deviceFeatureSupport.maxDrawIndirectCount) {
+            geometryPath = GeometryPath::MESHLET_INDIRECT;
+        } else {
+            LOG_WARNING_S("Meshlet culling needs mesh shaders or multiDrawIndirect (" << drawCount << " draws) - drawing the whole mesh");
         }
     }
+
+    const char* pathName = (geometryPath == GeometryPath::MESHLET_MESH_SHADER)? "mesh shader meshlets" :
+                           (geometryPath == GeometryPath::MESHLET_INDIRECT)?    "compute culled indirect meshlets" :
+                                                                                "indexed";
+    LOG_INFO_S("Geometry path : " << pathName << " (" << meshletCount << " meshlets, " << lods.size() << " LODs)");
+
+    // One indirect draw per instance, each pointing at its own instance - the meshlet paths draw the first instance alone
+    gpuInstanceCulling = USE_GPU_INSTANCE_CULLING && geometryPath == GeometryPath::INDEXED;
+
+    if (gpuInstanceCulling && !(deviceFeatureSupport.multiDrawIndirect && deviceFeatureSupport.drawIndirectFirstInstance &&
+                                MAX_INSTANCES <= deviceFeatureSupport.maxDrawIndirectCount)) {
+        LOG_WARNING_S("GPU instance culling needs multiDrawIndirect and drawIndirectFirstInstance (" << MAX_INSTANCES << " draws) - culling on the CPU");
+        gpuInstanceCulling = false;
+    }
+
+    // The meshlet paths draw the first instance whether it's in view or not - its meshlets are culled instead
+    cpuInstanceCulling = USE_CPU_INSTANCE_CULLING && geometryPath == GeometryPath::INDEXED && !gpuInstanceCulling;
+
+    // The late phase's draws are a list - there's no slot per instance to leave empty
+    occlusionCulling = USE_OCCLUSION_CULLING && gpuInstanceCulling;
+
+    if (USE_OCCLUSION_CULLING && geometryPath != GeometryPath::INDEXED) {
+        LOG_INFO("Occlusion culling tests instances, the meshlet paths only frustum and cone cull their meshlets");
+    }
+
+    if (occlusionCulling && !(deviceFeatureSupport.drawIndirectCount && deviceFeatureSupport.storageImageArrayIndexing)) {
+        LOG_WARNING("Occlusion culling needs drawIndirectCount and shaderStorageImageArrayDynamicIndexing - frustum culling only");
+        occlusionCulling = false;
+    }
+
+    if (gpuInstanceCulling) {
+        LOG_INFO_S("Instance culling : compute, " << (deviceFeatureSupport.drawIndirectCount? "compacted indirect count draw" : "indirect draw")
+                   << (occlusionCulling? ", two phase depth pyramid occlusion" : ""));
+    } else if (cpuInstanceCulling) {
+        LOG_INFO_S("Instance culling : CPU, " << FrustumCuller::getKernelName(FrustumCuller::getBestKernel()) << " on " << ThreadPool::get().getThreadCount() << " threads");
+    }
 }
 
-void Renderer::createVertexBuffer(){
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+void Renderer::createObjects(){
+    uint32_t objectCount = std::min(OBJECT_COUNT, MAX_INSTANCES);
 
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer("staging",
-                 bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory
-    );
+    scene.clear();
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+    // Copies of the model hang off an undrawn grid node - moving it moves them all
+    NodeId grid = scene.addNode(NodeTransform{}, NO_PARENT, false);
 
-    createBuffer("vertex",
-                 bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 vertexBuffer, vertexBufferMemory
-    );
+    // Square grid around the origin, far enough apart for the bounding spheres not to overlap - a single object stays at the origin
+    uint32_t side    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+    float    spacing = boundsRadius * 2.5f;
+
+    for (uint32_t i=0; i < objectCount; ++i) {
+        glm::vec2 cell = glm::vec2(i % side, i / side) - (side - 1) * 0.5f;
+
+        NodeTransform transform;
+        transform.translation = glm::vec3(cell * spacing, 0.0f);
+
+        scene.addNode(transform, grid);
+    }
+
+    lodInstanceCounts.assign(lods.size(), 0);
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    LOG_TRACE_S("Objects : " << objectCount);
+}
+
+void Renderer::createVertexBuffer(){
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(Vertex::getStride(vertexFormat)) * vertexCount;
+    const void*  vertexData = meshCache.isOpen()? meshCache.getVertexData() : vertices.data();
+
+    // The mesh shader fetches vertices itself
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    if (geometryPath == GeometryPath::MESHLET_MESH_SHADER) usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    createDeviceLocalBuffer("vertex", vertexData, bufferSize, usage, vertexBuffer, vertexBufferMemory);
 }
 
 void Renderer::createIndexBuffer(){
-    VkDeviceSize bufferSize = sizeof(vertexIndices[0]) * vertexIndices.size();
+    VkDeviceSize bufferSize = ((indexType == VK_INDEX_TYPE_UINT16)? sizeof(uint16_t) : sizeof(uint32_t)) * indexCount;
+    const void*  indexData  = meshCache.isOpen()? meshCache.getIndexData() : vertexIndices.data();
 
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer("staging",
-                 bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory
-    );
+    createDeviceLocalBuffer("index", indexData, bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexBufferMemory);
+}
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertexIndices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+void Renderer::createMeshletBuffers(){
+    if (geometryPath == GeometryPath::INDEXED) return;
 
-    createBuffer("index",
-                 bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 indexBuffer, indexBufferMemory
+    bool cached = meshCache.isOpen();
+
+    createDeviceLocalBuffer("meshlet",
+                            cached? meshCache.getMeshlets() : meshletData.meshlets.data(),
+                            sizeof(Meshlet) * meshletCount,
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            meshletBuffer, meshletBufferMemory
     );
 
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    if (geometryPath == GeometryPath::MESHLET_MESH_SHADER) {
+        VkDeviceSize meshletVertexCount = cached? meshCache.getHeader().meshletVertexCount : meshletData.vertices.size();
+
+        createDeviceLocalBuffer("meshlet vertex",
+                                cached? meshCache.getMeshletVertices() : meshletData.vertices.data(),
+                                sizeof(uint32_t) * meshletVertexCount,
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                meshletVertexBuffer, meshletVertexBufferMemory
+        );
+        createDeviceLocalBuffer("meshlet triangle",
+                                cached? meshCache.getMeshletTriangles() : meshletData.triangles.data(),
+                                sizeof(uint32_t) * (indexCount / 3),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                meshletTriangleBuffer, meshletTriangleBufferMemory
+        );
+        return;
+    }
+
+    // Indirect path - draw count (padded to 16 bytes) followed by one VkDrawIndexedIndirectCommand per meshlet,
+    // rewritten by the cull shader every frame
+    // LOD 0 has the most meshlets
+    VkDeviceSize drawBufferSize = MESHLET_DRAW_COMMANDS_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * lods[0].meshletCount;
+
+    meshletDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    meshletDrawBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        createBuffer("meshlet draw",
+                     drawBufferSize,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     meshletDrawBuffers[i], meshletDrawBuffersMemory[i]
+        );
+    }
 }
 
-void Renderer::createUniformBuffers(){
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+void Renderer::createInstanceCullBuffers(){
+    if (!gpuInstanceCulling) return;
+
+    // What the cull shader needs to know about the model - its bounds and the index range of each LOD
+    CullMesh header{};
+    header.boundingSphere = glm::vec4(boundsCenter, boundsRadius);
+    header.lodCount       = static_cast<uint32_t>(lods.size());
+
+    std::vector<uint8_t> meshData(sizeof(CullMesh) + sizeof(MeshLod) * lods.size());
+    std::memcpy(meshData.data(), &header, sizeof(CullMesh));
+    std::memcpy(meshData.data() + sizeof(CullMesh), lods.data(), sizeof(MeshLod) * lods.size());
 
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    createDeviceLocalBuffer("cull mesh", meshData.data(), meshData.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, cullMeshBuffer, cullMeshBufferMemory);
+
+    // Draw count (padded to 16 bytes) followed by one VkDrawIndexedIndirectCommand per instance, rewritten every frame
+    VkDeviceSize drawBufferSize = INSTANCE_DRAW_COMMANDS_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * MAX_INSTANCES;
+
+    instanceDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    instanceDrawBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
     for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        createBuffer("uniform", 
-                     bufferSize, 
-                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                     uniformBuffers[i], uniformBuffersMemory[i]
+        createBuffer("instance draw",
+                     drawBufferSize,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     instanceDrawBuffers[i], instanceDrawBuffersMemory[i]
         );
+    }
+
 
-        vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+    // Occlusion Culling --------------------------------
+    // The late phase's draws, and the instances the early phase rejected - count (padded to 16 bytes), then one index each
+    if (!occlusionCulling) return;
+
+    lateDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    lateDrawBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    occludedInstanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    occludedInstanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        createBuffer("late draw",
+                     drawBufferSize,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     lateDrawBuffers[i], lateDrawBuffersMemory[i]
+        );
+        createBuffer("occluded instance",
+                     INSTANCE_DRAW_COMMANDS_OFFSET + sizeof(uint32_t) * MAX_INSTANCES,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     occludedInstanceBuffers[i], occludedInstanceBuffersMemory[i]
+        );
     }
+
+    // Zero between dispatches - the last workgroup of each puts it back
+    uint32_t finishedTiles = 0;
+    createDeviceLocalBuffer("depth pyramid counter", &finishedTiles, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            depthPyramidCounter, depthPyramidCounterMemory);
+}
+
+void Renderer::submitUploads(){
+    // Everything uploaded during init goes out as one batch - the first frame acquires it
+    uploadBatcher.acquire(uploadBatcher.submit());
+}
+
+void Renderer::releaseModelData(){
+    // Geometry lives in the GPU buffers from here on
+    meshCache.close();
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint32_t>().swap(vertexIndices);
+    meshletData.clear();
 }
 
-void Renderer::createDescriptorPool(){
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+void Renderer::createFrameRing(){
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 
-    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    uniformAlignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+    storageAlignment = deviceProperties.limits.minStorageBufferOffsetAlignment;
+
+    if (sizeof(InstanceData) * MAX_INSTANCES > deviceProperties.limits.maxStorageBufferRange) {
+        LOG_FATAL_S("MAX_INSTANCES (" << MAX_INSTANCES << ") exceeds maxStorageBufferRange");
+    }
+
+    // One region per frame in flight, rewritten once the frame's fence is signalled
+    createBuffer("frame ring",
+                 FRAME_RING_SIZE * MAX_FRAMES_IN_FLIGHT,
+                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 frameRingBuffer, frameRingMemory
+    );
 
+    frameRing.init(frameRingMemory.mapped, FRAME_RING_SIZE, MAX_FRAMES_IN_FLIGHT);
+}
 
-    VkDescriptorPoolCreateInfo createInfo{};
-    createInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    createInfo.pPoolSizes    = poolSizes.data();
-    createInfo.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+void Renderer::createDescriptorAllocator(){
+    // Per set, on average - frame sets (a uniform buffer, a texture, instances), meshlet sets (2 to 4 storage buffers),
+    // instance cull sets (instances, 2 to 4 storage buffers, uniforms) and the occlusion culling ones allocated every frame
+    // (the depth pyramid sets, DEPTH_PYRAMID_MAX_LEVELS storage images each)
+    descriptorAllocator.init(device, {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         3.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          8.0f }
+    }, MAX_FRAMES_IN_FLIGHT);
+
+
+    // Bindless Texture Pool --------------------------------
+    // Update after bind sets need a pool of their own
+    if (!bindlessTextures) return;
+
+    VkDescriptorPoolSize bindlessPoolSize{};
+    bindlessPoolSize.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindlessPoolSize.descriptorCount = textureRegistry.getCapacity() * MAX_FRAMES_IN_FLIGHT;
+
+    VkDescriptorPoolCreateInfo bindlessCreateInfo{};
+    bindlessCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    bindlessCreateInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    bindlessCreateInfo.poolSizeCount = 1;
+    bindlessCreateInfo.pPoolSizes    = &bindlessPoolSize;
+    bindlessCreateInfo.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
     LOG_RESULT(
-        vkCreateDescriptorPool(device, &createInfo, nullptr, &descriptorPool),
-        "Create descriptor pool"
+        vkCreateDescriptorPool(device, &bindlessCreateInfo, nullptr, &bindlessDescriptorPool),
+        "Create bindless texture descriptor pool"
     );
 }
 
 void Renderer::createDescriptorSets(){
+    // Frame Sets --------------------------------
+    struct FrameSetDescriptors {
+        VkDescriptorBufferInfo uniforms;
+        VkDescriptorImageInfo  texture;
+        VkDescriptorBufferInfo instances;
+    };
+
+    VkDescriptorUpdateTemplate frameSetTemplate = descriptorAllocator.createTemplate(descriptorSetLayout, {
+        { 0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, offsetof(FrameSetDescriptors, uniforms),  0 },
+        { 1, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(FrameSetDescriptors, texture),   0 },
+        { 2, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, offsetof(FrameSetDescriptors, instances), 0 }
+    });
+
+    // Every frame points at the start of the frame ring - the dynamic offsets move the ranges into the frame's region
+    FrameSetDescriptors frameDescriptors{};
+    frameDescriptors.uniforms  = { frameRingBuffer, 0, sizeof(UniformBufferObject) };
+    frameDescriptors.texture   = { textureSampler, placeholderImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };   // Until updateTextureStream() swaps the texture in
+    frameDescriptors.instances = { frameRingBuffer, 0, sizeof(InstanceData) * MAX_INSTANCES };
+
     descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    
 
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        descriptorSets[i] = descriptorAllocator.allocate(descriptorSetLayout);
+        descriptorAllocator.update(descriptorSets[i], frameSetTemplate, &frameDescriptors);
+    }
+
 
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts        = layouts.data();
+    // Bindless Texture Sets --------------------------------
+    // One per frame, so the model texture replaces the placeholder in each as its frame comes up - registered textures go in all
+    if (bindlessTextures) {
+        bindlessDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 
+        std::vector<VkDescriptorSetLayout> bindlessLayouts(MAX_FRAMES_IN_FLIGHT, bindlessSetLayout);
 
-    LOG_RESULT(
-        vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()),
-        "Allocate descriptor sets"
-    );
+        VkDescriptorSetAllocateInfo bindlessAllocInfo{};
+        bindlessAllocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        bindlessAllocInfo.descriptorPool     = bindlessDescriptorPool;
+        bindlessAllocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        bindlessAllocInfo.pSetLayouts        = bindlessLayouts.data();
 
+        LOG_RESULT(
+            vkAllocateDescriptorSets(device, &bindlessAllocInfo, bindlessDescriptorSets.data()),
+            "Allocate bindless texture descriptor sets"
+        );
 
-    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range  = VK_WHOLE_SIZE;     // sizeof(UniformBufferObject)
+        // The first slot - the material instances default to
+        modelTextureSlot = textureRegistry.allocate();
+
+        for (uint32_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            writeBindlessDescriptor(i, modelTextureSlot, placeholderImageView, textureSampler);
+        }
+    }
+
+
+    // Instance Cull Sets --------------------------------
+    if (gpuInstanceCulling) {
+        // Instances and uniforms as in the frame set - bound with the same dynamic offsets
+        std::array<VkDescriptorBufferInfo, 6> bufferInfos{};
+        bufferInfos[0] = { frameRingBuffer, 0, sizeof(InstanceData) * MAX_INSTANCES };
+        bufferInfos[1] = { cullMeshBuffer,  0, VK_WHOLE_SIZE };
+        bufferInfos[3] = { frameRingBuffer, 0, sizeof(UniformBufferObject) };
+
+        std::vector<VkDescriptorUpdateTemplateEntry> entries = {
+            { 0, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0,                                  0 },
+            { 1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         sizeof(VkDescriptorBufferInfo),     0 },
+            { 2, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         sizeof(VkDescriptorBufferInfo) * 2, 0 }
+        };
 
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView   = textureImageView;
-        imageInfo.sampler     = textureSampler;
+        if (occlusionCulling) {
+            entries.push_back({ 3, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(VkDescriptorBufferInfo) * 3, 0 });
+            entries.push_back({ 4, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         sizeof(VkDescriptorBufferInfo) * 4, 0 });
+            entries.push_back({ 5, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         sizeof(VkDescriptorBufferInfo) * 5, 0 });
+        }
+
+        VkDescriptorUpdateTemplate cullSetTemplate = descriptorAllocator.createTemplate(instanceCullSetLayout, entries);
+
+        instanceCullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+
+        for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            bufferInfos[2] = { instanceDrawBuffers[i], 0, VK_WHOLE_SIZE };
+
+            if (occlusionCulling) {
+                bufferInfos[4] = { occludedInstanceBuffers[i], 0, VK_WHOLE_SIZE };
+                bufferInfos[5] = { lateDrawBuffers[i],         0, VK_WHOLE_SIZE };
+            }
+
+            instanceCullDescriptorSets[i] = descriptorAllocator.allocate(instanceCullSetLayout);
+            descriptorAllocator.update(instanceCullDescriptorSets[i], cullSetTemplate, bufferInfos.data());
+        }
+    }
 
 
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    // Occlusion Cull & Depth Pyramid Templates --------------------------------
+    // Their sets point at the render graph's pyramids - allocated every frame, see writeOcclusionDescriptors()
+    if (occlusionCulling) {
+        occlusionSetTemplate = descriptorAllocator.createTemplate(occlusionSetLayout, {
+            { 0, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, 0 }
+        });
+
+        depthPyramidSetTemplate = descriptorAllocator.createTemplate(depthPyramidSetLayout, {
+            { 0, 0, 1,                        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(DepthPyramidDescriptors, depth),   0 },
+            { 1, 0, DEPTH_PYRAMID_MAX_LEVELS, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          offsetof(DepthPyramidDescriptors, levels),  sizeof(VkDescriptorImageInfo) },
+            { 2, 0, 1,                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         offsetof(DepthPyramidDescriptors, counter), 0 }
+        });
+    }
 
-        descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet          = descriptorSets[i];
-        descriptorWrites[0].dstBinding      = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo     = &bufferInfo;
 
-        descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet          = descriptorSets[i];
-        descriptorWrites[1].dstBinding      = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo      = &imageInfo;
+    // Meshlet Sets --------------------------------
+    if (geometryPath == GeometryPath::INDEXED) return;
 
+    // Binding, buffer - the draw buffer (indirect path) changes per frame
+    std::vector<std::pair<uint32_t, VkBuffer>> bindings = { {0, meshletBuffer} };
 
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    if (geometryPath == GeometryPath::MESHLET_MESH_SHADER) {
+        bindings.push_back({2, meshletVertexBuffer});
+        bindings.push_back({3, meshletTriangleBuffer});
+        bindings.push_back({4, vertexBuffer});
+    } else {
+        bindings.push_back({1, VK_NULL_HANDLE});
+    }
+
+    std::vector<VkDescriptorBufferInfo>          bufferInfos(bindings.size());
+    std::vector<VkDescriptorUpdateTemplateEntry> entries(bindings.size());
+
+    for (size_t b=0; b < bindings.size(); ++b) {
+        bufferInfos[b] = { bindings[b].second, 0, VK_WHOLE_SIZE };
+        entries[b]     = { bindings[b].first, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, sizeof(VkDescriptorBufferInfo) * b, 0 };
+    }
+
+    VkDescriptorUpdateTemplate meshletSetTemplate = descriptorAllocator.createTemplate(meshletSetLayout, entries);
+
+    meshletDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i=0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        if (geometryPath == GeometryPath::MESHLET_INDIRECT) bufferInfos[1].buffer = meshletDrawBuffers[i];
+
+        meshletDescriptorSets[i] = descriptorAllocator.allocate(meshletSetLayout);
+        descriptorAllocator.update(meshletDescriptorSets[i], meshletSetTemplate, bufferInfos.data());
     }
 }
 
-void Renderer::createGraphicsCommandBuffers(){
-    graphicsCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+void Renderer::createFrameCommands(){
+    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+    // Reset as a whole every frame, never per command buffer
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool        = graphicsCommandPool;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(graphicsCommandBuffers.size());
+    allocInfo.commandBufferCount = 1;
 
-    LOG_RESULT(
-        vkAllocateCommandBuffers(device, &allocInfo, graphicsCommandBuffers.data()),
-        "Allocate graphics command buffers"
-    );
+    // Every thread that may take part in recording gets a pool of its own
+    uint32_t workerCount = ThreadPool::get().getThreadCount();
+
+    frameCommands.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (FrameCommands& commands : frameCommands) {
+        LOG_RESULT(
+            vkCreateCommandPool(device, &poolInfo, nullptr, &commands.primaryPool),
+            "Create frame command pool"
+        );
+
+        allocInfo.commandPool = commands.primaryPool;
+        allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+        LOG_RESULT(
+            vkAllocateCommandBuffers(device, &allocInfo, &commands.primary),
+            "Allocate frame command buffer"
+        );
+
+        commands.workerPools.resize(workerCount);
+        commands.secondaries.resize(workerCount);
+
+        for (uint32_t w=0; w < workerCount; ++w) {
+            LOG_RESULT(
+                vkCreateCommandPool(device, &poolInfo, nullptr, &commands.workerPools[w]),
+                "Create worker command pool"
+            );
+
+            allocInfo.commandPool = commands.workerPools[w];
+            allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+            LOG_RESULT(
+                vkAllocateCommandBuffers(device, &allocInfo, &commands.secondaries[w]),
+                "Allocate secondary command buffer"
+            );
+        }
+
+        // Recorded right after the others, on the same thread
+        if (occlusionCulling) {
+            allocInfo.commandPool = commands.workerPools[0];
+
+            LOG_RESULT(
+                vkAllocateCommandBuffers(device, &allocInfo, &commands.lateSecondary),
+                "Allocate late secondary command buffer"
+            );
+        }
+    }
+
+    LOG_TRACE_S("Frame commands : " << workerCount << " worker pools per frame in flight");
+}
+
+void Renderer::createRenderGraph(){
+    renderGraph.init(device, gpuAllocator, deviceFeatureSupport.synchronization2);
+
+    // Resources --------------------------------
+    // The images are bound per frame - only the depth pyramids depend on the swapchain extent, the graph is rebuilt with it
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencilComponent(depthFormat)) depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    // The acquire semaphore is waited on at the color attachment output stage, the barrier chains onto it
+    swapchainResource = renderGraph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED },
+                                                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    // Shared by the frames in flight - the previous frame's depth tests come first, its contents only matter to occlusion culling
+    // (the next frame's first pyramid is built from them)
+    VkImageLayout depthLayout = occlusionCulling? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+
+    depthResource = renderGraph.importImage("depth", depthAspect,
+                                            { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                              VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, depthLayout },
+                                            depthLayout);
+
+    // Per frame in flight, so its previous use is fenced
+    bool gpuCulling = geometryPath == GeometryPath::MESHLET_INDIRECT || gpuInstanceCulling;
+    drawBufferResource = gpuCulling? renderGraph.importBuffer("draw buffer") : NO_RESOURCE;
+
+    if (occlusionCulling) {
+        lateDrawResource = renderGraph.importBuffer("late draw buffer");
+        occludedResource = renderGraph.importBuffer("occluded instances");
+
+        // Shared by the frames in flight, like the depth
+        pyramidCounterResource = renderGraph.importBuffer("depth pyramid counter",
+                                                          { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT });
+
+        // The largest power of two that fits in the extent, so every texel covers at most 2x2 depth samples and each level halves
+        // the previous one exactly
+        auto floorPowerOfTwo = [](uint32_t value){
+            uint32_t power = 1;
+            while (power * 2 <= value && power < (1u << (DEPTH_PYRAMID_MAX_LEVELS - 1))) power *= 2;
+            return power;
+        };
+
+        depthPyramidExtent = { floorPowerOfTwo(swapchainExtent.width), floorPowerOfTwo(swapchainExtent.height) };
+        depthPyramidLevels = 1;
+        while ((std::max(depthPyramidExtent.width, depthPyramidExtent.height) >> depthPyramidLevels) > 0) ++depthPyramidLevels;
+
+        TransientImageDesc pyramidDesc{};
+        pyramidDesc.format    = VK_FORMAT_R32_SFLOAT;
+        pyramidDesc.extent    = depthPyramidExtent;
+        pyramidDesc.mipLevels = depthPyramidLevels;
+        pyramidDesc.usage     = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+        // Never alive at the same time - they share memory
+        pyramidResources[0] = renderGraph.createImage("depth pyramid (previous)", pyramidDesc);
+        pyramidResources[1] = renderGraph.createImage("depth pyramid", pyramidDesc);
+    }
+
+
+    // Cull --------------------------------
+    // Compute culling has to run outside of the render pass
+    if (gpuCulling && deviceFeatureSupport.drawIndirectCount) {
+        uint32_t reset = renderGraph.addPass("cull reset", [this](VkCommandBuffer commandBuffer){
+            vkCmdFillBuffer(commandBuffer, renderGraph.getBuffer(drawBufferResource), 0, sizeof(uint32_t), 0);
+
+            if (occlusionCulling) {
+                vkCmdFillBuffer(commandBuffer, renderGraph.getBuffer(lateDrawResource), 0, sizeof(uint32_t), 0);
+                vkCmdFillBuffer(commandBuffer, renderGraph.getBuffer(occludedResource), 0, sizeof(uint32_t), 0);
+            }
+        });
+        renderGraph.write(reset, drawBufferResource, { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT });
+
+        if (occlusionCulling) {
+            renderGraph.write(reset, lateDrawResource, { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT });
+            renderGraph.write(reset, occludedResource, { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT });
+        }
+    }
+
+    // Occlusion culling - a depth pyramid out of the depth as it is, tested against by the following cull
+    auto addDepthPyramid = [this](const std::string& name, uint32_t pyramid){
+        uint32_t reduce = renderGraph.addPass(name, [this, pyramid](VkCommandBuffer commandBuffer){ recordDepthPyramid(commandBuffer, pyramid); });
+
+        renderGraph.read(reduce, depthResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+                                                  VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL });
+        renderGraph.write(reduce, pyramidResources[pyramid], { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                                                               VK_IMAGE_LAYOUT_GENERAL });
+        renderGraph.write(reduce, pyramidCounterResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT });
+    };
+
+    if (occlusionCulling) addDepthPyramid("depth pyramid (previous)", 0);
+
+    if (gpuCulling) {
+        bool               meshlets = geometryPath == GeometryPath::MESHLET_INDIRECT;
+        OcclusionCullPhase phase    = occlusionCulling? OcclusionCullPhase::EARLY : OcclusionCullPhase::FRUSTUM;
+
+        uint32_t cull = renderGraph.addPass(meshlets? "meshlet cull" : "instance cull", [this, meshlets, phase](VkCommandBuffer commandBuffer){
+            meshlets? recordMeshletCull(commandBuffer) : recordInstanceCull(commandBuffer, phase);
+        });
+        renderGraph.write(cull, drawBufferResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT });
+
+        if (occlusionCulling) {
+            renderGraph.read(cull, pyramidResources[0], { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+            renderGraph.write(cull, occludedResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT });
+        }
+    }
+
+
+    // Main --------------------------------
+    auto addMain = [this](const std::string& name, bool late, RenderResource drawBuffer){
+        uint32_t main = renderGraph.addPass(name, [this, late](VkCommandBuffer commandBuffer){ recordMainPass(commandBuffer, late); });
+
+        renderGraph.write(main, swapchainResource, { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                                                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+        renderGraph.write(main, depthResource, { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                                 VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL });
+
+        if (drawBuffer != NO_RESOURCE) {
+            renderGraph.read(main, drawBuffer, { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT });
+        }
+    };
+
+    addMain("main", false, drawBufferResource);
+
+
+    // Occlusion Culling Late Phase --------------------------------
+    // The instances the first cull rejected, against the depth of what it let through - drawn on top of the main pass
+    if (occlusionCulling) {
+        addDepthPyramid("depth pyramid", 1);
+
+        uint32_t cull = renderGraph.addPass("instance cull (late)", [this](VkCommandBuffer commandBuffer){
+            recordInstanceCull(commandBuffer, OcclusionCullPhase::LATE);
+        });
+        renderGraph.read(cull, pyramidResources[1], { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+        renderGraph.read(cull, occludedResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT });
+        renderGraph.write(cull, lateDrawResource, { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT });
+
+        addMain("main (late)", true, lateDrawResource);
+    }
+
+    renderGraph.compile();
 }
 
 void Renderer::createSyncObjects(){
@@ -1109,6 +2338,31 @@ void Renderer::createSyncObjects(){
             "Create sync object: inFlightFence " + std::to_string(i)
         );
     }
+
+
+    // Transfer Timeline --------------------------------
+    if (!deviceFeatureSupport.timelineSemaphore) return;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+
+    semaphoreInfo.pNext = &typeInfo;
+
+    LOG_RESULT(
+        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &transferTimeline),
+        "Create sync object: transferTimeline"
+    );
+}
+
+void Renderer::createUploadBatcher(){
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+    // Falls back to fences without a timeline
+    uploadBatcher.init(device, transferQueue, transferCommandPool,
+                       indices.transferFamily.value(), indices.graphicsFamily.value(),
+                       stagingRing, transferTimeline);
 }
 
 
@@ -1131,16 +2385,26 @@ void Renderer::recreateSwapchain(){
     createSwapchainImageViews();
     createDepthResources();
     createFramebuffers();
+
+    // The depth pyramids are sized from the extent
+    if (occlusionCulling) {
+        renderGraph.clear();
+        createRenderGraph();
+    }
+
+    // The secondaries set the viewport and scissor from the old extent
+    invalidateDrawCommands();
 }
 
 void Renderer::cleanupSwapchain(){
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    gpuAllocator.free(depthImageMemory);
 
     for (size_t i=0; i < swapchainFramebuffers.size(); ++i) {
         vkDestroyFramebuffer(device, swapchainFramebuffers[i], nullptr);
     }
+    swapchainFramebuffers.clear();
 
     for (size_t i=0; i < swapchainImageViews.size(); ++i) {
         vkDestroyImageView(device, swapchainImageViews[i], nullptr); 
@@ -1365,14 +2629,14 @@ int Renderer::rateDeviceSuitability(VkPhysicalDevice device){
     return score;
 }
 
-bool Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device){
+bool Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*> &extensions){
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -1381,6 +2645,16 @@ bool Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device){
     return requiredExtensions.empty();
 }
 
+bool Renderer::checkLinearBlitSupport(VkFormat format){
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
 SwapchainSupportDetails Renderer::querySwapchainSupport(VkPhysicalDevice device){
     SwapchainSupportDetails details;
 
@@ -1455,6 +2729,24 @@ VkExtent2D Renderer::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabiliti
     return actualExtent;
 }
 
+uint32_t Renderer::chooseLod(const glm::mat4& modelView, const glm::mat4& proj){
+    // Model space errors grow with the largest scale of the model matrix
+    float scale = std::max({ glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2])) });
+
+    // Distance to the closest point of the bounding sphere - inside it, nothing gets simplified
+    glm::vec3 center   = glm::vec3(modelView * glm::vec4(boundsCenter, 1.0f));
+    float     distance = glm::length(center) - boundsRadius * scale;
+    if (distance <= 0.0f) return 0;
+
+    // Pixels covered by one unit at that distance (proj[1][1] = 1 / tan(fovy / 2))
+    float pixelsPerUnit = std::fabs(proj[1][1]) * swapchainExtent.height * 0.5f / distance;
+
+    uint32_t lod = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error * scale * pixelsPerUnit <= LOD_ERROR_THRESHOLD) ++lod;
+
+    return lod;
+}
+
 std::vector<char> Renderer::readFile(const std::string &fileName){
     std::ifstream file(fileName, std::ios::ate | std::ios::binary);
 
@@ -1499,101 +2791,316 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
         "Begin recording command buffer"
     );
 
+    // Uploads handed over since the last frame - nothing reads them before the graphics queue acquires them
+    frameUploadWait = uploadBatcher.recordAcquires(commandBuffer);
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass        = renderPass;
-    renderPassInfo.framebuffer       = swapchainFramebuffers[imageIndex];
+    if (textureMipmapsPending) {
+        generateMipmaps(commandBuffer, textureImage, textureStream.width, textureStream.height, textureMipLevels);     // Leaves every level shader readable
+        textureMipmapsPending = false;
+    }
+
+    // Cull, depth pyramid and main passes, and the barriers between them
+    frameImageIndex = imageIndex;
 
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapchainExtent;
+    renderGraph.setImage(swapchainResource, swapchainImages[imageIndex], swapchainImageViews[imageIndex]);
+    renderGraph.setImage(depthResource, depthImage, depthImageView);
+
+    if (drawBufferResource != NO_RESOURCE) {
+        renderGraph.setBuffer(drawBufferResource, (geometryPath == GeometryPath::MESHLET_INDIRECT)? meshletDrawBuffers[currentFrame] : instanceDrawBuffers[currentFrame]);
+    }
+
+    if (occlusionCulling) {
+        renderGraph.setBuffer(lateDrawResource, lateDrawBuffers[currentFrame]);
+        renderGraph.setBuffer(occludedResource, occludedInstanceBuffers[currentFrame]);
+        renderGraph.setBuffer(pyramidCounterResource, depthPyramidCounter);
+
+        writeOcclusionDescriptors();
+    }
 
+    renderGraph.execute(commandBuffer);
+
+
+    LOG_RESULT_SILENT(
+        vkEndCommandBuffer(commandBuffer),
+        "End recording command buffer"
+    );
+}
+
+void Renderer::recordMainPass(VkCommandBuffer commandBuffer, bool late){
+    uint32_t imageIndex = frameImageIndex;
 
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color        = {{0.0f, 0.0f, 0.0f, 1.0f}};
     clearValues[1].depthStencil = {1.0f, 0};
 
-    renderPassInfo.clearValueCount   = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues      = clearValues.data();
+    // The late pass draws on top of the first one, whose depth the next frame's first depth pyramid is built from
+    VkAttachmentLoadOp loadOp = late? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+    if (dynamicRendering) {
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView   = swapchainImageViews[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp      = loadOp;
+        colorAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue  = clearValues[0];
+
+        VkRenderingAttachmentInfo depthAttachment{};
+        depthAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depthAttachment.imageView   = depthImageView;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp      = loadOp;
+        depthAttachment.storeOp     = occlusionCulling? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.clearValue  = clearValues[1];
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.flags                = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        renderingInfo.renderArea.offset    = {0, 0};
+        renderingInfo.renderArea.extent    = swapchainExtent;
+        renderingInfo.layerCount           = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments    = &colorAttachment;
+        renderingInfo.pDepthAttachment     = &depthAttachment;
+        renderingInfo.pStencilAttachment   = hasStencilComponent(depthFormat)? &depthAttachment : nullptr;
+
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+    } else {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass        = late? lateRenderPass : renderPass;
+        renderPassInfo.framebuffer       = swapchainFramebuffers[imageIndex];
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = swapchainExtent;
 
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        renderPassInfo.clearValueCount   = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues      = clearValues.data();
 
-        VkViewport viewport{};
-        viewport.x        = 0.0f;
-        viewport.y        = 0.0f;
-        viewport.width    = static_cast<float_t>(swapchainExtent.width);
-        viewport.height   = static_cast<float_t>(swapchainExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
 
-        VkRect2D scissor{};
-        scissor.offset    = {0, 0};
-        scissor.extent    = swapchainExtent;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    FrameCommands& commands = frameCommands[currentFrame];
 
-        VkBuffer vertexBuffers[] = { vertexBuffer };
-        VkDeviceSize offsets[]   = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    if (late) {
+        // Recorded along with the first pass' secondaries, and reused with them
+        vkCmdExecuteCommands(commandBuffer, 1, &commands.lateSecondary);
+    } else {
+        // The frame's secondaries from a previous use of it are still valid while they would be recorded the same way
+        bool reuse = CACHE_DRAW_COMMANDS && geometryPath != GeometryPath::MESHLET_MESH_SHADER &&
+                     commands.recorded &&
+                     commands.instanceCount  == instanceCount &&
+                     commands.lod            == currentLod &&
+                     commands.dynamicOffsets == frameDynamicOffsets &&
+                     commands.draws.size()   == frameDraws.size() &&
+                     std::memcmp(commands.draws.data(), frameDraws.data(), sizeof(VkDrawIndexedIndirectCommand) * frameDraws.size()) == 0;
+
+        ++frameCount;
+
+        if (!reuse) {
+            for (VkCommandPool pool : commands.workerPools) vkResetCommandPool(device, pool, 0);
+
+            // Draws are split across the worker pools' secondaries - the indirect and mesh shader paths are a single draw
+            size_t drawCount         = (geometryPath == GeometryPath::INDEXED && !gpuInstanceCulling)? frameDraws.size() : 1;
+            size_t secondaryCount    = std::clamp<size_t>((drawCount + MIN_DRAWS_PER_SECONDARY - 1) / MIN_DRAWS_PER_SECONDARY, 1, commands.secondaries.size());
+            size_t drawsPerSecondary = (drawCount + secondaryCount - 1) / secondaryCount;
+
+            ThreadPool::get().parallelFor(secondaryCount, 1, [&](size_t begin, size_t end){
+                for (size_t i=begin; i < end; ++i) {
+                    size_t firstDraw = std::min(i * drawsPerSecondary, drawCount);
+                    recordDraws(commands.secondaries[i], imageIndex, firstDraw, std::min(drawsPerSecondary, drawCount - firstDraw));
+                }
+            });
+
+            // A single indirect draw, out of the first worker pool now that its task is done
+            if (occlusionCulling) recordDraws(commands.lateSecondary, imageIndex, 0, 1, true);
+
+            commands.recorded       = true;
+            commands.secondaryCount = secondaryCount;
+            commands.draws          = frameDraws;
+            commands.instanceCount  = instanceCount;
+            commands.lod            = currentLod;
+            commands.dynamicOffsets = frameDynamicOffsets;
+
+            ++drawRecordCount;
+        }
 
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(commands.secondaryCount), commands.secondaries.data());
+    }
 
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    dynamicRendering? vkCmdEndRendering(commandBuffer) : vkCmdEndRenderPass(commandBuffer);
+}
+
+void Renderer::recordDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, size_t firstDraw, size_t drawCount, bool late){
+    // Continues the primary's render pass - state isn't inherited, every secondary sets its own
+    // - Cached secondaries run with whichever swapchain image gets acquired, so they don't name a framebuffer
+    // - With dynamic rendering they only know the attachment formats
+    // - The late pass' secondary (occlusion culling) inherits the first render pass - the two are compatible
+    VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+    renderingInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInfo.colorAttachmentCount    = 1;
+    renderingInfo.pColorAttachmentFormats = &swapchainImageFormat;
+    renderingInfo.depthAttachmentFormat   = depthFormat;
+    renderingInfo.stencilAttachmentFormat = hasStencilComponent(depthFormat)? depthFormat : VK_FORMAT_UNDEFINED;
+    renderingInfo.rasterizationSamples    = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext       = dynamicRendering? &renderingInfo : nullptr;
+    inheritanceInfo.renderPass  = renderPass;
+    inheritanceInfo.subpass     = 0;
+    inheritanceInfo.framebuffer = (CACHE_DRAW_COMMANDS || dynamicRendering)? VK_NULL_HANDLE : swapchainFramebuffers[imageIndex];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (!CACHE_DRAW_COMMANDS) beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    LOG_RESULT_SILENT(
+        vkBeginCommandBuffer(commandBuffer, &beginInfo),
+        "Begin recording secondary command buffer"
+    );
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+    VkViewport viewport{};
+    viewport.x        = 0.0f;
+    viewport.y        = 0.0f;
+    viewport.width    = static_cast<float_t>(swapchainExtent.width);
+    viewport.height   = static_cast<float_t>(swapchainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset    = {0, 0};
+    scissor.extent    = swapchainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame],
+                            static_cast<uint32_t>(frameDynamicOffsets.size()), frameDynamicOffsets.data());
+
+    // Every material of every draw - slots written later are picked up at submit
+    if (bindlessTextures) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, BINDLESS_TEXTURE_SET, 1, &bindlessDescriptorSets[currentFrame], 0, nullptr);
+    }
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(vertexIndices.size()), 1, 0, 0, 0);
+    const MeshLod& lod = lods[currentLod];
 
-    vkCmdEndRenderPass(commandBuffer);
+    if (instanceCount == 0) {
+        // Nothing to draw - the meshlet paths would read a stale first instance
+    } else if (geometryPath == GeometryPath::MESHLET_MESH_SHADER) {
+        // One task workgroup culls MESHLET_TASK_GROUP_SIZE meshlets and launches a mesh workgroup per visible one
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &meshletDescriptorSets[currentFrame], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+                           0, sizeof(MeshletCullConstants), &meshletCullConstants);
 
+        cmdDrawMeshTasks(commandBuffer, (lod.meshletCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE, 1, 1);
+    } else {
+        // This frame's instances - the meshlet draws only use the first one
+        VkBuffer vertexBuffers[] = { vertexBuffer, frameRingBuffer };
+        VkDeviceSize offsets[]   = { 0, frameDynamicOffsets[1] };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+
+        if (gpuInstanceCulling) {
+            // One command per visible instance, whatever the instance count - the late pass draws the ones the first one missed
+            VkBuffer drawBuffer = late? lateDrawBuffers[currentFrame] : instanceDrawBuffers[currentFrame];
+
+            if (deviceFeatureSupport.drawIndirectCount) {
+                vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffer, INSTANCE_DRAW_COMMANDS_OFFSET, drawBuffer, 0,
+                                              instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+            } else {
+                // Culled instances are left in place with instanceCount = 0
+                vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, INSTANCE_DRAW_COMMANDS_OFFSET, instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+        } else if (geometryPath == GeometryPath::INDEXED) {
+            // This secondary's share of the instanced draws
+            for (size_t d=firstDraw; d < firstDraw + drawCount; ++d) {
+                const VkDrawIndexedIndirectCommand& draw = frameDraws[d];
+                vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+            }
+        } else if (deviceFeatureSupport.drawIndirectCount) {
+            vkCmdDrawIndexedIndirectCount(commandBuffer,
+                                          meshletDrawBuffers[currentFrame], MESHLET_DRAW_COMMANDS_OFFSET,
+                                          meshletDrawBuffers[currentFrame], 0,
+                                          lod.meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+        } else {
+            // Culled meshlets are left in place with instanceCount = 0
+            vkCmdDrawIndexedIndirect(commandBuffer,
+                                     meshletDrawBuffers[currentFrame], MESHLET_DRAW_COMMANDS_OFFSET,
+                                     lod.meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+        }
+    }
 
     LOG_RESULT_SILENT(
         vkEndCommandBuffer(commandBuffer),
-        "End recording command buffer"
+        "End recording secondary command buffer"
     );
 }
 
-uint32_t Renderer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties){
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+void Renderer::recordMeshletCull(VkCommandBuffer commandBuffer){
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipelineLayout, 1, 1, &meshletDescriptorSets[currentFrame], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletCullConstants), &meshletCullConstants);
 
-    for (uint32_t i=0; i < memProperties.memoryTypeCount; ++i) {
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
+    vkCmdDispatch(commandBuffer, (lods[currentLod].meshletCount + MESHLET_CULL_GROUP_SIZE - 1) / MESHLET_CULL_GROUP_SIZE, 1, 1);
+}
+
+void Renderer::recordInstanceCull(VkCommandBuffer commandBuffer, OcclusionCullPhase phase){
+    InstanceCullConstants constants = instanceCullConstants;
+    constants.phase = static_cast<uint32_t>(phase);
+
+    // In binding order - instances, then the uniforms occlusion culling reads last frame's view from
+    std::array<uint32_t, 2> dynamicOffsets = { frameDynamicOffsets[1], frameDynamicOffsets[0] };
+
+    // Instances were written by the host before the submit, which makes them visible
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, instanceCullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, instanceCullPipelineLayout, 0, 1, &instanceCullDescriptorSets[currentFrame],
+                            occlusionCulling? 2 : 1, dynamicOffsets.data());
+
+    if (occlusionCulling) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, instanceCullPipelineLayout, 1, 1,
+                                &occlusionSets[(phase == OcclusionCullPhase::LATE)? 1 : 0], 0, nullptr);
     }
 
-    LOG_FATAL("Failed to find suitable memory type");
-    abort();      // Already called in LOG_FATAL();
+    vkCmdPushConstants(commandBuffer, instanceCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(InstanceCullConstants), &constants);
+
+    // The late phase only has the rejected instances to go through, but their count is on the GPU
+    vkCmdDispatch(commandBuffer, (instanceCount + INSTANCE_CULL_GROUP_SIZE - 1) / INSTANCE_CULL_GROUP_SIZE, 1, 1);
+}
+
+void Renderer::recordDepthPyramid(VkCommandBuffer commandBuffer, uint32_t pyramid){
+    DepthPyramidConstants constants{};
+    constants.size       = glm::uvec2(depthPyramidExtent.width, depthPyramidExtent.height);
+    constants.levelCount = depthPyramidLevels;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, depthPyramidPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, depthPyramidPipelineLayout, 0, 1, &depthPyramidSets[pyramid], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, depthPyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidConstants), &constants);
+
+    // Every level in one dispatch - a workgroup per tile of level 0, see depthPyramid.comp
+    vkCmdDispatch(commandBuffer,
+                  (depthPyramidExtent.width  + DEPTH_PYRAMID_TILE_SIZE - 1) / DEPTH_PYRAMID_TILE_SIZE,
+                  (depthPyramidExtent.height + DEPTH_PYRAMID_TILE_SIZE - 1) / DEPTH_PYRAMID_TILE_SIZE, 1);
 }
 
 void Renderer::createBuffer(const std::string& name,
                             VkDeviceSize size,
                             VkBufferUsageFlags usage,
                             VkMemoryPropertyFlags properties,
-                            VkBuffer& buffer, VkDeviceMemory& bufferMemory
+                            VkBuffer& buffer, GpuAllocation& bufferMemory
 ){
     VkBufferCreateInfo createInfo{};
     createInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     createInfo.size        = size;
     createInfo.usage       = usage;
 
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-
-    uint32_t queueFamilyIndices[] = {
-        indices.graphicsFamily.value(),
-        indices.transferFamily.value()
-    };
-
-    if (indices.transferFamily.value() != indices.graphicsFamily.value()) {
-        createInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
-        createInfo.queueFamilyIndexCount = 2;
-        createInfo.pQueueFamilyIndices   = queueFamilyIndices;
-    } else {
-        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    }
+    // Uploads move ownership to the graphics queue with barriers (see UploadBatcher)
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 
     LOG_RESULT(
@@ -1605,31 +3112,29 @@ void Renderer::createBuffer(const std::string& name,
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    bufferMemory = gpuAllocator.allocate(name + " buffer", memRequirements, properties, SuballocationType::LINEAR);
 
-    LOG_RESULT(
-        vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory),
-        "Allocate " + name + " buffer memory"
-    );
-
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+    vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
-void Renderer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size){
-    LOG_TRACE("Copying buffer");
-
-    VkCommandBuffer transferCommandBuffer = beginSingleTimeCommands(transferCommandPool);
-
-        VkBufferCopy copyRegion{};
-        copyRegion.size      = size;
+void Renderer::createDeviceLocalBuffer(const std::string& name,
+                                       const void* data, VkDeviceSize size,
+                                       VkBufferUsageFlags usage,
+                                       VkBuffer& buffer, GpuAllocation& bufferMemory
+){
+    createBuffer(name,
+                 size,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 buffer, bufferMemory
+    );
 
-        vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    VkPipelineStageFlags dstStages;
+    VkAccessFlags        dstAccess;
+    findBufferConsumer(usage, dstStages, dstAccess);
 
-    endSingleTimeCommands(transferCommandBuffer, transferCommandPool, transferQueue);
+    // Copied when the batch is submitted (see submitUploads())
+    uploadBatcher.uploadBuffer(buffer, 0, data, size, dstStages, dstAccess);
 }
 
 void Renderer::updateUniformBuffer(uint32_t frame){
@@ -1640,32 +3145,311 @@ void Renderer::updateUniformBuffer(uint32_t frame){
     float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
 
-    UniformBufferObject ubo{};
-    ubo.model = glm::rotate(glm::mat4(1.0f),
-                            0.0f,
-                            glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.view  = glm::lookAt(glm::vec3(2.0f, 2.0f + glm::sin(time), 1.0f + glm::cos(time)), 
-                            glm::vec3(0.0f, 0.0f, 0.0f), 
-                            glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.proj  = glm::perspective(glm::radians(60.0f),
-                                 swapchainExtent.width / (float) swapchainExtent.height,
-                                 0.1f, 
-                                 10.0f);
+    // The frame's fence was waited on, so its region of the frame ring is free again
+    frameRing.begin(frame);
+
+    // The instance range always covers MAX_INSTANCES - it is the storage buffer descriptor's range
+    UniformBufferObject* ubo       = frameRing.allocate<UniformBufferObject>(1, uniformAlignment, frameDynamicOffsets[0]);
+    InstanceData*        instances = frameRing.allocate<InstanceData>(MAX_INSTANCES, storageAlignment, frameDynamicOffsets[1]);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f + glm::sin(time), 1.0f + glm::cos(time)), 
+                                 glm::vec3(0.0f, 0.0f, 0.0f), 
+                                 glm::vec3(0.0f, 0.0f, 1.0f));
+    float     zNear = 0.1f;
+    float     zFar  = 30.0f;                   // The whole OBJECT_COUNT grid - its back rows are left to occlusion culling
+    glm::mat4 proj  = glm::perspective(glm::radians(60.0f),
+                                       swapchainExtent.width / (float) swapchainExtent.height,
+                                       zNear,
+                                       zFar);
 
     // The Y axis is pointing down in Vulkan (glm was made for OpenGL - Y axis pointing up)
     // Must flip rasterizer front face so that backface culling works as intended
-    ubo.proj[1][1] *= -1;
+    proj[1][1] *= -1;
+
+    ubo->view           = view;
+    ubo->proj           = proj;
+    ubo->dequantization = vertexDequantization;
+    ubo->previousView   = previousView;         // Identity on the first frame - its depth was cleared, nothing gets occluded
+
+    previousView = view;
+
+
+    // The grid, then what was submitted since the last frame
+    scene.update();
+
+    uint32_t sceneCount     = scene.getDrawnCount();
+    uint32_t submittedCount = static_cast<uint32_t>(std::min<size_t>(submittedInstances.size(), MAX_INSTANCES - sceneCount));
+    if (submittedCount < submittedInstances.size()) {
+        LOG_WARNING_S("Drawing " << submittedCount << " of " << submittedInstances.size() << " submitted instances - MAX_INSTANCES is " << MAX_INSTANCES);
+    }
+
+    uint32_t submittedTotal = sceneCount + submittedCount;
+
+    auto getSubmitted = [this, sceneCount](size_t i) -> InstanceData {
+        return (i < sceneCount)? scene.getDrawn(static_cast<uint32_t>(i)) : submittedInstances[i - sceneCount];
+    };
+
+
+    // Frustum Culling --------------------------------
+    // World space bounding spheres - the model's, moved and scaled by each model matrix
+    if (cpuInstanceCulling) {
+        instanceBounds.resize(submittedTotal);
+
+        ThreadPool::get().parallelFor(submittedTotal, INSTANCE_UPDATE_BATCH_SIZE, [&](size_t begin, size_t end){
+            for (size_t i=begin; i < end; ++i) {
+                glm::mat4 model = getSubmitted(i).transform;
+                float            scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+                instanceBounds.set(i, glm::vec3(model * glm::vec4(boundsCenter, 1.0f)), boundsRadius * scale);
+            }
+        });
+
+        frustumCuller.setFrustum(proj * view);
+        frustumCuller.cull(instanceBounds, visibleInstances);
+    } else {
+        visibleInstances.resize(submittedTotal);
+        std::iota(visibleInstances.begin(), visibleInstances.end(), 0);
+    }
+
+    // Only the visible instances are written to the frame ring and drawn
+    instanceCount = static_cast<uint32_t>(visibleInstances.size());
+    instanceLods.resize(instanceCount);
+    instanceSlots.resize(instanceCount);
+
+    auto getInstance = [this, &getSubmitted](size_t i) -> InstanceData {
+        return getSubmitted(visibleInstances[i]);
+    };
+
+    // LODs from the undequantized model matrices - LOD errors and bounds are in model units
+    // - The instance cull shader picks them when culling on the GPU, the instances are copied in submission order
+    if (!gpuInstanceCulling) {
+        ThreadPool::get().parallelFor(instanceCount, INSTANCE_UPDATE_BATCH_SIZE, [&](size_t begin, size_t end){
+            for (size_t i=begin; i < end; ++i) {
+                instanceLods[i] = chooseLod(view * getInstance(i).transform, proj);
+            }
+        });
+
+        // Counting sort by LOD, so that each LOD is a single instanced draw
+        // - The meshlet paths draw the first instance alone, in submission order
+        std::fill(lodInstanceCounts.begin(), lodInstanceCounts.end(), 0);
+        for (uint32_t i=0; i < instanceCount; ++i) ++lodInstanceCounts[instanceLods[i]];
+    }
+
+    if (geometryPath == GeometryPath::INDEXED && !gpuInstanceCulling) {
+        std::vector<uint32_t> lodSlots(lods.size(), 0);
+        for (size_t l=1; l < lods.size(); ++l) lodSlots[l] = lodSlots[l - 1] + lodInstanceCounts[l - 1];
+
+        for (uint32_t i=0; i < instanceCount; ++i) instanceSlots[i] = lodSlots[instanceLods[i]]++;
+
+        // Instances are grouped by LOD - one instanced draw per LOD in use
+        frameDraws.clear();
+        for (size_t l=0; l < lods.size(); ++l) {
+            if (lodInstanceCounts[l] == 0) continue;
+
+            frameDraws.push_back({ lods[l].indexCount, lodInstanceCounts[l], lods[l].indexOffset, 0, lodSlots[l] - lodInstanceCounts[l] });
+        }
+    } else {
+        std::iota(instanceSlots.begin(), instanceSlots.end(), 0);
+    }
+
+    // Written straight into the mapped ring
+    ThreadPool::get().parallelFor(instanceCount, INSTANCE_UPDATE_BATCH_SIZE, [&](size_t begin, size_t end){
+        for (size_t i=begin; i < end; ++i) {
+            instances[instanceSlots[i]] = getInstance(i);
+        }
+    });
+
+    // The meshlet paths cull in the first instance's model space
+    glm::mat4 model = (instanceCount > 0)? getInstance(0).transform : glm::mat4(1.0f);
+
+    if (geometryPath != GeometryPath::INDEXED && instanceCount > 1 && !droppedInstancesLogged) {
+        LOG_WARNING_S("The meshlet paths draw a single instance - " << instanceCount - 1 << " instances dropped (OBJECT_COUNT above 1 draws them indexed)");
+        droppedInstancesLogged = true;
+    }
+
+    submittedInstances.clear();
+
+    if (instanceCount == 0) return;
+
+
+    // Instance Culling --------------------------------
+    if (gpuInstanceCulling) {
+        // Side planes of the symmetric frustum through the origin, normalized - proj[0][0] and proj[1][1] are the slopes' inverses
+        float xSlope = proj[0][0];
+        float ySlope = std::fabs(proj[1][1]);
+
+        // The occlusion test rebuilds depth buffer values from zNear / zFar alone - check it against the projection
+        float     checkDistance = 0.5f * (zNear + zFar);
+        glm::vec4 checkClip     = proj * glm::vec4(0.0f, 0.0f, -checkDistance, 1.0f);
+        float     checkDepth    = zFar * (checkDistance - zNear) / ((zFar - zNear) * checkDistance);
+        if (std::fabs(checkClip.z / checkClip.w - checkDepth) > 1e-4f) {
+            LOG_FATAL_S("Projected depth " << checkClip.z / checkClip.w << " doesn't match the culling depth " << checkDepth <<
+                        " - glm must be built with GLM_FORCE_DEPTH_ZERO_TO_ONE");
+        }
+
+        instanceCullConstants.view              = view;
+        instanceCullConstants.frustum           = glm::vec4(xSlope, 1.0f, ySlope, 1.0f) /
+                                                  glm::vec4(glm::vec2(std::sqrt(xSlope * xSlope + 1.0f)), glm::vec2(std::sqrt(ySlope * ySlope + 1.0f)));
+        instanceCullConstants.zNear             = zNear;
+        instanceCullConstants.zFar              = zFar;
+        instanceCullConstants.lodScale          = ySlope * swapchainExtent.height * 0.5f;
+        instanceCullConstants.lodErrorThreshold = LOD_ERROR_THRESHOLD;
+        instanceCullConstants.instanceCount     = instanceCount;
+        return;
+    }
+
+    uint32_t lod = instanceLods[0];
+    if (lod != currentLod) {
+        LOG_TRACE_S("LOD " << currentLod << " -> " << lod);
+        currentLod = lod;
+    }
+
+
+    // Meshlet culling happens in model space (before dequantization, like the meshlet bounds)
+    if (geometryPath == GeometryPath::INDEXED) return;
+
+    // Frustum planes from the rows of the clip matrix (Gribb & Hartmann) - the near plane follows glm's clip depth range
+    glm::mat4 clip = glm::transpose(proj * view * model);
+
+#if GLM_CONFIG_CLIP_CONTROL & GLM_CLIP_CONTROL_ZO_BIT
+    glm::vec4 nearPlane = clip[2];
+#else
+    glm::vec4 nearPlane = clip[3] + clip[2];
+#endif
+
+    glm::vec4 planes[6] = {
+        clip[3] + clip[0], clip[3] - clip[0],       // Left, right
+        clip[3] + clip[1], clip[3] - clip[1],       // Bottom, top
+        nearPlane,         clip[3] - clip[2]        // Near, far
+    };
+
+    for (int i=0; i < 6; ++i) {
+        meshletCullConstants.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+    }
+
+    meshletCullConstants.cameraPosition = glm::vec3(glm::inverse(view * model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    meshletCullConstants.meshletCount   = lods[currentLod].meshletCount;
+    meshletCullConstants.meshletOffset  = lods[currentLod].meshletOffset;
+}
+
+void Renderer::updateTextureStream(uint32_t frame){
+    TextureStream& stream = textureStream;
+
+    // Decoded - the upload goes to the transfer queue
+    if (stream.state == TextureStreamState::DECODING && stream.decoded.valid() &&
+        stream.decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        if (stream.decoded.get()) {
+            submitTextureUpload(stream);
+        } else {
+            LOG_ERROR_S("Failed to load texture : " << MODEL_TEXTURE << " - keeping the placeholder");
+            stream.state = TextureStreamState::FAILED;
+        }
+    }
+
+    // Uploaded - this frame acquires the texture, then it gets swapped in frame by frame
+    if (stream.state == TextureStreamState::UPLOADING) {
+        if (uploadBatcher.isComplete(stream.uploadTicket)) {
+            uploadBatcher.acquire(stream.uploadTicket);
+
+            std::vector<uint8_t>().swap(stream.pixels);
+            stream.cache.close();
+
+            createTextureImageView();
+            stream.state = TextureStreamState::READY;
+
+            auto  endTime   = std::chrono::high_resolution_clock::now();
+            float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - stream.startTime).count();
+
+            LOG_DEBUG_S("Texture resident " << elapsedMs << " ms after launching the load");
+        }
+    }
+
+    // This frame's previous submit has completed, so its descriptor set can be written
+    if (stream.state != TextureStreamState::READY || textureBound[frame]) return;
+
+    writeTextureDescriptor(frame);
+    textureBound[frame] = true;
+}
+
+void Renderer::writeTextureDescriptor(uint32_t frame){
+    // Update after bind - the frame's cached secondaries stay valid
+    if (bindlessTextures) {
+        writeBindlessDescriptor(frame, modelTextureSlot, textureImageView, textureSampler);
+        return;
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView   = textureImageView;
+    imageInfo.sampler     = textureSampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = descriptorSets[frame];
+    descriptorWrite.dstBinding      = 1;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo      = &imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+    // Writing a bound descriptor set invalidates the command buffers it was bound in
+    frameCommands[frame].recorded = false;
+}
+
+void Renderer::writeBindlessDescriptor(uint32_t frame, uint32_t slot, VkImageView imageView, VkSampler sampler){
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView   = imageView;
+    imageInfo.sampler     = sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = bindlessDescriptorSets[frame];
+    descriptorWrite.dstBinding      = 0;
+    descriptorWrite.dstArrayElement = slot;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo      = &imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void Renderer::writeOcclusionDescriptors(){
+    // The pyramids are the render graph's, recreated with the swapchain - the frame's sets go back to the pools once it completes
+    DepthPyramidDescriptors pyramidDescriptors{};
+    pyramidDescriptors.depth   = { depthPyramidSampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    pyramidDescriptors.counter = { depthPyramidCounter, 0, VK_WHOLE_SIZE };
+
+    for (uint32_t p=0; p < pyramidResources.size(); ++p) {
+        // Levels past the pyramid's own are never touched - its last one stands in for them
+        for (uint32_t level=0; level < DEPTH_PYRAMID_MAX_LEVELS; ++level) {
+            pyramidDescriptors.levels[level] = { VK_NULL_HANDLE, renderGraph.getMipView(pyramidResources[p], std::min(level, depthPyramidLevels - 1)),
+                                                 VK_IMAGE_LAYOUT_GENERAL };
+        }
 
+        depthPyramidSets[p] = descriptorAllocator.allocateTransient(depthPyramidSetLayout);
+        descriptorAllocator.update(depthPyramidSets[p], depthPyramidSetTemplate, &pyramidDescriptors);
 
-    memcpy(uniformBuffersMapped[frame], &ubo, sizeof(ubo));
+        VkDescriptorImageInfo pyramidInfo = { depthPyramidSampler, renderGraph.getImageView(pyramidResources[p]), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+        occlusionSets[p] = descriptorAllocator.allocateTransient(occlusionSetLayout);
+        descriptorAllocator.update(occlusionSets[p], occlusionSetTemplate, &pyramidInfo);
+    }
+}
+
+void Renderer::invalidateDrawCommands(){
+    for (FrameCommands& commands : frameCommands) commands.recorded = false;
 }
 
 void Renderer::createImage(const std::string& name, 
-                           uint32_t width, uint32_t height, 
+                           uint32_t width, uint32_t height, uint32_t mipLevels,
                            VkFormat format, VkImageTiling tiling, 
                            VkImageUsageFlags usage, 
                            VkMemoryPropertyFlags properties,
-                           VkImage& image, VkDeviceMemory& imageMemory
+                           VkImage& image, GpuAllocation& imageMemory
 ){
     VkImageCreateInfo createInfo{};
     createInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1673,7 +3457,7 @@ void Renderer::createImage(const std::string& name,
     createInfo.extent.width  = width;
     createInfo.extent.height = height;
     createInfo.extent.depth  = 1;
-    createInfo.mipLevels     = 1;
+    createInfo.mipLevels     = mipLevels;
     createInfo.arrayLayers   = 1;
     createInfo.format        = format;
     createInfo.tiling        = tiling;
@@ -1681,20 +3465,8 @@ void Renderer::createImage(const std::string& name,
     createInfo.usage         = usage;
     createInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
 
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-
-    uint32_t queueFamilyIndices[] = {
-        indices.graphicsFamily.value(),
-        indices.transferFamily.value()
-    };
-
-    if (indices.transferFamily.value() != indices.graphicsFamily.value()) {
-        createInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
-        createInfo.queueFamilyIndexCount = 2;
-        createInfo.pQueueFamilyIndices   = queueFamilyIndices;
-    } else {
-        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    }
+    // Uploads move ownership to the graphics queue with barriers (see UploadBatcher)
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     LOG_RESULT(
         vkCreateImage(device, &createInfo, nullptr, &image), 
@@ -1705,17 +3477,98 @@ void Renderer::createImage(const std::string& name,
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    SuballocationType type = (tiling == VK_IMAGE_TILING_LINEAR)? SuballocationType::LINEAR : SuballocationType::OPTIMAL;
+    imageMemory = gpuAllocator.allocate(name + " image", memRequirements, properties, type);
 
-    LOG_RESULT(
-        vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory), 
-        "Allocate " + name + " image memory"
+    vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
+}
+
+void Renderer::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels){
+    // Blits need a graphics queue - every level starts as a transfer destination
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+
+    int32_t levelWidth  = static_cast<int32_t>(width);
+    int32_t levelHeight = static_cast<int32_t>(height);
+
+    // Each level is blitted from the previous one, which then goes to the shaders
+    for (uint32_t level=1; level < mipLevels; ++level) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        int32_t nextWidth  = std::max(levelWidth  / 2, 1);
+        int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0]                 = {0, 0, 0};
+        blit.srcOffsets[1]                 = {levelWidth, levelHeight, 1};
+        blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel       = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount     = 1;
+        blit.dstOffsets[0]                 = {0, 0, 0};
+        blit.dstOffsets[1]                 = {nextWidth, nextHeight, 1};
+        blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel       = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount     = 1;
+
+        vkCmdBlitImage(commandBuffer,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        levelWidth  = nextWidth;
+        levelHeight = nextHeight;
+    }
+
+    // The last level was only ever written to
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void Renderer::submitTextureUpload(TextureStream& stream){
+    textureFormat    = stream.format;
+    textureMipLevels = stream.mipLevels;
+
+    createImage("texture", 
+                stream.width, stream.height, textureMipLevels,
+                textureFormat, VK_IMAGE_TILING_OPTIMAL, 
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                textureImage, textureImageMemory
     );
 
-    vkBindImageMemory(device, image, imageMemory, 0);
+    // A batch of its own, so it can be polled on its own
+    uploadBatcher.uploadImage(textureImage, textureMipLevels, stream.levels, stream.getData(), stream.getSize(),
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    stream.uploadTicket = uploadBatcher.submit();
+    stream.state        = TextureStreamState::UPLOADING;
 }
 
 VkCommandBuffer Renderer::beginSingleTimeCommands(VkCommandPool &commandPool){
@@ -1751,113 +3604,84 @@ void Renderer::endSingleTimeCommands(VkCommandBuffer &commandBuffer, VkCommandPo
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void Renderer::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout){
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(graphicsCommandPool);
-
-        VkImageMemoryBarrier barrier{};
-        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout           = oldLayout;
-        barrier.newLayout           = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image               = image;
+VkImageView Renderer::createImageView(const std::string& name, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels,
+                                      VkComponentMapping components)
+{
+    VkImageView imageView;
 
+    VkImageViewCreateInfo createInfo{};
+    createInfo.sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image      = image;
+    createInfo.viewType   = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format     = format;
+    createInfo.components = components;
 
-        if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-            if (hasStencilComponent(format)) {
-                barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-            }
-        } else {
-            barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        }
-        
-        barrier.subresourceRange.baseMipLevel   = 0;
-        barrier.subresourceRange.levelCount     = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount     = 1;
-
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && 
-            newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-        ){
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } 
-        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-                 newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-        ){
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            sourceStage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } 
-        else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-                 newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-            sourceStage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        } 
-        else {
-            LOG_ERROR("Unsupported layout transition");
-        }
+    createInfo.subresourceRange.aspectMask     = aspectFlags;
+    createInfo.subresourceRange.baseMipLevel   = 0;
+    createInfo.subresourceRange.levelCount     = mipLevels;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount     = 1;
 
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    LOG_RESULT(
+        vkCreateImageView(device, &createInfo, nullptr, &imageView),
+        "Create " + name + " image view"
+    );
 
-    endSingleTimeCommands(commandBuffer, graphicsCommandPool, graphicsQueue);
+    return imageView;
 }
 
-void Renderer::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height){
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+bool Renderer::decodeTexture(TextureStream& stream, bool compressed, bool gpuMipmaps){
+    // May run on a worker thread - no Vulkan calls, only stream is written
 
-        VkBufferImageCopy region{};
-        region.bufferOffset      = 0;
-        region.bufferRowLength   = 0;
-        region.bufferImageHeight = 0;
+    // Block compressed cache - re-cooked when missing or stale
+    if (compressed) {
+        uint64_t sourceHash = 0, sourceSize = 0;
+        if (!MeshCache::hashSource(MODEL_TEXTURE, sourceHash, sourceSize)) return false;
 
-        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel       = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount     = 1;
+        if (!stream.cache.open(MODEL_TEXTURE_CACHE, sourceHash, sourceSize)) {
+            LOG_INFO_S("Cooking texture : " << MODEL_TEXTURE << " -> " << MODEL_TEXTURE_CACHE);
 
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {width, height, 1};
+            if (!TextureCache::cook(MODEL_TEXTURE, MODEL_TEXTURE_CACHE) || !stream.cache.open(MODEL_TEXTURE_CACHE, sourceHash, sourceSize)) {
+                LOG_WARNING("Failed to cook the texture cache - uploading the texture uncompressed");
+            }
+        }
 
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        if (stream.cache.isOpen()) {
+            const Ktx2Header& header = stream.cache.getHeader();
 
-    endSingleTimeCommands(commandBuffer, transferCommandPool, transferQueue);
-}
+            stream.format    = stream.cache.getFormat();
+            stream.width     = header.pixelWidth;
+            stream.height    = header.pixelHeight;
+            stream.mipLevels = header.levelCount;
+            stream.levels    = stream.cache.getLevels();
 
-VkImageView Renderer::createImageView(const std::string& name, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags){
-    VkImageView imageView;
+            LOG_TRACE_S("Loaded texture from texture cache : " << MODEL_TEXTURE_CACHE << " (" << stream.getSize() << " bytes)");
+            return true;
+        }
+    }
 
-    VkImageViewCreateInfo createInfo{};
-    createInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image    = image;
-    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    createInfo.format   = format;
 
-    createInfo.subresourceRange.aspectMask     = aspectFlags;
-    createInfo.subresourceRange.baseMipLevel   = 0;
-    createInfo.subresourceRange.levelCount     = 1;
-    createInfo.subresourceRange.baseArrayLayer = 0;
-    createInfo.subresourceRange.layerCount     = 1;
+    // RGBA8 - the mip chain is filtered here unless it gets blitted on the GPU
+    int texWidth, texHeight, texChannels;
 
-    LOG_RESULT(
-        vkCreateImageView(device, &createInfo, nullptr, &imageView),
-        "Create " + name + " image view"
-    );
+    stbi_uc* pixels = stbi_load(MODEL_TEXTURE, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) return false;
 
-    return imageView;
+    stream.format    = VK_FORMAT_R8G8B8A8_SRGB;
+    stream.width     = static_cast<uint32_t>(texWidth);
+    stream.height    = static_cast<uint32_t>(texHeight);
+    stream.mipLevels = MipGenerator::getMipLevelCount(stream.width, stream.height);
+
+    if (gpuMipmaps) {
+        stream.levels = { MipLevel{ stream.width, stream.height, 0, size_t(stream.width) * stream.height * 4 } };
+        stream.pixels.assign(pixels, pixels + stream.levels[0].size);
+    } else {
+        MipGenerator::generate(pixels, stream.width, stream.height, stream.levels, stream.pixels);
+    }
+
+    stbi_image_free(pixels);
+
+    return true;
 }
 
 VkFormat Renderer::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features){
@@ -1889,10 +3713,37 @@ VkFormat Renderer::findDepthFormat(){
             VK_FORMAT_D24_UNORM_S8_UINT
         }, 
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusionCulling? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0)      // Depth pyramids
     );
 }
 
+// How the graphics queue first reads a buffer of this usage
+void Renderer::findBufferConsumer(VkBufferUsageFlags usage, VkPipelineStageFlags& stages, VkAccessFlags& access){
+    stages = 0;
+    access = 0;
+
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        access |= VK_ACCESS_INDEX_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;      // Compute culling, task and mesh shaders
+        access |= VK_ACCESS_SHADER_READ_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+        stages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    }
+    if (stages == 0) {
+        stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        access = VK_ACCESS_MEMORY_READ_BIT;
+    }
+}
+
 bool Renderer::hasStencilComponent(VkFormat format){
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
            format == VK_FORMAT_D24_UNORM_S8_UINT;
@@ -0,0 +1,180 @@
+#include <scene.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// NodeTransform ---------------------------------------------------------------------
+glm::mat4 NodeTransform::getMatrix() const{
+    glm::mat3 rotationMatrix = glm::mat3_cast(rotation);
+
+    glm::mat4 matrix;
+    matrix[0] = glm::vec4(rotationMatrix[0] * scale.x, 0.0f);
+    matrix[1] = glm::vec4(rotationMatrix[1] * scale.y, 0.0f);
+    matrix[2] = glm::vec4(rotationMatrix[2] * scale.z, 0.0f);
+    matrix[3] = glm::vec4(translation, 1.0f);
+    return matrix;
+}
+
+
+// Scene -----------------------------------------------------------------------------
+NodeId Scene::addNode(const NodeTransform& local, NodeId parent, bool drawnNode, const glm::vec3& tint, uint32_t material){
+    if (parent != NO_PARENT && parent >= nodeIndices.size()) {
+        LOG_FATAL_S("Scene : parent node " << parent << " doesn't exist (" << nodeIndices.size() << " nodes)");
+    }
+
+    NodeId   id          = static_cast<NodeId>(nodeIndices.size());
+    uint32_t index       = static_cast<uint32_t>(parents.size());
+    uint32_t parentIndex = (parent == NO_PARENT)? NO_PARENT : nodeIndices[parent];
+    uint32_t depth       = (parent == NO_PARENT)? 0 : depths[parentIndex] + 1;
+
+    // Appending keeps the level order as long as the node isn't above the deepest level
+    if (!depths.empty() && depth < depths.back()) sorted = false;
+
+    parents.push_back(parentIndex);
+    locals.push_back(local);
+    worlds.push_back(glm::mat4(1.0f));
+    dirty.push_back(1);
+    tints.push_back(tint);
+    materials.push_back(material);
+    depths.push_back(depth);
+    ids.push_back(id);
+
+    nodeIndices.push_back(index);
+    drawnNodes.push_back(drawnNode);
+
+    ++dirtyCount;
+    levelOffsets.clear();           // Rebuilt by the next update()
+
+    return id;
+}
+
+void Scene::setLocal(NodeId node, const NodeTransform& local){
+    uint32_t index = nodeIndices[node];
+
+    locals[index] = local;
+
+    if (!dirty[index]) {
+        dirty[index] = 1;
+        ++dirtyCount;
+    }
+}
+
+void Scene::setMaterial(NodeId node, uint32_t material){ materials[nodeIndices[node]] = material; }
+
+const NodeTransform& Scene::getLocal(NodeId node) const{ return locals[nodeIndices[node]]; }
+
+const glm::mat4& Scene::getWorld(NodeId node) const{ return worlds[nodeIndices[node]]; }
+
+uint32_t Scene::update(){
+    if (!sorted)              sort();
+    if (levelOffsets.empty()) rebuildLevels();
+    if (dirtyCount == 0)      return 0;
+
+    std::atomic<uint32_t> updatedCount{0};
+
+    // A node is recomputed when it or its parent is dirty - the parent's level is complete by then, so dirt flows down subtrees
+    for (size_t level=0; level + 1 < levelOffsets.size(); ++level) {
+        uint32_t levelStart = levelOffsets[level];
+        uint32_t levelSize  = levelOffsets[level + 1] - levelStart;
+
+        ThreadPool::get().parallelFor(levelSize, SCENE_UPDATE_BATCH_SIZE, [&](size_t begin, size_t end){
+            uint32_t count = 0;
+
+            for (size_t i=levelStart + begin; i < levelStart + end; ++i) {
+                uint32_t parent = parents[i];
+                if (parent != NO_PARENT && dirty[parent]) dirty[i] = 1;
+                if (!dirty[i]) continue;
+
+                worlds[i] = (parent == NO_PARENT)? locals[i].getMatrix() : worlds[parent] * locals[i].getMatrix();
+                ++count;
+            }
+
+            updatedCount += count;
+        });
+    }
+
+    std::fill(dirty.begin(), dirty.end(), 0);
+    dirtyCount = 0;
+
+    return updatedCount;
+}
+
+uint32_t Scene::getNodeCount() const{ return static_cast<uint32_t>(parents.size()); }
+
+uint32_t Scene::getDrawnCount() const{ return static_cast<uint32_t>(drawn.size()); }
+
+InstanceData Scene::getDrawn(uint32_t index) const{
+    InstanceData instance;
+    instance.transform = worlds[drawn[index]];
+    instance.tint      = tints[drawn[index]];
+    instance.material  = materials[drawn[index]];
+    return instance;
+}
+
+void Scene::clear(){
+    parents.clear();
+    locals.clear();
+    worlds.clear();
+    dirty.clear();
+    tints.clear();
+    materials.clear();
+    depths.clear();
+    ids.clear();
+
+    nodeIndices.clear();
+    drawnNodes.clear();
+    drawn.clear();
+    levelOffsets.clear();
+
+    sorted     = true;
+    dirtyCount = 0;
+}
+
+
+// Helper Functions
+void Scene::sort(){
+    uint32_t nodeCount = getNodeCount();
+
+    // Stable, so siblings keep their creation order
+    std::vector<uint32_t> order(nodeCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b){ return depths[a] < depths[b]; });
+
+    std::vector<uint32_t> newIndices(nodeCount);
+    for (uint32_t i=0; i < nodeCount; ++i) newIndices[order[i]] = i;
+
+    auto permute = [&order](auto& values){
+        std::remove_reference_t<decltype(values)> permuted(values.size());
+        for (size_t i=0; i < order.size(); ++i) permuted[i] = values[order[i]];
+        values.swap(permuted);
+    };
+
+    permute(parents);
+    permute(locals);
+    permute(worlds);
+    permute(dirty);
+    permute(tints);
+    permute(materials);
+    permute(depths);
+    permute(ids);
+
+    for (uint32_t i=0; i < nodeCount; ++i) {
+        if (parents[i] != NO_PARENT) parents[i] = newIndices[parents[i]];
+        nodeIndices[ids[i]] = i;
+    }
+
+    sorted = true;
+    levelOffsets.clear();
+}
+
+void Scene::rebuildLevels(){
+    // Depths are sorted - a level starts wherever the depth changes
+    levelOffsets.clear();
+    drawn.clear();
+
+    for (uint32_t i=0; i < getNodeCount(); ++i) {
+        if (i == 0 || depths[i] != depths[i - 1]) levelOffsets.push_back(i);
+        if (drawnNodes[ids[i]])                   drawn.push_back(i);
+    }
+    levelOffsets.push_back(getNodeCount());
+}
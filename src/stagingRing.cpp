@@ -0,0 +1,212 @@
+#include <stagingRing.hpp>
+#include <logger.hpp>
+
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){ return (value + alignment - 1) / alignment * alignment; }
+
+
+void StagingRing::init(VkDevice logicalDevice, GpuAllocator& gpuAllocator, VkDeviceSize size, VkDeviceSize alignment,
+                       const std::vector<uint32_t>& families
+){
+    device        = logicalDevice;
+    allocator     = &gpuAllocator;
+    queueFamilies = families;
+    capacity      = size;
+    minAlignment  = std::max<VkDeviceSize>(1, alignment);
+
+    createBuffer(capacity, buffer, memory);
+
+    LOG_TRACE_S("Staging ring : " << (capacity >> 20) << " MiB");
+}
+
+void StagingRing::destroy(){
+    closePending();
+    for (auto& batch : inFlight) retire(batch);
+    inFlight.clear();
+
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(memory);
+    buffer = VK_NULL_HANDLE;
+}
+
+StagingAllocation StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment){
+    alignment = std::max(alignment, minAlignment);
+
+    StagingAllocation allocation{};
+    VkDeviceSize      offset;
+
+    reclaim();
+
+    // Full - the oldest submissions free up the space they hold as they complete
+    while (!tryAllocate(size, alignment, offset)) {
+        if (size > capacity || inFlight.empty()) {
+            LOG_TRACE_S("Staging ring : " << size << " bytes don't fit, using a temporary buffer");
+
+            std::pair<VkBuffer, GpuAllocation> overflow;
+            createBuffer(size, overflow.first, overflow.second);
+
+            allocation.buffer = overflow.first;
+            allocation.mapped = overflow.second.mapped;
+
+            pending.overflow.push_back(overflow);
+            ++overflowCount;
+            return allocation;
+        }
+
+        wait(inFlight.front());
+        retire(inFlight.front());
+        inFlight.pop_front();
+    }
+
+    allocation.buffer = buffer;
+    allocation.offset = offset;
+    allocation.mapped = static_cast<char*>(memory.mapped) + offset;
+    return allocation;
+}
+
+void StagingRing::submit(VkFence fence){
+    pending.fence = fence;
+    closePending();
+}
+
+void StagingRing::submit(VkSemaphore timeline, uint64_t value){
+    pending.timeline = timeline;
+    pending.value    = value;
+    closePending();
+}
+
+void StagingRing::submitCompleted(){
+    closePending();
+    reclaim();
+}
+
+void StagingRing::reclaim(){
+    // In submission order - the tail can't skip over space still in use
+    while (!inFlight.empty() && isComplete(inFlight.front())) {
+        retire(inFlight.front());
+        inFlight.pop_front();
+    }
+}
+
+StagingRingStats StagingRing::getStats() const{
+    StagingRingStats stats{};
+    stats.capacity      = capacity;
+    stats.used          = used;
+    stats.peak          = peak;
+    stats.inFlight      = static_cast<uint32_t>(inFlight.size());
+    stats.overflowCount = overflowCount;
+    return stats;
+}
+
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset){
+    if (size > capacity) return false;
+
+    if (used == 0) head = tail = 0;
+
+    VkDeviceSize start = alignUp(head, alignment);
+    VkDeviceSize added;
+
+    if (used == 0 || head > tail) {
+        // Free space is [head, capacity) then [0, tail)
+        if (start + size <= capacity) {
+            added = start - head + size;
+        } else if (size <= tail) {
+            added = capacity - head + size;         // Wraps - the end of the ring is skipped
+            start = 0;
+        } else {
+            return false;
+        }
+    } else {
+        // Free space is [head, tail) - none when head == tail
+        if (start + size > tail) return false;
+        added = start - head + size;
+    }
+
+    offset = start;
+    head   = start + size;
+    used  += added;
+    peak   = std::max(peak, used);
+
+    pending.size += added;
+    pending.end   = head;
+    return true;
+}
+
+bool StagingRing::isComplete(const Batch& batch) const{
+    if (batch.fence != VK_NULL_HANDLE) {
+        return vkGetFenceStatus(device, batch.fence) == VK_SUCCESS;
+    }
+    if (batch.timeline != VK_NULL_HANDLE) {
+        uint64_t completedValue = 0;
+        vkGetSemaphoreCounterValue(device, batch.timeline, &completedValue);
+        return completedValue >= batch.value;
+    }
+    return true;
+}
+
+void StagingRing::wait(const Batch& batch) const{
+    if (batch.fence != VK_NULL_HANDLE) {
+        vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    }
+    if (batch.timeline != VK_NULL_HANDLE) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &batch.timeline;
+        waitInfo.pValues        = &batch.value;
+
+        vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+    }
+}
+
+void StagingRing::retire(Batch& batch){
+    if (batch.size > 0) {
+        used -= batch.size;
+        tail  = batch.end;
+    }
+
+    for (auto& [overflowBuffer, overflowMemory] : batch.overflow) {
+        vkDestroyBuffer(device, overflowBuffer, nullptr);
+        allocator->free(overflowMemory);
+    }
+    batch.overflow.clear();
+}
+
+void StagingRing::createBuffer(VkDeviceSize size, VkBuffer& stagingBuffer, GpuAllocation& stagingMemory){
+    VkBufferCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size  = size;
+    createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    if (queueFamilies.size() > 1) {
+        createInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        createInfo.pQueueFamilyIndices   = queueFamilies.data();
+    } else {
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    LOG_RESULT(
+        vkCreateBuffer(device, &createInfo, nullptr, &stagingBuffer),
+        "Create staging buffer"
+    );
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, stagingBuffer, &memRequirements);
+
+    stagingMemory = allocator->allocate("staging buffer", memRequirements,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                        SuballocationType::LINEAR);
+
+    vkBindBufferMemory(device, stagingBuffer, stagingMemory.memory, stagingMemory.offset);
+}
+
+// Queues the pending batch (if it holds anything) and starts a new one
+void StagingRing::closePending(){
+    if (pending.size > 0 || !pending.overflow.empty()) {
+        inFlight.push_back(std::move(pending));
+    }
+
+    pending = Batch{};
+}
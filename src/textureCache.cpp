@@ -0,0 +1,332 @@
+#include <textureCache.hpp>
+#include <meshCache.hpp>
+#include <logger.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+
+// Khronos data format descriptor values (khr_df.h)
+static const uint32_t KHR_DF_VERSION            = 2;
+static const uint32_t KHR_DF_MODEL_BC4          = 131;
+static const uint32_t KHR_DF_MODEL_BC5          = 132;
+static const uint32_t KHR_DF_MODEL_BC7          = 134;
+static const uint32_t KHR_DF_PRIMARIES_BT709    = 1;
+static const uint32_t KHR_DF_TRANSFER_LINEAR    = 1;
+static const uint32_t KHR_DF_TRANSFER_SRGB      = 2;
+
+static const char KTX_WRITER_KEY[]   = "KTXwriter";
+static const char KTX_WRITER_VALUE[] = "VulkanApp TextureCooker";
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment){
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+
+// Basic data format descriptor of a BC format - one sample per channel block
+static std::vector<uint32_t> createDataFormatDescriptor(TextureEncoding encoding){
+    uint32_t model       = (encoding == TextureEncoding::BC7)? KHR_DF_MODEL_BC7 : (encoding == TextureEncoding::BC5)? KHR_DF_MODEL_BC5 : KHR_DF_MODEL_BC4;
+    uint32_t transfer    = (encoding == TextureEncoding::BC7)? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    uint32_t blockSize   = TextureCompressor::getBlockSize(encoding);
+    uint32_t sampleCount = (encoding == TextureEncoding::BC5)? 2 : 1;
+    uint32_t sampleBits  = (encoding == TextureEncoding::BC7)? 128 : 64;
+    uint32_t blockLength = 24 + 16 * sampleCount;
+
+    std::vector<uint32_t> dfd = {
+        4 + blockLength,                                                    // Total size
+        0,                                                                  // Khronos vendor, basic descriptor type
+        KHR_DF_VERSION | (blockLength << 16),
+        model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16),           // Straight alpha
+        3 | (3 << 8),                                                       // 4x4x1x1 texel blocks
+        blockSize,                                                          // Bytes in plane 0
+        0
+    };
+
+    for (uint32_t s=0; s < sampleCount; ++s) {
+        uint32_t channel = s;                                               // BC7 color / BC4 red / BC5 red then green
+        dfd.push_back((s * sampleBits) | ((sampleBits - 1) << 16) | (channel << 24));
+        dfd.push_back(0);                                                   // Sample position
+        dfd.push_back(0);                                                   // Lower
+        dfd.push_back(UINT32_MAX);                                          // Upper
+    }
+
+    return dfd;
+}
+
+static void appendKeyValue(std::vector<uint8_t>& kvd, const char* key, const void* value, uint32_t valueSize){
+    uint32_t keySize = static_cast<uint32_t>(strlen(key)) + 1;
+    uint32_t length  = keySize + valueSize;
+
+    const uint8_t* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+    kvd.insert(kvd.end(), lengthBytes, lengthBytes + sizeof(length));
+    kvd.insert(kvd.end(), key, key + keySize);
+    kvd.insert(kvd.end(), static_cast<const uint8_t*>(value), static_cast<const uint8_t*>(value) + valueSize);
+    kvd.resize(alignOffset(kvd.size(), 4), 0);
+}
+
+
+TextureEncoding TextureCache::chooseEncoding(int channelCount, const TextureCookOptions& options){
+    if (options.normalMap) return TextureEncoding::BC5;
+    if (channelCount == 1) return TextureEncoding::BC4;
+    return TextureEncoding::BC7;
+}
+
+VkFormat TextureCache::getFormat(TextureEncoding encoding){
+    switch (encoding) {
+        case TextureEncoding::BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+        case TextureEncoding::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TextureEncoding::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool TextureCache::cook(const std::string& sourceFileName, const std::string& fileName, const TextureCookOptions& options){
+    uint64_t sourceHash = 0, sourceSize = 0;
+    if (!MeshCache::hashSource(sourceFileName, sourceHash, sourceSize)) {
+        LOG_ERROR_S("Failed to open " << sourceFileName);
+        return false;
+    }
+
+    int width, height, channelCount;
+    stbi_uc* pixels = stbi_load(sourceFileName.c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+    if (!pixels) {
+        LOG_ERROR_S("Failed to load " << sourceFileName << " : " << stbi_failure_reason());
+        return false;
+    }
+
+    TextureEncoding encoding = chooseEncoding(channelCount, options);
+
+    // Only color is stored as sRGB, everything else is filtered as is
+    MipOptions mipOptions{};
+    mipOptions.srgb             = (encoding == TextureEncoding::BC7);
+    mipOptions.premultiplyAlpha = (encoding == TextureEncoding::BC7);
+
+    std::vector<MipLevel> levels, compressedLevels;
+    std::vector<uint8_t>  data, compressedData;
+
+    MipGenerator::generate(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), levels, data, mipOptions);
+    stbi_image_free(pixels);
+
+    TextureCompressor::compress(levels, data, encoding, compressedLevels, compressedData);
+
+    return write(fileName, encoding, compressedLevels, compressedData, sourceHash, sourceSize);
+}
+
+bool TextureCache::write(const std::string& fileName, TextureEncoding encoding,
+                         const std::vector<MipLevel>& levels, const std::vector<uint8_t>& data,
+                         uint64_t sourceHash, uint64_t sourceSize)
+{
+    if (levels.empty()) {
+        LOG_ERROR_S("Failed to write texture cache " << fileName << " : no levels");
+        return false;
+    }
+
+    std::vector<uint32_t> dfd = createDataFormatDescriptor(encoding);
+
+    // Keys in byte order
+    uint64_t source[3] = { sourceHash, sourceSize, TEXTURE_CACHE_VERSION };
+
+    std::vector<uint8_t> kvd;
+    appendKeyValue(kvd, KTX_WRITER_KEY, KTX_WRITER_VALUE, sizeof(KTX_WRITER_VALUE));
+    appendKeyValue(kvd, TEXTURE_CACHE_SOURCE_KEY, source, sizeof(source));
+
+
+    // Layout - levels are stored smallest first, each aligned to a block
+    uint32_t levelCount     = static_cast<uint32_t>(levels.size());
+    uint32_t levelAlignment = TextureCompressor::getBlockSize(encoding);
+
+    Ktx2Header header{};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat               = getFormat(encoding);
+    header.typeSize               = 1;
+    header.pixelWidth             = levels[0].width;
+    header.pixelHeight            = levels[0].height;
+    header.pixelDepth             = 0;
+    header.layerCount             = 0;
+    header.faceCount              = 1;
+    header.levelCount             = levelCount;
+    header.supercompressionScheme = 0;
+    header.dfdByteOffset          = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength          = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+    header.kvdByteOffset          = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength          = static_cast<uint32_t>(kvd.size());
+
+    std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+
+    uint64_t fileSize = header.kvdByteOffset + header.kvdByteLength;
+    for (uint32_t l=levelCount; l-- > 0;) {
+        levelIndex[l].byteOffset             = alignOffset(fileSize, levelAlignment);
+        levelIndex[l].byteLength             = levels[l].size;
+        levelIndex[l].uncompressedByteLength = levels[l].size;
+        fileSize = levelIndex[l].byteOffset + levelIndex[l].byteLength;
+    }
+
+
+    // Written to a temporary file first so a failed write never leaves a truncated cache behind
+    std::string tempFileName = fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR_S("Failed to create texture cache : " << fileName);
+            return false;
+        }
+
+        const char padding[16] = {};
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(Ktx2LevelIndex));
+        file.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+        file.write(reinterpret_cast<const char*>(kvd.data()), header.kvdByteLength);
+
+        uint64_t position = header.kvdByteOffset + header.kvdByteLength;
+        for (uint32_t l=levelCount; l-- > 0;) {
+            file.write(padding, levelIndex[l].byteOffset - position);
+            file.write(reinterpret_cast<const char*>(data.data() + levels[l].offset), levels[l].size);
+            position = levelIndex[l].byteOffset + levelIndex[l].byteLength;
+        }
+
+        if (!file.good()) {
+            LOG_ERROR_S("Failed to write texture cache : " << fileName);
+            file.close();
+            std::remove(tempFileName.c_str());
+            return false;
+        }
+    }
+
+    // rename() replaces the old file atomically on POSIX, readers see either one - Windows needs it gone first
+#ifdef _WIN32
+    std::remove(fileName.c_str());
+#endif
+    if (std::rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+        LOG_ERROR_S("Failed to write texture cache : " << fileName);
+        std::remove(tempFileName.c_str());
+        return false;
+    }
+
+    LOG_DEBUG_S("Wrote texture cache " << fileName << " : " << levels[0].width << "x" << levels[0].height << ", "
+                << levelCount << " levels (" << data.size() << " bytes)");
+
+    return true;
+}
+
+bool TextureCache::open(const std::string& fileName, uint64_t sourceHash, uint64_t sourceSize){
+    close();
+
+    if (!file.open(fileName)) return false;
+
+    if (file.size() < sizeof(Ktx2Header)) {
+        LOG_WARNING_S("Texture cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+    memcpy(&header, file.data(), sizeof(header));
+
+    // Only what TextureCache::write produces
+    TextureEncoding encoding{};
+    bool supportedFormat = true;
+    switch (header.vkFormat) {
+        case VK_FORMAT_BC7_SRGB_BLOCK:  encoding = TextureEncoding::BC7; break;
+        case VK_FORMAT_BC5_UNORM_BLOCK: encoding = TextureEncoding::BC5; break;
+        case VK_FORMAT_BC4_UNORM_BLOCK: encoding = TextureEncoding::BC4; break;
+        default:                        supportedFormat = false;
+    }
+
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || !supportedFormat ||
+        header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0 ||
+        header.pixelWidth == 0 || header.pixelHeight == 0 ||
+        header.levelCount == 0 || header.levelCount > MipGenerator::getMipLevelCount(header.pixelWidth, header.pixelHeight))
+    {
+        LOG_DEBUG_S("Texture cache " << fileName << " is in a format this loader doesn't handle");
+        close();
+        return false;
+    }
+
+    if (sizeof(Ktx2Header) + uint64_t(header.levelCount) * sizeof(Ktx2LevelIndex) > file.size() ||
+        uint64_t(header.kvdByteOffset) + header.kvdByteLength > file.size())
+    {
+        LOG_WARNING_S("Texture cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+
+    // Source key
+    bool           upToDate = false;
+    const uint8_t* kvd      = reinterpret_cast<const uint8_t*>(file.data()) + header.kvdByteOffset;
+
+    for (uint64_t position=0; position + sizeof(uint32_t) <= header.kvdByteLength;) {
+        uint32_t length;
+        memcpy(&length, kvd + position, sizeof(length));
+        position += sizeof(length);
+        if (position + length > header.kvdByteLength) break;
+
+        const char* key     = reinterpret_cast<const char*>(kvd + position);
+        size_t      keySize = sizeof(TEXTURE_CACHE_SOURCE_KEY);
+
+        if (length == keySize + 3 * sizeof(uint64_t) && memcmp(key, TEXTURE_CACHE_SOURCE_KEY, keySize) == 0) {
+            uint64_t source[3];
+            memcpy(source, kvd + position + keySize, sizeof(source));
+            upToDate = source[0] == sourceHash && source[1] == sourceSize && source[2] == TEXTURE_CACHE_VERSION;
+        }
+
+        position = alignOffset(position + length, 4);
+    }
+
+    if (!upToDate) {
+        LOG_DEBUG_S("Texture cache " << fileName << " is out of date");
+        close();
+        return false;
+    }
+
+
+    // Levels - every size must match its block count
+    uint32_t blockSize = TextureCompressor::getBlockSize(encoding);
+
+    std::vector<Ktx2LevelIndex> levelIndex(header.levelCount);
+    memcpy(levelIndex.data(), file.data() + sizeof(Ktx2Header), levelIndex.size() * sizeof(Ktx2LevelIndex));
+
+    levelDataOffset = UINT64_MAX;
+    uint64_t levelDataEnd = 0;
+    bool     validLevels  = true;
+
+    for (uint32_t l=0; validLevels && l < header.levelCount; ++l) {
+        uint32_t width  = std::max(header.pixelWidth  >> l, 1u);
+        uint32_t height = std::max(header.pixelHeight >> l, 1u);
+        uint64_t size   = uint64_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+
+        validLevels = levelIndex[l].byteLength == size && levelIndex[l].byteOffset % blockSize == 0 &&
+                      levelIndex[l].byteOffset + levelIndex[l].byteLength <= file.size();
+
+        levelDataOffset = std::min(levelDataOffset, levelIndex[l].byteOffset);
+        levelDataEnd    = std::max(levelDataEnd, levelIndex[l].byteOffset + levelIndex[l].byteLength);
+
+        levels.push_back(MipLevel{ width, height, levelIndex[l].byteOffset, size });
+    }
+
+    if (!validLevels) {
+        LOG_WARNING_S("Texture cache " << fileName << " is corrupt");
+        close();
+        return false;
+    }
+
+    levelDataSize = levelDataEnd - levelDataOffset;
+    for (MipLevel& level : levels) level.offset -= levelDataOffset;
+
+    return true;
+}
+
+void TextureCache::close(){
+    file.close();
+    header = {};
+    levels.clear();
+    levelDataOffset = 0;
+    levelDataSize   = 0;
+}
+
+bool                         TextureCache::isOpen()           const{ return file.isOpen(); }
+const Ktx2Header&            TextureCache::getHeader()        const{ return header; }
+VkFormat                     TextureCache::getFormat()        const{ return static_cast<VkFormat>(header.vkFormat); }
+const std::vector<MipLevel>& TextureCache::getLevels()        const{ return levels; }
+const uint8_t*               TextureCache::getLevelData()     const{ return reinterpret_cast<const uint8_t*>(file.data()) + levelDataOffset; }
+size_t                       TextureCache::getLevelDataSize() const{ return levelDataSize; }
@@ -0,0 +1,352 @@
+#include <textureCompressor.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// BC7 4-bit index interpolation weights, out of 64
+static const std::array<uint32_t, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Least squares refinements of the BC7 endpoints after the principal axis fit
+static const uint32_t BC7_REFINE_ITERATIONS = 2;
+
+
+//---BC4---
+// One channel block - the palette is fitted and indexed both ways, the mode with the smaller error is kept
+static uint32_t fitBC4(const uint8_t values[16], uint8_t endpoint0, uint8_t endpoint1, uint8_t indices[16]){
+    std::array<int32_t, 8> palette;
+    palette[0] = endpoint0;
+    palette[1] = endpoint1;
+
+    if (endpoint0 > endpoint1) {
+        for (int32_t i=2; i < 8; ++i) palette[i] = ((8 - i) * endpoint0 + (i - 1) * endpoint1 + 3) / 7;
+    } else {
+        for (int32_t i=2; i < 6; ++i) palette[i] = ((6 - i) * endpoint0 + (i - 1) * endpoint1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint32_t error = 0;
+    for (int t=0; t < 16; ++t) {
+        uint32_t bestError = UINT32_MAX;
+        for (uint8_t i=0; i < 8; ++i) {
+            uint32_t difference = static_cast<uint32_t>(std::abs(palette[i] - values[t]));
+            if (difference * difference < bestError) {
+                bestError  = difference * difference;
+                indices[t] = i;
+            }
+        }
+        error += bestError;
+    }
+
+    return error;
+}
+
+static void encodeBC4(const uint8_t values[16], uint8_t* block){
+    uint8_t minValue = 255, maxValue = 0;
+    uint8_t innerMin = 255, innerMax = 0;       // Ignoring 0 and 255, which the 6 value mode has for free
+
+    for (int t=0; t < 16; ++t) {
+        minValue = std::min(minValue, values[t]);
+        maxValue = std::max(maxValue, values[t]);
+
+        if (values[t] != 0 && values[t] != 255) {
+            innerMin = std::min(innerMin, values[t]);
+            innerMax = std::max(innerMax, values[t]);
+        }
+    }
+    if (innerMin > innerMax) innerMin = innerMax = 0;
+
+    uint8_t endpoints[2] = {}, indices[16];
+    uint32_t error = UINT32_MAX;
+
+    // 8 values : endpoint0 > endpoint1
+    if (maxValue > minValue) {
+        error        = fitBC4(values, maxValue, minValue, indices);
+        endpoints[0] = maxValue;
+        endpoints[1] = minValue;
+    }
+
+    // 6 values and 0/255 : endpoint0 <= endpoint1
+    uint8_t sixIndices[16];
+    uint32_t sixError = fitBC4(values, innerMin, innerMax, sixIndices);
+    if (sixError < error) {
+        memcpy(indices, sixIndices, sizeof(indices));
+        endpoints[0] = innerMin;
+        endpoints[1] = innerMax;
+    }
+
+    uint64_t bits = 0;
+    for (int t=0; t < 16; ++t) bits |= static_cast<uint64_t>(indices[t]) << (3 * t);
+
+    block[0] = endpoints[0];
+    block[1] = endpoints[1];
+    for (int i=0; i < 6; ++i) block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+
+//---BC7---
+// Mode 6 endpoint - 7 bits per channel, plus a p-bit shared by its 4 channels
+struct BC7Endpoint {
+    uint8_t color[4];
+    uint8_t pBit;
+
+    uint32_t expand(int channel) const{ return (static_cast<uint32_t>(color[channel]) << 1) | pBit; }
+};
+
+static BC7Endpoint quantizeBC7(const float value[4]){
+    BC7Endpoint best{};
+    float       bestError = std::numeric_limits<float>::max();
+
+    for (uint8_t pBit=0; pBit < 2; ++pBit) {
+        BC7Endpoint endpoint{};
+        endpoint.pBit = pBit;
+
+        float error = 0.0f;
+        for (int c=0; c < 4; ++c) {
+            float quantized  = std::round((value[c] - pBit) * 0.5f);
+            endpoint.color[c] = static_cast<uint8_t>(std::clamp(quantized, 0.0f, 127.0f));
+
+            float difference = static_cast<float>(endpoint.expand(c)) - value[c];
+            error += difference * difference;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            best      = endpoint;
+        }
+    }
+
+    return best;
+}
+
+static uint32_t indexBC7(const uint8_t pixels[16][4], const BC7Endpoint& endpoint0, const BC7Endpoint& endpoint1, uint8_t indices[16]){
+    int32_t palette[16][4];
+    for (int i=0; i < 16; ++i) {
+        for (int c=0; c < 4; ++c) {
+            palette[i][c] = static_cast<int32_t>(((64 - BC7_WEIGHTS[i]) * endpoint0.expand(c) + BC7_WEIGHTS[i] * endpoint1.expand(c) + 32) >> 6);
+        }
+    }
+
+    uint32_t error = 0;
+    for (int t=0; t < 16; ++t) {
+        uint32_t bestError = UINT32_MAX;
+        for (uint8_t i=0; i < 16; ++i) {
+            uint32_t distance = 0;
+            for (int c=0; c < 4; ++c) {
+                int32_t difference = palette[i][c] - pixels[t][c];
+                distance += static_cast<uint32_t>(difference * difference);
+            }
+            if (distance < bestError) {
+                bestError  = distance;
+                indices[t] = i;
+            }
+        }
+        error += bestError;
+    }
+
+    return error;
+}
+
+// Endpoints minimizing the squared error for fixed indices - false if every index is the same
+static bool refineBC7(const uint8_t pixels[16][4], const uint8_t indices[16], float endpoint0[4], float endpoint1[4]){
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x0[4] = {}, x1[4] = {};
+
+    for (int t=0; t < 16; ++t) {
+        float w = BC7_WEIGHTS[indices[t]] / 64.0f;
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        c += w * w;
+        for (int ch=0; ch < 4; ++ch) {
+            x0[ch] += (1.0f - w) * pixels[t][ch];
+            x1[ch] += w * pixels[t][ch];
+        }
+    }
+
+    float determinant = a * c - b * b;
+    if (std::fabs(determinant) < 1e-6f) return false;
+
+    for (int ch=0; ch < 4; ++ch) {
+        endpoint0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+        endpoint1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+    }
+
+    return true;
+}
+
+static void writeBits(uint64_t bits[2], uint32_t& position, uint32_t value, uint32_t count){
+    for (uint32_t i=0; i < count; ++i, ++position) {
+        bits[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+    }
+}
+
+static void encodeBC7(const uint8_t pixels[16][4], uint8_t* block){
+    // Principal axis of the block colors
+    float mean[4] = {}, low[4], high[4];
+    for (int c=0; c < 4; ++c) low[c] = 255.0f, high[c] = 0.0f;
+
+    for (int t=0; t < 16; ++t) {
+        for (int c=0; c < 4; ++c) {
+            mean[c] += pixels[t][c] / 16.0f;
+            low[c]   = std::min(low[c],  static_cast<float>(pixels[t][c]));
+            high[c]  = std::max(high[c], static_cast<float>(pixels[t][c]));
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (int t=0; t < 16; ++t) {
+        for (int i=0; i < 4; ++i) {
+            for (int j=0; j < 4; ++j) covariance[i][j] += (pixels[t][i] - mean[i]) * (pixels[t][j] - mean[j]);
+        }
+    }
+
+    float axis[4];
+    for (int c=0; c < 4; ++c) axis[c] = high[c] - low[c];
+
+    for (int iteration=0; iteration < 8; ++iteration) {
+        float next[4] = {}, length = 0.0f;
+        for (int i=0; i < 4; ++i) {
+            for (int j=0; j < 4; ++j) next[i] += covariance[i][j] * axis[j];
+            length = std::max(length, std::fabs(next[i]));
+        }
+        if (length == 0.0f) break;
+        for (int c=0; c < 4; ++c) axis[c] = next[c] / length;
+    }
+
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+    float tMin = 0.0f, tMax = 0.0f;
+
+    if (axisLength > 0.0f) {
+        for (int c=0; c < 4; ++c) axis[c] /= axisLength;
+
+        tMin = std::numeric_limits<float>::max();
+        tMax = std::numeric_limits<float>::lowest();
+        for (int t=0; t < 16; ++t) {
+            float projection = 0.0f;
+            for (int c=0; c < 4; ++c) projection += (pixels[t][c] - mean[c]) * axis[c];
+            tMin = std::min(tMin, projection);
+            tMax = std::max(tMax, projection);
+        }
+    }
+
+    float endpoint0[4], endpoint1[4];
+    for (int c=0; c < 4; ++c) {
+        endpoint0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+        endpoint1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+    }
+
+
+    // Quantize, index, refine - keeping the best fit
+    BC7Endpoint best0 = quantizeBC7(endpoint0), best1 = quantizeBC7(endpoint1);
+    uint8_t     bestIndices[16];
+    uint32_t    bestError = indexBC7(pixels, best0, best1, bestIndices);
+
+    uint8_t indices[16];
+    memcpy(indices, bestIndices, sizeof(indices));
+
+    for (uint32_t iteration=0; iteration < BC7_REFINE_ITERATIONS && bestError > 0; ++iteration) {
+        if (!refineBC7(pixels, indices, endpoint0, endpoint1)) break;
+
+        BC7Endpoint candidate0 = quantizeBC7(endpoint0), candidate1 = quantizeBC7(endpoint1);
+        uint32_t    error      = indexBC7(pixels, candidate0, candidate1, indices);
+
+        if (error >= bestError) break;
+
+        bestError = error;
+        best0     = candidate0;
+        best1     = candidate1;
+        memcpy(bestIndices, indices, sizeof(indices));
+    }
+
+
+    // The first index is stored without its top bit, so it must be below 8
+    if (bestIndices[0] & 8) {
+        std::swap(best0, best1);
+        for (int t=0; t < 16; ++t) bestIndices[t] = 15 - bestIndices[t];
+    }
+
+    uint64_t bits[2]  = {};
+    uint32_t position = 0;
+
+    writeBits(bits, position, 1 << 6, 7);                  // Mode 6
+    for (int c=0; c < 4; ++c) {
+        writeBits(bits, position, best0.color[c], 7);
+        writeBits(bits, position, best1.color[c], 7);
+    }
+    writeBits(bits, position, best0.pBit, 1);
+    writeBits(bits, position, best1.pBit, 1);
+
+    writeBits(bits, position, bestIndices[0], 3);
+    for (int t=1; t < 16; ++t) writeBits(bits, position, bestIndices[t], 4);
+
+    memcpy(block, bits, sizeof(bits));
+}
+
+
+uint32_t TextureCompressor::getBlockSize(TextureEncoding encoding){
+    return (encoding == TextureEncoding::BC4)? 8 : 16;
+}
+
+void TextureCompressor::compress(const std::vector<MipLevel>& levels, const std::vector<uint8_t>& data, TextureEncoding encoding,
+                                 std::vector<MipLevel>& compressedLevels, std::vector<uint8_t>& compressedData)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    uint32_t blockSize = getBlockSize(encoding);
+
+    // Layout
+    compressedLevels.clear();
+    size_t dataSize = 0;
+    for (const MipLevel& level : levels) {
+        size_t blockCount = size_t((level.width + 3) / 4) * ((level.height + 3) / 4);
+        compressedLevels.push_back(MipLevel{ level.width, level.height, dataSize, blockCount * blockSize });
+        dataSize += compressedLevels.back().size;
+    }
+
+    compressedData.resize(dataSize);
+
+
+    for (size_t l=0; l < levels.size(); ++l) {
+        const MipLevel& level       = levels[l];
+        const uint8_t*  levelPixels = data.data() + level.offset;
+        uint8_t*        levelBlocks = compressedData.data() + compressedLevels[l].offset;
+
+        uint32_t blocksWide = (level.width  + 3) / 4;
+        uint32_t blocksHigh = (level.height + 3) / 4;
+
+        ThreadPool::get().parallelFor(blocksHigh, 1, [&](size_t begin, size_t end){
+            uint8_t pixels[16][4];
+
+            for (size_t by=begin; by < end; ++by) {
+                for (uint32_t bx=0; bx < blocksWide; ++bx) {
+                    for (uint32_t t=0; t < 16; ++t) {
+                        uint32_t x = std::min<uint32_t>(bx * 4 + t % 4, level.width  - 1);
+                        uint32_t y = std::min<uint32_t>(static_cast<uint32_t>(by) * 4 + t / 4, level.height - 1);
+                        memcpy(pixels[t], levelPixels + (size_t(y) * level.width + x) * 4, 4);
+                    }
+
+                    uint8_t* block = levelBlocks + (by * blocksWide + bx) * blockSize;
+
+                    if (encoding == TextureEncoding::BC7) {
+                        encodeBC7(pixels, block);
+                    } else {
+                        // BC4 is the red channel, BC5 one BC4 block for red then one for green
+                        uint32_t channelCount = (encoding == TextureEncoding::BC5)? 2 : 1;
+                        for (uint32_t c=0; c < channelCount; ++c) {
+                            uint8_t values[16];
+                            for (int t=0; t < 16; ++t) values[t] = pixels[t][c];
+                            encodeBC4(values, block + c * 8);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    const char* encodingName = (encoding == TextureEncoding::BC7)? "BC7" : (encoding == TextureEncoding::BC5)? "BC5" : "BC4";
+    LOG_DEBUG_S("Compressed " << levels.size() << " levels to " << encodingName << " (" << data.size() << " -> "
+                << compressedData.size() << " bytes) in " << elapsedMs << " ms");
+}
@@ -0,0 +1,56 @@
+#include <textureRegistry.hpp>
+#include <logger.hpp>
+
+
+void TextureRegistry::init(uint32_t slotCount, uint32_t frames){
+    capacity       = slotCount;
+    framesInFlight = frames;
+    frame          = 0;
+    nextSlot       = 0;
+
+    freeSlots.clear();
+    retiredSlots.clear();
+    allocated.assign(capacity, 0);
+}
+
+uint32_t TextureRegistry::allocate(){
+    uint32_t slot = 0;
+
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else if (nextSlot < capacity) {
+        slot = nextSlot++;
+    } else {
+        LOG_FATAL_S("Texture registry : all " << capacity << " slots are in use (" << retiredSlots.size() << " waiting on frames in flight)");
+    }
+
+    allocated[slot] = 1;
+    return slot;
+}
+
+void TextureRegistry::retire(uint32_t slot){
+    if (slot >= capacity || !allocated[slot]) {
+        LOG_ERROR_S("Texture registry : slot " << slot << " isn't allocated");
+        return;
+    }
+
+    allocated[slot] = 0;
+    retiredSlots.push_back({ frame, slot });
+}
+
+void TextureRegistry::beginFrame(){
+    ++frame;
+
+    // Frames up to the one retiring a slot may sample it - the last of them has completed framesInFlight frames later
+    while (!retiredSlots.empty() && retiredSlots.front().first + framesInFlight <= frame) {
+        freeSlots.push_back(retiredSlots.front().second);
+        retiredSlots.pop_front();
+    }
+}
+
+uint32_t TextureRegistry::getCapacity() const{ return capacity; }
+
+uint32_t TextureRegistry::getCount() const{
+    return nextSlot - static_cast<uint32_t>(freeSlots.size() + retiredSlots.size());
+}
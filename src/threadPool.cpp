@@ -0,0 +1,124 @@
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// Innitialize static members
+ThreadPool* ThreadPool::instance = nullptr;
+std::mutex  ThreadPool::instanceMutex;
+
+
+ThreadPool& ThreadPool::get(){
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    if (instance == nullptr) {
+        instance = new ThreadPool();
+    }
+    return *instance;
+}
+
+void ThreadPool::destroy(){
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    if (instance != nullptr) {
+        delete instance;
+        instance = nullptr;
+    }
+}
+
+ThreadPool::ThreadPool(){
+    uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // The calling thread takes part in parallelFor(), so one less worker is needed
+    for (uint32_t i=1; i < hardwareThreads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    LOG_TRACE_S("Thread pool : " << workers.size() << " worker threads");
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::getThreadCount() const{ return static_cast<uint32_t>(workers.size()) + 1; }
+
+void ThreadPool::parallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t begin, size_t end)>& task){
+    if (count == 0) return;
+
+    minBatchSize = std::max<size_t>(1, minBatchSize);
+
+    // A few batches per thread so uneven batches still balance out
+    size_t batchCount = std::min((count + minBatchSize - 1) / minBatchSize, static_cast<size_t>(getThreadCount()) * 4);
+
+    if (batchCount <= 1 || workers.empty()) {
+        task(0, count);
+        return;
+    }
+
+    size_t batchSize = (count + batchCount - 1) / batchCount;
+    batchCount       = (count + batchSize - 1) / batchSize;
+
+    // Shared with the helper tasks - those can still be dequeued after this call has returned
+    struct Batches {
+        std::atomic<size_t>     next{0};
+        std::atomic<size_t>     done{0};
+        std::mutex              doneMutex;
+        std::condition_variable allDone;
+    };
+    auto batches = std::make_shared<Batches>();
+
+    auto consume = [batches, &task, count, batchSize, batchCount](){
+        size_t batch;
+        while ((batch = batches->next.fetch_add(1)) < batchCount) {
+            size_t begin = batch * batchSize;
+            task(begin, std::min(begin + batchSize, count));
+
+            if (batches->done.fetch_add(1) + 1 == batchCount) {
+                std::lock_guard<std::mutex> lock(batches->doneMutex);
+                batches->allDone.notify_all();
+            }
+        }
+    };
+
+    size_t helperCount = std::min(workers.size(), batchCount - 1);
+    for (size_t i=0; i < helperCount; ++i) {
+        enqueue(consume);
+    }
+
+    consume();
+
+    std::unique_lock<std::mutex> lock(batches->doneMutex);
+    batches->allDone.wait(lock, [&batches, batchCount](){ return batches->done.load() == batchCount; });
+}
+
+void ThreadPool::enqueue(std::function<void()> task){
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop(){
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(taskMutex);
+            taskAvailable.wait(lock, [this](){ return stopping || !tasks.empty(); });
+
+            if (stopping && tasks.empty()) return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,349 @@
+#include <tlsfAllocator.hpp>
+#include <logger.hpp>
+
+
+static inline uint32_t highestBit(uint64_t value){ return 63 - static_cast<uint32_t>(__builtin_clzll(value)); }
+static inline uint32_t lowestBit(uint64_t value) { return static_cast<uint32_t>(__builtin_ctzll(value)); }
+
+static inline uint64_t alignUp(uint64_t value, uint64_t alignment){ return (value + alignment - 1) & ~(alignment - 1); }
+
+static inline bool onSamePage(uint64_t a, uint64_t b, uint64_t pageSize){ return (a & ~(pageSize - 1)) == (b & ~(pageSize - 1)); }
+
+
+void TlsfAllocator::init(uint64_t totalSize, uint64_t pageSize){
+    size            = totalSize;
+    granularity     = std::max<uint64_t>(1, pageSize);
+    usedSize        = 0;
+    allocationCount = 0;
+    freeRangeCount  = 0;
+
+    ranges.clear();
+    unusedRanges.clear();
+
+    firstLevelBitmap = 0;
+    secondLevelBitmaps.fill(0);
+    freeLists.fill(NONE);
+
+    Range whole{};
+    whole.size = totalSize;
+    ranges.push_back(whole);
+    insertFree(0);
+}
+
+uint32_t TlsfAllocator::allocate(uint64_t allocationSize, uint64_t alignment, SuballocationType type, uint64_t& offset){
+    allocationSize = std::max<uint64_t>(1, allocationSize);
+    alignment      = std::max<uint64_t>(1, alignment);
+
+    if (allocationSize > size) return INVALID_HANDLE;
+
+    // Worst case a range needs to hold the allocation wherever it starts - alignment padding, plus a granularity page
+    // skipped on both sides when the neighbours are of the other type
+    uint64_t paddedSize = allocationSize + alignment - 1;
+    if (granularity > 1) {
+        paddedSize = allocationSize + std::max(alignment, granularity) - 1 + granularity - 1;
+    }
+
+    uint32_t found = NONE;
+
+    // Good fit : round the size up to the next class, so the head of any list found is large enough - O(1)
+    uint64_t searchSize = (paddedSize < SMALL_SIZE)? paddedSize + (SMALL_SIZE / SECOND_LEVEL_COUNT) - 1
+                                                   : paddedSize + (1ull << (highestBit(paddedSize) - SECOND_LEVEL_BITS)) - 1;
+    uint32_t firstLevel, secondLevel;
+    mapping(searchSize, firstLevel, secondLevel);
+
+    if (searchSize >= paddedSize && findFreeList(firstLevel, secondLevel)) {
+        uint32_t head = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+        if (fits(head, allocationSize, alignment, type, offset)) found = head;
+    }
+
+    // Tight fit : the padding is rarely all needed, check every range from the class of the exact size up
+    if (found == NONE) {
+        mapping(allocationSize, firstLevel, secondLevel);
+
+        while (found == NONE && findFreeList(firstLevel, secondLevel)) {
+            for (uint32_t index = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel]; index != NONE; index = ranges[index].nextFree) {
+                if (fits(index, allocationSize, alignment, type, offset)) {
+                    found = index;
+                    break;
+                }
+            }
+
+            if (++secondLevel == SECOND_LEVEL_COUNT) {
+                secondLevel = 0;
+                if (++firstLevel == FIRST_LEVEL_COUNT) break;
+            }
+        }
+    }
+
+    if (found == NONE) return INVALID_HANDLE;
+
+    removeFree(found);
+    split(found, offset, allocationSize);
+
+    ranges[found].type     = type;
+    ranges[found].usedSize = allocationSize;
+    usedSize += allocationSize;
+    ++allocationCount;
+
+    return found;
+}
+
+void TlsfAllocator::free(uint32_t handle){
+    if (handle >= ranges.size() || ranges[handle].type == SuballocationType::FREE || ranges[handle].size == 0) {
+        LOG_ERROR_S("Freeing an invalid TLSF allocation handle (" << handle << ")");
+        return;
+    }
+
+    usedSize -= ranges[handle].usedSize;
+    --allocationCount;
+
+    ranges[handle].type     = SuballocationType::FREE;
+    ranges[handle].usedSize = 0;
+
+    // Coalesce with the previous range
+    uint32_t prev = ranges[handle].prevPhysical;
+    if (prev != NONE && ranges[prev].type == SuballocationType::FREE) {
+        removeFree(prev);
+
+        ranges[prev].size        += ranges[handle].size;
+        ranges[prev].nextPhysical = ranges[handle].nextPhysical;
+        if (ranges[prev].nextPhysical != NONE) ranges[ranges[prev].nextPhysical].prevPhysical = prev;
+
+        ranges[handle].size = 0;
+        unusedRanges.push_back(handle);
+        handle = prev;
+    }
+
+    // And the next one
+    uint32_t next = ranges[handle].nextPhysical;
+    if (next != NONE && ranges[next].type == SuballocationType::FREE) {
+        removeFree(next);
+
+        ranges[handle].size        += ranges[next].size;
+        ranges[handle].nextPhysical = ranges[next].nextPhysical;
+        if (ranges[handle].nextPhysical != NONE) ranges[ranges[handle].nextPhysical].prevPhysical = handle;
+
+        ranges[next].size = 0;
+        unusedRanges.push_back(next);
+    }
+
+    insertFree(handle);
+}
+
+uint64_t TlsfAllocator::getSize()            const{ return size; }
+uint64_t TlsfAllocator::getUsedSize()        const{ return usedSize; }
+uint32_t TlsfAllocator::getAllocationCount() const{ return allocationCount; }
+uint32_t TlsfAllocator::getFreeRangeCount()  const{ return freeRangeCount; }
+bool     TlsfAllocator::isEmpty()            const{ return allocationCount == 0; }
+
+uint64_t TlsfAllocator::getLargestFreeRange() const{
+    if (firstLevelBitmap == 0) return 0;
+
+    // Only the highest non-empty class can hold the largest range
+    uint32_t firstLevel  = highestBit(firstLevelBitmap);
+    uint32_t secondLevel = highestBit(secondLevelBitmaps[firstLevel]);
+
+    uint64_t largest = 0;
+    for (uint32_t index = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel]; index != NONE; index = ranges[index].nextFree) {
+        largest = std::max(largest, ranges[index].size);
+    }
+    return largest;
+}
+
+bool TlsfAllocator::validate() const{
+    std::vector<uint32_t> live;
+    for (uint32_t i=0; i < ranges.size(); ++i) {
+        if (ranges[i].size > 0) live.push_back(i);
+    }
+    std::sort(live.begin(), live.end(), [&](uint32_t a, uint32_t b){ return ranges[a].offset < ranges[b].offset; });
+
+    // Ranges tile [0, size) and are linked in address order, free ones never touch
+    uint64_t offset = 0, used = 0;
+    uint32_t allocations = 0, freeRanges = 0;
+    for (size_t i=0; i < live.size(); ++i) {
+        const Range& range = ranges[live[i]];
+        uint32_t     prev  = (i > 0)?               live[i - 1] : NONE;
+        uint32_t     next  = (i + 1 < live.size())? live[i + 1] : NONE;
+
+        if (range.offset != offset || range.prevPhysical != prev || range.nextPhysical != next) return false;
+
+        if (range.type == SuballocationType::FREE) {
+            if (prev != NONE && ranges[prev].type == SuballocationType::FREE) return false;
+            ++freeRanges;
+        } else {
+            if (range.usedSize != range.size) return false;
+            used += range.usedSize;
+            ++allocations;
+        }
+        offset += range.size;
+    }
+    if (offset != size || used != usedSize || allocations != allocationCount || freeRanges != freeRangeCount) return false;
+
+    // Every free range is in the list of its class, and the bitmaps match the lists
+    uint32_t listed = 0;
+    for (uint32_t firstLevel=0; firstLevel < FIRST_LEVEL_COUNT; ++firstLevel) {
+        for (uint32_t secondLevel=0; secondLevel < SECOND_LEVEL_COUNT; ++secondLevel) {
+            uint32_t head = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+            bool     bit  = (secondLevelBitmaps[firstLevel] >> secondLevel) & 1;
+            if (bit != (head != NONE)) return false;
+
+            uint32_t prev = NONE;
+            for (uint32_t index = head; index != NONE; index = ranges[index].nextFree) {
+                uint32_t rangeFirstLevel, rangeSecondLevel;
+                mapping(ranges[index].size, rangeFirstLevel, rangeSecondLevel);
+
+                if (ranges[index].type != SuballocationType::FREE || ranges[index].prevFree != prev ||
+                    rangeFirstLevel != firstLevel || rangeSecondLevel != secondLevel) return false;
+
+                prev = index;
+                if (++listed > freeRangeCount) return false;
+            }
+        }
+        if (((firstLevelBitmap >> firstLevel) & 1) != (secondLevelBitmaps[firstLevel] != 0)) return false;
+    }
+
+    return listed == freeRangeCount;
+}
+
+
+//---Size classes---
+void TlsfAllocator::mapping(uint64_t rangeSize, uint32_t& firstLevel, uint32_t& secondLevel){
+    if (rangeSize < SMALL_SIZE) {
+        firstLevel  = 0;
+        secondLevel = static_cast<uint32_t>(rangeSize / (SMALL_SIZE / SECOND_LEVEL_COUNT));
+    } else {
+        uint32_t bit = highestBit(rangeSize);
+        firstLevel  = bit - SMALL_SIZE_SHIFT + 1;
+        secondLevel = static_cast<uint32_t>(rangeSize >> (bit - SECOND_LEVEL_BITS)) & (SECOND_LEVEL_COUNT - 1);
+    }
+}
+
+bool TlsfAllocator::findFreeList(uint32_t& firstLevel, uint32_t& secondLevel) const{
+    uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+
+    if (secondLevelMap == 0) {
+        uint64_t firstLevelMap = (firstLevel + 1 < FIRST_LEVEL_COUNT)? firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0) return false;
+
+        firstLevel     = lowestBit(firstLevelMap);
+        secondLevelMap = secondLevelBitmaps[firstLevel];
+    }
+
+    secondLevel = lowestBit(secondLevelMap);
+    return true;
+}
+
+bool TlsfAllocator::conflicts(SuballocationType a, SuballocationType b) const{
+    return a != SuballocationType::FREE && b != SuballocationType::FREE && a != b;
+}
+
+bool TlsfAllocator::fits(uint32_t index, uint64_t allocationSize, uint64_t alignment, SuballocationType type, uint64_t& offset) const{
+    const Range& range = ranges[index];
+
+    offset = alignUp(range.offset, alignment);
+
+    // The previous used range ends on the page this would start on - move to the next page
+    if (granularity > 1 && range.prevPhysical != NONE) {
+        const Range& prev = ranges[range.prevPhysical];
+        if (conflicts(prev.type, type) && onSamePage(prev.offset + prev.size - 1, offset, granularity)) {
+            offset = alignUp(offset, granularity);
+        }
+    }
+
+    if (offset + allocationSize > range.offset + range.size) return false;
+
+    // The next used range starts on the page this would end on - a later range may still fit
+    if (granularity > 1 && range.nextPhysical != NONE) {
+        const Range& next = ranges[range.nextPhysical];
+        if (conflicts(next.type, type) && onSamePage(offset + allocationSize - 1, next.offset, granularity)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//---Ranges---
+uint32_t TlsfAllocator::newRange(){
+    if (!unusedRanges.empty()) {
+        uint32_t index = unusedRanges.back();
+        unusedRanges.pop_back();
+        ranges[index] = Range{};
+        return index;
+    }
+
+    ranges.emplace_back();
+    return static_cast<uint32_t>(ranges.size() - 1);
+}
+
+void TlsfAllocator::insertFree(uint32_t index){
+    uint32_t firstLevel, secondLevel;
+    mapping(ranges[index].size, firstLevel, secondLevel);
+
+    uint32_t& head = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+
+    ranges[index].type     = SuballocationType::FREE;
+    ranges[index].prevFree = NONE;
+    ranges[index].nextFree = head;
+    if (head != NONE) ranges[head].prevFree = index;
+    head = index;
+
+    secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    firstLevelBitmap               |= 1ull << firstLevel;
+    ++freeRangeCount;
+}
+
+void TlsfAllocator::removeFree(uint32_t index){
+    uint32_t firstLevel, secondLevel;
+    mapping(ranges[index].size, firstLevel, secondLevel);
+
+    uint32_t& head = freeLists[firstLevel * SECOND_LEVEL_COUNT + secondLevel];
+    uint32_t  prev = ranges[index].prevFree;
+    uint32_t  next = ranges[index].nextFree;
+
+    if (prev != NONE) ranges[prev].nextFree = next;
+    else              head = next;
+    if (next != NONE) ranges[next].prevFree = prev;
+
+    if (head == NONE) {
+        secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (secondLevelBitmaps[firstLevel] == 0) firstLevelBitmap &= ~(1ull << firstLevel);
+    }
+
+    ranges[index].prevFree = NONE;
+    ranges[index].nextFree = NONE;
+    --freeRangeCount;
+}
+
+// Shrinks a range (out of the free lists) to [offset, offset + size), the parts before and after become free ranges
+void TlsfAllocator::split(uint32_t index, uint64_t offset, uint64_t allocationSize){
+    if (offset > ranges[index].offset) {
+        uint32_t leading = newRange();
+
+        ranges[leading].offset       = ranges[index].offset;
+        ranges[leading].size         = offset - ranges[index].offset;
+        ranges[leading].prevPhysical = ranges[index].prevPhysical;
+        ranges[leading].nextPhysical = index;
+        if (ranges[leading].prevPhysical != NONE) ranges[ranges[leading].prevPhysical].nextPhysical = leading;
+
+        ranges[index].prevPhysical = leading;
+        ranges[index].offset       = offset;
+        ranges[index].size        -= ranges[leading].size;
+        insertFree(leading);
+    }
+
+    if (ranges[index].size > allocationSize) {
+        uint32_t trailing = newRange();
+
+        ranges[trailing].offset       = offset + allocationSize;
+        ranges[trailing].size         = ranges[index].size - allocationSize;
+        ranges[trailing].prevPhysical = index;
+        ranges[trailing].nextPhysical = ranges[index].nextPhysical;
+        if (ranges[trailing].nextPhysical != NONE) ranges[ranges[trailing].nextPhysical].prevPhysical = trailing;
+
+        ranges[index].nextPhysical = trailing;
+        ranges[index].size         = allocationSize;
+        insertFree(trailing);
+    }
+}
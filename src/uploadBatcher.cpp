@@ -0,0 +1,311 @@
+#include <uploadBatcher.hpp>
+#include <logger.hpp>
+
+
+void UploadBatcher::init(VkDevice logicalDevice, VkQueue queue, VkCommandPool commandPool,
+                         uint32_t transferQueueFamily, uint32_t graphicsQueueFamily,
+                         StagingRing& ring, VkSemaphore transferTimeline
+){
+    device              = logicalDevice;
+    transferQueue       = queue;
+    transferCommandPool = commandPool;
+    transferFamily      = transferQueueFamily;
+    graphicsFamily      = graphicsQueueFamily;
+    stagingRing         = &ring;
+    timeline            = transferTimeline;
+
+    LOG_TRACE_S("Upload batcher : " << (ownershipTransfer()? "queue family ownership transfers" : "single queue family")
+                << ", " << (timeline != VK_NULL_HANDLE? "timeline" : "fence") << " completion");
+}
+
+void UploadBatcher::destroy(){
+    for (auto& batch : submitted) destroyBatch(batch);
+    submitted.clear();
+    recording = Batch{};
+}
+
+void UploadBatcher::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                                 VkPipelineStageFlags dstStages, VkAccessFlags dstAccess
+){
+    if (size == 0) return;
+
+    StagingAllocation staging = stagingRing->allocate(size);
+    memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+    BufferCopy copy{};
+    copy.source           = staging.buffer;
+    copy.destination      = buffer;
+    copy.region.srcOffset = staging.offset;
+    copy.region.dstOffset = offset;
+    copy.region.size      = size;
+    recording.bufferCopies.push_back(copy);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = dstAccess;
+
+    if (ownershipTransfer()) {
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+
+        // Access masks of the other queue are ignored
+        VkBufferMemoryBarrier acquireBarrier = barrier;
+        acquireBarrier.srcAccessMask = 0;
+        barrier.dstAccessMask        = 0;
+
+        recording.bufferAcquires.push_back(acquireBarrier);
+        recording.acquireStages |= dstStages;
+    } else {
+        recording.releaseStages |= dstStages;
+    }
+
+    recording.bufferReleases.push_back(barrier);
+}
+
+void UploadBatcher::uploadImage(VkImage image, uint32_t mipLevels, const std::vector<MipLevel>& levels, const void* data, VkDeviceSize size,
+                                VkImageLayout finalLayout, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess
+){
+    // 16 bytes covers the texel block size of every format uploaded
+    StagingAllocation staging = stagingRing->allocate(size, 16);
+    memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+    ImageCopy copy{};
+    copy.source      = staging.buffer;
+    copy.destination = image;
+    copy.regions.resize(levels.size());
+
+    for (size_t i=0; i < levels.size(); ++i) {
+        copy.regions[i].bufferOffset      = staging.offset + levels[i].offset;
+        copy.regions[i].bufferRowLength   = 0;
+        copy.regions[i].bufferImageHeight = 0;
+
+        copy.regions[i].imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.regions[i].imageSubresource.mipLevel       = static_cast<uint32_t>(i);
+        copy.regions[i].imageSubresource.baseArrayLayer = 0;
+        copy.regions[i].imageSubresource.layerCount     = 1;
+
+        copy.regions[i].imageOffset = {0, 0, 0};
+        copy.regions[i].imageExtent = {levels[i].width, levels[i].height, 1};
+    }
+    recording.imageCopies.push_back(std::move(copy));
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    recording.imageTransitions.push_back(barrier);
+
+    // The layout transition is part of both halves of an ownership transfer
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+
+    if (ownershipTransfer()) {
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+
+        VkImageMemoryBarrier acquireBarrier = barrier;
+        acquireBarrier.srcAccessMask = 0;
+        barrier.dstAccessMask        = 0;
+
+        recording.imageAcquires.push_back(acquireBarrier);
+        recording.acquireStages |= dstStages;
+    } else {
+        recording.releaseStages |= dstStages;
+    }
+
+    recording.imageReleases.push_back(barrier);
+}
+
+uint64_t UploadBatcher::submit(){
+    retireCompleted();
+
+    if (recording.isEmpty()) return 0;
+
+    Batch batch  = std::move(recording);
+    recording    = Batch{};
+    batch.ticket = ++lastTicket;
+
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool        = transferCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    LOG_RESULT(
+        vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer),
+        "Allocate upload command buffer"
+    );
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+        if (!batch.imageTransitions.empty()) {
+            vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(batch.imageTransitions.size()), batch.imageTransitions.data());
+        }
+
+        for (const auto& copy : batch.bufferCopies) {
+            vkCmdCopyBuffer(batch.commandBuffer, copy.source, copy.destination, 1, &copy.region);
+        }
+        for (const auto& copy : batch.imageCopies) {
+            vkCmdCopyBufferToImage(batch.commandBuffer, copy.source, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(copy.regions.size()), copy.regions.data());
+        }
+
+        // Releases only need to be ordered after the copies - the graphics queue's acquire waits on the timeline
+        VkPipelineStageFlags releaseStages = batch.releaseStages;
+        if (ownershipTransfer()) releaseStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, releaseStages, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(batch.bufferReleases.size()), batch.bufferReleases.data(),
+                             static_cast<uint32_t>(batch.imageReleases.size()),  batch.imageReleases.data());
+
+    vkEndCommandBuffer(batch.commandBuffer);
+
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &batch.commandBuffer;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &batch.ticket;
+
+    if (timeline != VK_NULL_HANDLE) {
+        submitInfo.pNext                = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &timeline;
+    } else {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        LOG_RESULT_SILENT(
+            vkCreateFence(device, &fenceInfo, nullptr, &batch.fence),
+            "Create upload fence"
+        );
+    }
+
+    LOG_RESULT_SILENT(
+        vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence),
+        "Submit upload batch"
+    );
+
+    if (timeline != VK_NULL_HANDLE) stagingRing->submit(timeline, batch.ticket);
+    else                            stagingRing->submit(batch.fence);
+
+    LOG_TRACE_S("Upload batch " << batch.ticket << " : " << batch.bufferCopies.size() << " buffers, " << batch.imageCopies.size() << " images");
+
+    submitted.push_back(std::move(batch));
+    return lastTicket;
+}
+
+bool UploadBatcher::isComplete(uint64_t ticket){
+    for (const auto& batch : submitted) {
+        if (batch.ticket == ticket) return isComplete(batch);
+    }
+    return ticket <= lastTicket;        // Already retired
+}
+
+void UploadBatcher::acquire(uint64_t ticket){
+    for (auto& batch : submitted) {
+        if (batch.ticket == ticket) batch.acquireRequested = true;
+    }
+}
+
+UploadWait UploadBatcher::recordAcquires(VkCommandBuffer graphicsCommandBuffer){
+    UploadWait wait{};
+
+    std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    std::vector<VkImageMemoryBarrier>  imageAcquires;
+
+    for (auto& batch : submitted) {
+        if (!batch.acquireRequested) continue;
+
+        bufferAcquires.insert(bufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+        imageAcquires.insert(imageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+
+        if (!batch.bufferAcquires.empty() || !batch.imageAcquires.empty()) {
+            // No timeline to wait on in the submit - the release has to be done before it is recorded
+            if (batch.fence != VK_NULL_HANDLE) vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            else                               wait.value = std::max(wait.value, batch.ticket);
+
+            wait.stages |= batch.acquireStages;
+        }
+
+        batch.bufferAcquires.clear();
+        batch.imageAcquires.clear();
+        batch.acquireRequested = false;
+    }
+
+    if (!bufferAcquires.empty() || !imageAcquires.empty()) {
+        // Source stages match the semaphore wait so the acquire is ordered after it
+        vkCmdPipelineBarrier(graphicsCommandBuffer, wait.stages, wait.stages, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(bufferAcquires.size()), bufferAcquires.data(),
+                             static_cast<uint32_t>(imageAcquires.size()),  imageAcquires.data());
+    }
+
+    if (wait.value == 0) wait.stages = 0;
+
+    retireCompleted();
+    return wait;
+}
+
+VkSemaphore UploadBatcher::getTimeline() const{ return timeline; }
+
+
+bool UploadBatcher::ownershipTransfer() const{ return transferFamily != graphicsFamily; }
+
+bool UploadBatcher::isComplete(const Batch& batch) const{
+    if (batch.fence != VK_NULL_HANDLE) {
+        return vkGetFenceStatus(device, batch.fence) == VK_SUCCESS;
+    }
+
+    uint64_t completedValue = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &completedValue);
+    return completedValue >= batch.ticket;
+}
+
+// Batches stay around until their acquires are recorded - the barriers live in them
+void UploadBatcher::retireCompleted(){
+    auto retired = std::remove_if(submitted.begin(), submitted.end(), [&](Batch& batch){
+        bool acquired = batch.bufferAcquires.empty() && batch.imageAcquires.empty();
+        if (!acquired || !isComplete(batch)) return false;
+
+        destroyBatch(batch);
+        return true;
+    });
+    submitted.erase(retired, submitted.end());
+}
+
+void UploadBatcher::destroyBatch(Batch& batch){
+    vkFreeCommandBuffers(device, transferCommandPool, 1, &batch.commandBuffer);
+    if (batch.fence != VK_NULL_HANDLE) vkDestroyFence(device, batch.fence, nullptr);
+}
@@ -1,7 +1,7 @@
 #include <utilities.hpp>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 // QueueFamilyIndices ------------------------------------------------------------
 
@@ -14,17 +14,38 @@ bool QueueFamilyIndices::isComplete(){
 
 // Vertex ------------------------------------------------------------------------
 
-VkVertexInputBindingDescription Vertex::getBindingDescription(){
+uint32_t Vertex::getStride(VertexFormat format){
+    return (format == VertexFormat::FULL)? sizeof(Vertex) : sizeof(PackedVertex);
+}
+
+VkVertexInputBindingDescription Vertex::getBindingDescription(VertexFormat format){
     VkVertexInputBindingDescription bindingDescription{};
     bindingDescription.binding   = 0;
-    bindingDescription.stride    = sizeof(Vertex);
+    bindingDescription.stride    = getStride(format);
     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescriptions(){
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+std::vector<VkVertexInputAttributeDescription> Vertex::getAttributeDescriptions(VertexFormat format){
+    if (format != VertexFormat::FULL) {
+        // Same locations as the full layout, minus the color (see shaders/glsl/packed.vert)
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding  = 0;
+        attributeDescriptions[0].format   = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset   = offsetof(PackedVertex, pos);
+
+        attributeDescriptions[1].location = 2;
+        attributeDescriptions[1].binding  = 0;
+        attributeDescriptions[1].format   = (format == VertexFormat::PACKED_UNORM_UV)? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[1].offset   = offsetof(PackedVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
 
     attributeDescriptions[0].location = 0;
     attributeDescriptions[0].binding  = 0;
@@ -52,8 +73,155 @@ bool Vertex::operator==(const Vertex& other) const {
 
 namespace std {
     size_t hash<Vertex>::operator()(const Vertex& vertex) const {
-        return ((hash<glm::vec3>()(vertex.pos)                ^
-                (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1);
+        // Hash the raw bytes, with -0.0 folded into +0.0 so vertices that compare equal hash equally
+        float components[8] = {
+            vertex.pos.x,      vertex.pos.y,      vertex.pos.z,
+            vertex.color.r,    vertex.color.g,    vertex.color.b,
+            vertex.texCoord.x, vertex.texCoord.y
+        };
+        for (float& component : components) {
+            if (component == 0.0f) component = 0.0f;
+        }
+
+        return static_cast<size_t>(hashBytes(components, sizeof(components)));
     }
 }
+
+
+// PackedVertex ------------------------------------------------------------------
+
+PackedVertex PackedVertex::pack(const Vertex& vertex, VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax){
+    PackedVertex packed{};
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    for (int i=0; i < 3; ++i) {
+        float normalized = (extent[i] > 0.0f)? (vertex.pos[i] - boundsMin[i]) / extent[i] : 0.0f;
+        packed.pos[i]    = glm::packUnorm1x16(normalized);
+    }
+
+    for (int i=0; i < 2; ++i) {
+        packed.texCoord[i] = (format == VertexFormat::PACKED_UNORM_UV)? glm::packUnorm1x16(vertex.texCoord[i])
+                                                                      : glm::packHalf1x16(vertex.texCoord[i]);
+    }
+
+    return packed;
+}
+
+glm::mat4 PackedVertex::getDequantizationMatrix(const glm::vec3& boundsMin, const glm::vec3& boundsMax){
+    return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
+}
+
+
+// InstanceData ------------------------------------------------------------------
+
+VkVertexInputBindingDescription InstanceData::getBindingDescription(){
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding   = 1;
+    bindingDescription.stride    = sizeof(InstanceData);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    return bindingDescription;
+}
+
+std::vector<VkVertexInputAttributeDescription> InstanceData::getAttributeDescriptions(){
+    // After the vertex attributes - a mat4 takes one location per column
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(6);
+
+    for (uint32_t column=0; column < 4; ++column) {
+        attributeDescriptions[column].location = 3 + column;
+        attributeDescriptions[column].binding  = 1;
+        attributeDescriptions[column].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[column].offset   = static_cast<uint32_t>(offsetof(InstanceData, transform) + sizeof(glm::vec4) * column);
+    }
+
+    attributeDescriptions[4].location = 7;
+    attributeDescriptions[4].binding  = 1;
+    attributeDescriptions[4].format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[4].offset   = offsetof(InstanceData, tint);
+
+    attributeDescriptions[5].location = 8;
+    attributeDescriptions[5].binding  = 1;
+    attributeDescriptions[5].format   = VK_FORMAT_R32_UINT;
+    attributeDescriptions[5].offset   = offsetof(InstanceData, material);
+
+    return attributeDescriptions;
+}
+
+
+// Hashing -----------------------------------------------------------------------
+
+static inline uint64_t readU64(const uint8_t* p){
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t readU32(const uint8_t* p){
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Full 64x64 -> 128 bit multiply, folded back to 64 bits
+static inline uint64_t foldedMultiply(uint64_t a, uint64_t b){
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed){
+    static const uint64_t secret[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+    };
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= foldedMultiply(seed ^ secret[0], secret[1]);
+
+    uint64_t a, b;
+
+    if (size <= 16) {
+        if (size >= 4) {
+            a = (readU32(p) << 32) | readU32(p + ((size >> 3) << 2));
+            b = (readU32(p + size - 4) << 32) | readU32(p + size - 4 - ((size >> 3) << 2));
+        } else if (size > 0) {
+            a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[size >> 1]) << 8) | p[size - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t remaining = size;
+
+        // Three independent lanes keep the multipliers busy on long inputs
+        if (remaining > 48) {
+            uint64_t lane1 = seed, lane2 = seed;
+            do {
+                seed  = foldedMultiply(readU64(p)      ^ secret[1], readU64(p + 8)  ^ seed);
+                lane1 = foldedMultiply(readU64(p + 16) ^ secret[2], readU64(p + 24) ^ lane1);
+                lane2 = foldedMultiply(readU64(p + 32) ^ secret[3], readU64(p + 40) ^ lane2);
+                p         += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= lane1 ^ lane2;
+        }
+
+        while (remaining > 16) {
+            seed = foldedMultiply(readU64(p) ^ secret[1], readU64(p + 8) ^ seed);
+            p         += 16;
+            remaining -= 16;
+        }
+
+        // Last 16 bytes of the input - may overlap the bytes already consumed
+        a = readU64(p + remaining - 16);
+        b = readU64(p + remaining - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+
+    return foldedMultiply(a ^ secret[0] ^ size, b ^ secret[1]);
+}
\ No newline at end of file
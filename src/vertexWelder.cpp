@@ -0,0 +1,282 @@
+#include <vertexWelder.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+// Below this many corners per shard the merge costs more than the parallel weld saves
+static const size_t   MIN_SHARD_SIZE = 1 << 16;
+static const uint32_t EMPTY_SLOT     = UINT32_MAX;
+
+
+// Raw bytes a vertex is compared by - the vertex itself, or its grid cell when welding with an epsilon
+struct WeldKey {
+    uint32_t words[8];
+
+    bool operator==(const WeldKey& other) const{
+        return memcmp(words, other.words, sizeof(words)) == 0;
+    }
+};
+static_assert(sizeof(WeldKey) == sizeof(Vertex), "WeldKey must cover every Vertex component");
+
+
+struct WeldKeyBuilder {
+    float invPositionEpsilon = 0.0f;
+    float invTexCoordEpsilon = 0.0f;
+
+    explicit WeldKeyBuilder(const WeldOptions& options){
+        if (options.positionEpsilon > 0.0f) invPositionEpsilon = 1.0f / options.positionEpsilon;
+        if (options.texCoordEpsilon > 0.0f) invTexCoordEpsilon = 1.0f / options.texCoordEpsilon;
+    }
+
+    static uint32_t exact(float value){
+        value = (value == 0.0f)? 0.0f : value;        // -0.0 == +0.0
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // Cells outside the int32 range can't be cast - they clamp to the outermost cells, NaNs all go to the lowest one
+    static uint32_t snapped(float value, float invEpsilon){
+        double cell = std::floor(value * invEpsilon + 0.5f);
+        if (std::isnan(cell)) cell = INT32_MIN;
+
+        cell = std::min(std::max(cell, static_cast<double>(INT32_MIN)), static_cast<double>(INT32_MAX));
+        return static_cast<uint32_t>(static_cast<int32_t>(cell));
+    }
+
+    uint32_t position(float value) const{ return (invPositionEpsilon > 0.0f)? snapped(value, invPositionEpsilon) : exact(value); }
+    uint32_t texCoord(float value) const{ return (invTexCoordEpsilon > 0.0f)? snapped(value, invTexCoordEpsilon) : exact(value); }
+
+    WeldKey operator()(const Vertex& vertex) const{
+        return {{
+            position(vertex.pos.x), position(vertex.pos.y), position(vertex.pos.z),
+            exact(vertex.color.r), exact(vertex.color.g), exact(vertex.color.b),
+            texCoord(vertex.texCoord.x), texCoord(vertex.texCoord.y)
+        }};
+    }
+};
+
+
+// Linear probing table of indices into an external key array
+class WeldTable {
+public:
+    explicit WeldTable(size_t expectedCount){
+        size_t capacity = 16;
+        while (capacity < expectedCount * 2) capacity <<= 1;
+
+        slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+        mask = capacity - 1;
+    }
+
+    // Returns the index already stored for an equal key, or stores (and returns) index
+    uint32_t findOrInsert(uint64_t hash, const WeldKey& key, uint32_t index, const WeldKey* keys){
+        uint32_t tag  = static_cast<uint32_t>(hash >> 32);
+        size_t   slot = static_cast<size_t>(hash) & mask;
+
+        while (true) {
+            Slot& candidate = slots[slot];
+
+            if (candidate.index == EMPTY_SLOT) {
+                candidate = Slot{ tag, index };
+                return index;
+            }
+            if (candidate.tag == tag && keys[candidate.index] == key) {
+                return candidate.index;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t tag;
+        uint32_t index;
+    };
+
+    std::vector<Slot> slots;
+    size_t            mask;
+};
+
+
+struct WeldShard {
+    size_t                begin;
+    size_t                end;
+
+    // Per unique vertex, in order of first use within the shard
+    std::vector<WeldKey>  keys;
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> firstCorners;
+};
+
+
+void VertexWelder::weld(const std::vector<Vertex>& corners,
+                        std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                        const WeldOptions& options)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    ThreadPool&    threadPool  = ThreadPool::get();
+    WeldKeyBuilder makeKey(options);
+
+    size_t cornerCount = corners.size();
+
+    vertices.clear();
+    indices.resize(cornerCount);
+    if (cornerCount == 0) return;
+
+
+    // 1. Weld each shard on its own - indices temporarily hold shard-local vertex ids
+    size_t shardCount = std::clamp<size_t>(cornerCount / MIN_SHARD_SIZE, 1, threadPool.getThreadCount());
+
+    std::vector<WeldShard> shards(shardCount);
+    for (size_t s=0; s < shardCount; ++s) {
+        shards[s].begin = cornerCount * s / shardCount;
+        shards[s].end   = cornerCount * (s + 1) / shardCount;
+    }
+
+    threadPool.parallelFor(shardCount, 1, [&](size_t begin, size_t end){
+        for (size_t s=begin; s < end; ++s) {
+            WeldShard& shard = shards[s];
+            WeldTable  table(shard.end - shard.begin);
+
+            for (size_t corner=shard.begin; corner < shard.end; ++corner) {
+                WeldKey  key  = makeKey(corners[corner]);
+                uint64_t hash = hashBytes(&key, sizeof(key));
+
+                uint32_t candidate = static_cast<uint32_t>(shard.keys.size());
+                uint32_t local     = table.findOrInsert(hash, key, candidate, shard.keys.data());
+
+                // keys.data() may move on push_back, but findOrInsert() is done reading it
+                if (local == candidate) {
+                    shard.keys.push_back(key);
+                    shard.hashes.push_back(hash);
+                    shard.firstCorners.push_back(static_cast<uint32_t>(corner));
+                }
+                indices[corner] = local;
+            }
+        }
+    });
+
+
+    // Flatten shard uniques - shard order then local order is global order of first use
+    std::vector<size_t> shardOffsets(shardCount);
+    size_t uniqueCount = 0;
+    for (size_t s=0; s < shardCount; ++s) {
+        shardOffsets[s] = uniqueCount;
+        uniqueCount    += shards[s].keys.size();
+    }
+
+    std::vector<WeldKey>  keys(uniqueCount);
+    std::vector<uint64_t> hashes(uniqueCount);
+    std::vector<uint32_t> firstCorners(uniqueCount);
+
+    threadPool.parallelFor(shardCount, 1, [&](size_t begin, size_t end){
+        for (size_t s=begin; s < end; ++s) {
+            WeldShard& shard = shards[s];
+            std::copy(shard.keys.begin(),         shard.keys.end(),         keys.begin()         + shardOffsets[s]);
+            std::copy(shard.hashes.begin(),       shard.hashes.end(),       hashes.begin()       + shardOffsets[s]);
+            std::copy(shard.firstCorners.begin(), shard.firstCorners.end(), firstCorners.begin() + shardOffsets[s]);
+
+            std::vector<WeldKey>().swap(shard.keys);
+            std::vector<uint64_t>().swap(shard.hashes);
+            std::vector<uint32_t>().swap(shard.firstCorners);
+        }
+    });
+
+
+    // 2. Merge by hash partition - each partition sees its keys in global order, so the first
+    //    occurrence of every vertex becomes the owner of all its duplicates
+    std::vector<uint32_t> owners(uniqueCount);
+
+    uint32_t partitionBits  = 0;
+    if (shardCount > 1) {
+        while ((1u << partitionBits) < threadPool.getThreadCount() && partitionBits < 6) ++partitionBits;
+    }
+    size_t   partitionCount = size_t(1) << partitionBits;
+
+    auto partitionOf = [partitionBits](uint64_t hash) -> size_t {
+        return partitionBits? static_cast<size_t>(hash >> (64 - partitionBits)) : 0;
+    };
+
+    if (shardCount == 1) {
+        std::iota(owners.begin(), owners.end(), 0u);       // A single shard is already unique
+    } else {
+        threadPool.parallelFor(partitionCount, 1, [&](size_t begin, size_t end){
+            for (size_t partition=begin; partition < end; ++partition) {
+                size_t memberCount = 0;
+                for (size_t g=0; g < uniqueCount; ++g) {
+                    memberCount += (partitionOf(hashes[g]) == partition);
+                }
+
+                WeldTable table(memberCount);
+
+                for (size_t g=0; g < uniqueCount; ++g) {
+                    if (partitionOf(hashes[g]) != partition) continue;
+                    owners[g] = table.findOrInsert(hashes[g], keys[g], static_cast<uint32_t>(g), keys.data());
+                }
+            }
+        });
+    }
+
+
+    // 3. Number the owners in order - per block counts, prefix sum, then assignment
+    std::vector<uint32_t> vertexIds(uniqueCount);
+
+    size_t blockCount = std::min<size_t>(uniqueCount, threadPool.getThreadCount() * 4);
+    std::vector<size_t> blockOffsets(blockCount + 1, 0);
+
+    threadPool.parallelFor(blockCount, 1, [&](size_t begin, size_t end){
+        for (size_t block=begin; block < end; ++block) {
+            size_t count = 0;
+            for (size_t g=uniqueCount * block / blockCount; g < uniqueCount * (block + 1) / blockCount; ++g) {
+                count += (owners[g] == g);
+            }
+            blockOffsets[block + 1] = count;
+        }
+    });
+
+    for (size_t block=0; block < blockCount; ++block) {
+        blockOffsets[block + 1] += blockOffsets[block];
+    }
+
+    vertices.resize(blockOffsets[blockCount]);
+
+    threadPool.parallelFor(blockCount, 1, [&](size_t begin, size_t end){
+        for (size_t block=begin; block < end; ++block) {
+            uint32_t id = static_cast<uint32_t>(blockOffsets[block]);
+            for (size_t g=uniqueCount * block / blockCount; g < uniqueCount * (block + 1) / blockCount; ++g) {
+                if (owners[g] != g) continue;
+
+                vertexIds[g]   = id;
+                vertices[id++] = corners[firstCorners[g]];
+            }
+        }
+    });
+
+    // Owners always come first, so their ids are final by now
+    threadPool.parallelFor(uniqueCount, 1 << 14, [&](size_t begin, size_t end){
+        for (size_t g=begin; g < end; ++g) {
+            if (owners[g] != g) vertexIds[g] = vertexIds[owners[g]];
+        }
+    });
+
+
+    // 4. Shard-local ids -> final vertex ids
+    threadPool.parallelFor(shardCount, 1, [&](size_t begin, size_t end){
+        for (size_t s=begin; s < end; ++s) {
+            const uint32_t* shardIds = vertexIds.data() + shardOffsets[s];
+            for (size_t corner=shards[s].begin; corner < shards[s].end; ++corner) {
+                indices[corner] = shardIds[indices[corner]];
+            }
+        }
+    });
+
+
+    auto  endTime   = std::chrono::high_resolution_clock::now();
+    float elapsedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+    LOG_DEBUG_S("Welded " << cornerCount << " corners into " << vertices.size() << " vertices in "
+                << elapsedMs << " ms (" << cornerCount / std::max(elapsedMs, 1e-3f) / 1000.0f << " M corners/s, "
+                << shardCount << " shards)");
+}
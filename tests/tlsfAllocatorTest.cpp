@@ -0,0 +1,205 @@
+// TlsfAllocator bookkeeping checks - CPU only, no device needed
+//  Usage : TlsfAllocatorTest [--seed <value>]
+//  - Returns the number of failed checks
+
+#include <tlsfAllocator.hpp>
+#include <logger.hpp>
+
+
+const uint32_t DEFAULT_SEED       = 1234;
+const uint32_t RANDOM_ITERATIONS  = 100000;
+const uint64_t RANDOM_HEAP_SIZE   = 64ull << 20;
+const uint64_t GRANULARITY        = 1024;
+
+
+static uint32_t failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            LOG_ERROR_S(__func__ << " : " << #condition << " failed (line " << __LINE__ << ")"); \
+            ++failures; \
+        } \
+    } while (0)
+
+
+struct Allocation {
+    uint32_t          handle = TlsfAllocator::INVALID_HANDLE;
+    uint64_t          offset = 0;
+    uint64_t          size   = 0;
+    SuballocationType type   = SuballocationType::LINEAR;
+};
+
+static bool onSamePage(uint64_t a, uint64_t b, uint64_t pageSize){ return a / pageSize == b / pageSize; }
+
+// Address ordered neighbours of different types never share a page, and nothing overlaps
+static bool separated(std::vector<Allocation> allocations, uint64_t pageSize){
+    std::sort(allocations.begin(), allocations.end(), [](const Allocation& a, const Allocation& b){ return a.offset < b.offset; });
+
+    for (size_t i=1; i < allocations.size(); ++i) {
+        const Allocation& prev = allocations[i - 1];
+        const Allocation& next = allocations[i];
+
+        if (prev.offset + prev.size > next.offset) return false;
+        if (prev.type != next.type && onSamePage(prev.offset + prev.size - 1, next.offset, pageSize)) return false;
+    }
+    return true;
+}
+
+
+// Tests --------------------------------
+static void testAlignment(){
+    TlsfAllocator allocator;
+    allocator.init(1 << 20);
+
+    // Odd sizes in between push every following offset off alignment
+    for (uint64_t alignment=1; alignment <= 4096; alignment *= 2) {
+        uint64_t offset;
+        CHECK(allocator.allocate(3, 1, SuballocationType::LINEAR, offset) != TlsfAllocator::INVALID_HANDLE);
+        CHECK(allocator.allocate(100, alignment, SuballocationType::LINEAR, offset) != TlsfAllocator::INVALID_HANDLE);
+        CHECK(offset % alignment == 0);
+    }
+
+    CHECK(allocator.validate());
+}
+
+static void testGranularity(){
+    TlsfAllocator allocator;
+    allocator.init(1 << 20, GRANULARITY);
+
+    std::vector<Allocation> allocations;
+    SuballocationType       types[] = { SuballocationType::LINEAR, SuballocationType::OPTIMAL };
+
+    // Small alternating allocations would all fit in one page without the granularity
+    for (uint32_t i=0; i < 64; ++i) {
+        Allocation allocation;
+        allocation.size   = 100;
+        allocation.type   = types[i % 2];
+        allocation.handle = allocator.allocate(allocation.size, 16, allocation.type, allocation.offset);
+        CHECK(allocation.handle != TlsfAllocator::INVALID_HANDLE);
+        allocations.push_back(allocation);
+    }
+    CHECK(separated(allocations, GRANULARITY));
+
+    // Same type neighbours share pages freely
+    TlsfAllocator packed;
+    packed.init(1 << 20, GRANULARITY);
+
+    uint64_t first, second;
+    packed.allocate(100, 16, SuballocationType::OPTIMAL, first);
+    packed.allocate(100, 16, SuballocationType::OPTIMAL, second);
+    CHECK(onSamePage(first, second, GRANULARITY));
+
+    // Holes refilled with the other type still keep the pages apart
+    for (size_t i=1; i < allocations.size(); i += 4) {
+        allocator.free(allocations[i].handle);
+
+        Allocation& allocation = allocations[i];
+        allocation.type   = (allocation.type == SuballocationType::LINEAR)? SuballocationType::OPTIMAL : SuballocationType::LINEAR;
+        allocation.handle = allocator.allocate(allocation.size, 16, allocation.type, allocation.offset);
+        CHECK(allocation.handle != TlsfAllocator::INVALID_HANDLE);
+    }
+    CHECK(separated(allocations, GRANULARITY));
+    CHECK(allocator.validate());
+}
+
+static void testMerge(){
+    TlsfAllocator allocator;
+    allocator.init(1 << 20);
+
+    uint64_t offset;
+    uint32_t a = allocator.allocate(1000, 1, SuballocationType::LINEAR, offset);
+    uint32_t b = allocator.allocate(1000, 1, SuballocationType::LINEAR, offset);
+    uint32_t c = allocator.allocate(1000, 1, SuballocationType::LINEAR, offset);
+    CHECK(allocator.getAllocationCount() == 3);
+
+    // a and c are not neighbours - two holes plus the tail
+    allocator.free(a);
+    allocator.free(c);
+    CHECK(allocator.getFreeRangeCount() == 2);     // c merged into the tail
+    CHECK(allocator.validate());
+
+    // b bridges them, everything is one range again
+    allocator.free(b);
+    CHECK(allocator.isEmpty());
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.getLargestFreeRange() == allocator.getSize());
+    CHECK(allocator.validate());
+
+    // And the whole heap can be handed out in one piece
+    CHECK(allocator.allocate(allocator.getSize(), 1, SuballocationType::LINEAR, offset) != TlsfAllocator::INVALID_HANDLE);
+    CHECK(offset == 0);
+}
+
+static void testRandom(uint32_t seed){
+    TlsfAllocator allocator;
+    allocator.init(RANDOM_HEAP_SIZE, GRANULARITY);
+
+    std::mt19937                            random(seed);
+    std::uniform_int_distribution<uint32_t> sizeBits(4, 20);
+    std::uniform_int_distribution<uint32_t> alignmentBits(0, 12);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+    std::vector<Allocation> allocations;
+    uint32_t                failedAllocations = 0;
+
+    for (uint32_t i=0; i < RANDOM_ITERATIONS; ++i) {
+        // Lean towards allocating until the heap fills up, then churn
+        if (allocations.empty() || percent(random) < 55) {
+            Allocation allocation;
+            allocation.size   = 1 + (random() & ((1ull << sizeBits(random)) - 1));
+            allocation.type   = (percent(random) < 50)? SuballocationType::LINEAR : SuballocationType::OPTIMAL;
+            allocation.handle = allocator.allocate(allocation.size, 1ull << alignmentBits(random), allocation.type, allocation.offset);
+
+            if (allocation.handle == TlsfAllocator::INVALID_HANDLE) {
+                ++failedAllocations;
+                continue;
+            }
+            allocations.push_back(allocation);
+        } else {
+            size_t index = random() % allocations.size();
+            allocator.free(allocations[index].handle);
+
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+        }
+
+        if (i % 10000 == 0) CHECK(allocator.validate());
+    }
+
+    CHECK(allocator.validate());
+    CHECK(allocator.getAllocationCount() == allocations.size());
+    CHECK(separated(allocations, GRANULARITY));
+
+    for (const Allocation& allocation : allocations) allocator.free(allocation.handle);
+
+    CHECK(allocator.isEmpty());
+    CHECK(allocator.getUsedSize() == 0);
+    CHECK(allocator.getFreeRangeCount() == 1);
+    CHECK(allocator.validate());
+
+    LOG_INFO_S("Random : " << RANDOM_ITERATIONS << " operations, " << failedAllocations << " allocations didn't fit (seed " << seed << ")");
+}
+
+
+int main(int argc, char** argv){
+    uint32_t seed = DEFAULT_SEED;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+    }
+
+    testAlignment();
+    testGranularity();
+    testMerge();
+    testRandom(seed);
+
+    if (failures == 0) LOG_INFO("TLSF allocator : all checks passed");
+    else               LOG_ERROR_S("TLSF allocator : " << failures << " checks failed");
+
+    Logger::destroy();
+    return static_cast<int>(failures);
+}
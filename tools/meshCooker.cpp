@@ -0,0 +1,72 @@
+// Cooks OBJ models into the .vmesh files loaded by the renderer
+//  Usage : MeshCooker [--weld <epsilon>] [--overdraw <threshold>] [--packed] <model.obj> [output.vmesh]
+//  - The output defaults to the model path with a .vmesh extension
+//  - --weld also merges vertices whose positions/texture coordinates fall in the same epsilon-sized grid cell
+//  - --overdraw sets the ACMR growth allowed by the overdraw sort (off by default, 1.05 is a reasonable start)
+//  - --packed stores quantized PackedVertex instead of Vertex (what the renderer cooks with USE_PACKED_VERTICES)
+
+#include <meshCache.hpp>
+#include <meshLoader.hpp>
+#include <meshOptimizer.hpp>
+#include <meshletBuilder.hpp>
+#include <meshSimplifier.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+int main(int argc, char** argv){
+    WeldOptions              weldOptions{};
+    MeshOptimizeOptions      optimizeOptions{};
+    bool                     packVertices = false;
+    std::vector<std::string> paths;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--weld" && i + 1 < argc) {
+            weldOptions.positionEpsilon = std::stof(argv[++i]);
+            weldOptions.texCoordEpsilon = weldOptions.positionEpsilon;
+        } else if (argument == "--overdraw" && i + 1 < argc) {
+            optimizeOptions.overdrawThreshold = std::stof(argv[++i]);
+        } else if (argument == "--packed") {
+            packVertices = true;
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.empty() || paths.size() > 2) {
+        LOG_ERROR("Usage : MeshCooker [--weld <epsilon>] [--overdraw <threshold>] [--packed] <model.obj> [output.vmesh]");
+        return 1;
+    }
+
+    std::string source = paths[0];
+    std::string output = (paths.size() == 2)? paths[1] : source.substr(0, source.find_last_of('.')) + ".vmesh";
+
+    int exitCode = 1;
+
+    uint64_t sourceHash = 0, sourceSize = 0;
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod>  lods;
+    MeshletData           meshletData;
+
+    if (!MeshCache::hashSource(source, sourceHash, sourceSize)) {
+        LOG_ERROR_S("Failed to open " << source);
+    }
+    else if (MeshLoader::loadObj(source, vertices, indices, weldOptions)) {
+        MeshOptimizer::optimize(vertices, indices, optimizeOptions);
+        MeshSimplifier::buildLods(vertices, indices, lods);
+        MeshletBuilder::build(vertices, indices, lods, meshletData);
+
+        if (MeshCache::write(output, vertices, indices, lods, meshletData, sourceHash, sourceSize, packVertices)) {
+            LOG_INFO_S("Cooked " << source << " -> " << output << " (" << vertices.size() << " vertices, " << lods[0].indexCount / 3
+                       << " triangles, " << lods.size() << " LODs, " << meshletData.meshlets.size() << " meshlets)");
+            exitCode = 0;
+        }
+    }
+
+    ThreadPool::destroy();
+    Logger::destroy();
+
+    return exitCode;
+}
@@ -0,0 +1,54 @@
+// Cooks images into the block compressed .ktx2 files loaded by the renderer
+//  Usage : TextureCooker [--normal] <image> [output.ktx2]
+//  - The output defaults to the image path with a .ktx2 extension
+//  - Color images become BC7 (sRGB) and single channel ones BC4, each with a full mip chain
+//  - --normal stores a tangent space normal map as BC5 (red and green channels)
+
+#include <meshCache.hpp>
+#include <textureCache.hpp>
+#include <threadPool.hpp>
+#include <logger.hpp>
+
+
+int main(int argc, char** argv){
+    TextureCookOptions       options{};
+    std::vector<std::string> paths;
+
+    for (int i=1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--normal") {
+            options.normalMap = true;
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.empty() || paths.size() > 2) {
+        LOG_ERROR("Usage : TextureCooker [--normal] <image> [output.ktx2]");
+        return 1;
+    }
+
+    std::string source = paths[0];
+    std::string output = (paths.size() == 2)? paths[1] : source.substr(0, source.find_last_of('.')) + ".ktx2";
+
+    int exitCode = 1;
+
+    if (TextureCache::cook(source, output, options)) {
+        uint64_t sourceHash = 0, sourceSize = 0;
+        MeshCache::hashSource(source, sourceHash, sourceSize);
+
+        TextureCache cache;
+        if (cache.open(output, sourceHash, sourceSize)) {
+            const char* formatName = (cache.getFormat() == VK_FORMAT_BC7_SRGB_BLOCK)?  "BC7" :
+                                     (cache.getFormat() == VK_FORMAT_BC5_UNORM_BLOCK)? "BC5" : "BC4";
+            LOG_INFO_S("Cooked " << source << " -> " << output << " (" << cache.getHeader().pixelWidth << "x" << cache.getHeader().pixelHeight
+                       << " " << formatName << ", " << cache.getLevels().size() << " levels, " << cache.getLevelDataSize() << " bytes)");
+            exitCode = 0;
+        }
+    }
+
+    ThreadPool::destroy();
+    Logger::destroy();
+
+    return exitCode;
+}